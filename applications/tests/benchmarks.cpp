@@ -0,0 +1,641 @@
+#include "benchmarks.h"
+#include "flat_analysis.h"
+
+#include <lac/analysis/analyze_block.h>
+#include <lac/analysis/data_type.h>
+#include <lac/analysis/get_type.h>
+#include <lac/analysis/scope.h>
+#include <lac/completion/completion.h>
+#include <lac/parser/flat_ast.h>
+#include <lac/parser/parser.h>
+#include <lac/parser/tokenizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h> // _aligned_malloc
+#endif
+
+namespace bench
+{
+	// Only incremented when built with COUNT_ALLOCATIONS, which replaces the global operator new
+	std::atomic<size_t> allocationCount = 0; // Number of calls to the global operator new
+	std::atomic<size_t> allocatedBytes = 0;  // Total size requested to the global operator new
+
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		struct Allocations
+		{
+			size_t count = allocationCount.load();
+			size_t bytes = allocatedBytes.load();
+		};
+
+		// Number and size of the allocations made since before
+		std::string allocationsSince(const Allocations& before)
+		{
+#ifdef COUNT_ALLOCATIONS
+			return std::to_string(allocationCount.load() - before.count) + " allocations, "
+				   + std::to_string((allocatedBytes.load() - before.bytes) / 1024) + " KB";
+#else
+			(void)before;
+			return "allocations not counted (configure with COUNT_ALLOCATIONS)";
+#endif
+		}
+
+		// Return the average duration in seconds of a call to func, repeated for at least minDuration
+		double measure(const std::function<void()>& func, double minDuration = 0.5)
+		{
+			func(); // Warm up
+			size_t iterations = 0;
+			const auto start = Clock::now();
+			double elapsed = 0;
+			do
+			{
+				func();
+				++iterations;
+				elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			} while (elapsed < minDuration);
+			return elapsed / iterations;
+		}
+
+		void printThroughput(std::string_view name, size_t bytes, double seconds)
+		{
+			std::cout << "  " << name << ": "
+					  << static_cast<double>(bytes) / (1024 * 1024) / seconds << " MB/s ("
+					  << seconds * 1000 << " ms)\n";
+		}
+
+		// Representative Lua code, repeated until reaching the requested size
+		std::string generateProgram(size_t size)
+		{
+			std::string program;
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				program += "-- Function number " + n + "\n"
+						   "local function func" + n + "(a, b, ...)\n"
+						   "\tlocal t = {x = 1, y = 2.5, name = \"item" + n + "\", 'str', [[long string]]}\n"
+						   "\tif a > b and not t.x then\n"
+						   "\t\treturn a + b * 2 - t.y\n"
+						   "\telseif a == 0x1F then\n"
+						   "\t\tprint(string.format(\"%d\", a), t[1])\n"
+						   "\tend\n"
+						   "\tfor i = 1, #t do\n"
+						   "\t\tt[i] = i .. \"_\" .. n\n"
+						   "\tend\n"
+						   "\t--[[ block\n\tcomment ]]\n"
+						   "\treturn obj:method(t, function(x) return x * x end)\n"
+						   "end\n\n";
+			}
+			return program;
+		}
+
+		// Long comments and large embedded strings
+		std::string generateDataProgram(size_t size)
+		{
+			const std::string line = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor.\n";
+			std::string blob;
+			while (blob.size() < 4096)
+				blob += line;
+
+			std::string program = "--[[\n" + blob + "]]\n";
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				program += "-- Data number " + n + "\n"
+						   "local data" + n + " = [==[" + blob + "]==]\n"
+						   "local name" + n + " = \"" + line.substr(0, 40) + "\\\"quoted\\\"\"\n";
+			}
+			return program;
+		}
+
+		// Configuration file returning a single table of records
+		std::string generateConfigProgram(size_t size)
+		{
+			std::string program = "-- Generated configuration\nreturn {\n";
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				program += "\titem" + n + " = {id = " + n + ", name = \"item " + n + "\", weight = " + n + ".5, enabled = true,"
+						   " tags = {'a', 'b', 'c'}, position = {x = -1, y = 2, z = 0x10}},\n";
+			}
+			return program + "}\n";
+		}
+
+		// Large sequences of numbers and of records
+		std::string generateSequencesProgram(size_t size)
+		{
+			std::string program = "return {\n\tvalues = {";
+			for (size_t i = 0; program.size() < size / 2; ++i)
+				program += std::to_string(i) + ".25, ";
+			program += "},\n\tpoints = {\n";
+			for (size_t i = 0; program.size() < size; ++i)
+				program += "\t\t{x = " + std::to_string(i) + ", y = -1, z = 0x10, name = 'point'},\n";
+			return program + "\t},\n}\n";
+		}
+
+		// Commented-out code and large quoted strings
+		std::string generateStringsProgram(size_t size)
+		{
+			const std::string code = "local x = f(a, b) .. [[text]] -- nested comment\n";
+			std::string data;
+			while (data.size() < 4096)
+				data += "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVo=\\\"";
+
+			std::string program;
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				for (int j = 0; j < 50; ++j)
+					program += "-- " + code;
+				program += "local s" + std::to_string(i) + " = \"" + data + "\"\n"
+						   "local t" + std::to_string(i) + " = '" + data.substr(0, 1000) + "'\n";
+			}
+			return program;
+		}
+
+		// A data table of count numerals, as exported curves or meshes
+		std::string generateNumbersProgram(size_t count)
+		{
+			const char* numerals[] = {"0", "42", "-17", "3.14159", "-0.5", "1e-3", "6.02e23", "0x1F", "0x1p-4", "123456789012"};
+			std::string program = "return {\n";
+			for (size_t i = 0; i < count; ++i)
+			{
+				program += numerals[i % std::size(numerals)];
+				program += (i % 10 == 9) ? ",\n" : ", ";
+			}
+			program += "}\n";
+			return program;
+		}
+
+		// Mostly names, keywords and operators, with names starting like keywords
+		std::string generateIdentifiersProgram(size_t size)
+		{
+			std::string program;
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				program += "local endPos" + n + ", doneCount, format_" + n + " = origin.x, noteFy and anDroid or nullValue\n"
+						   "if not isTrue and iterations ~= untilLimit then returnValue = forEach(elseWhere, funcName) end\n"
+						   "while inLoop and not breakNow do andMask, orMask = thenValue .. localName, repeatCount // zeroCount end\n";
+			}
+			return program;
+		}
+
+		// Long chains of binary operators, as in generated code or string building
+		std::string generateExpressionsProgram(size_t size)
+		{
+			const char* operators[] = {" + ", " * ", " - ", " / ", " % "};
+			std::string program;
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				std::string concat = "local s" + n + " = 'a'", sum = "local x" + n + " = 1";
+				for (size_t j = 0; j < 200; ++j)
+				{
+					concat += " .. " + std::to_string(j);
+					sum += operators[j % std::size(operators)] + std::to_string(j + 1);
+				}
+				program += concat + "\n" + sum + " < 42 == true\n";
+			}
+			return program;
+		}
+
+		// Control flow and local declarations, most statements starting with a keyword
+		std::string generateKeywordsProgram(size_t size)
+		{
+			std::string program;
+			for (size_t i = 0; program.size() < size; ++i)
+			{
+				const auto n = std::to_string(i);
+				program += "local a" + n + ", b = 1, 2\n"
+						   "local function f" + n + "(x)\n"
+						   "\tif x then return 1 elseif not x then return 2 else return 3 end\n"
+						   "end\n"
+						   "for i = 1, 10 do while i do break end end\n"
+						   "for k, v in pairs(t) do repeat goto done until true ::done:: end\n"
+						   "do local c = a" + n + "; end\n";
+			}
+			return program;
+		}
+
+		void benchTokenizer(std::string_view program)
+		{
+			size_t count = 0;
+			printThroughput("tokenize", program.size(), measure([&] {
+								count = lac::parser::tokenize(program).size();
+							}));
+			std::cout << "    " << count << " tokens\n";
+			printThroughput("parseBlock without positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, false);
+							}));
+			printThroughput("parseBlock with positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, true);
+							}));
+		}
+
+		void benchLiterals(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			printThroughput("parseBlock", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+		}
+
+		void benchArena(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			for (bool useArena : {false, true})
+			{
+				options.useArena = useArena;
+				const Allocations before;
+				std::optional<lac::parser::ParseBlockResults> res = lac::parser::parseBlock(program, options);
+				std::cout << "  " << (useArena ? "arena" : "heap") << ": " << allocationsSince(before) << "\n";
+
+				const auto start = Clock::now();
+				res.reset();
+				std::cout << "    free: "
+						  << std::chrono::duration<double>(Clock::now() - start).count() * 1000 << " ms\n";
+				printThroughput("parse and free", program.size(), measure([&] {
+									lac::parser::parseBlock(program, options);
+								}));
+			}
+		}
+
+		void benchValidate(std::string_view program)
+		{
+			printThroughput("parseBlock without positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, false);
+							}));
+			printThroughput("validate", program.size(), measure([&] {
+								lac::parser::validate(program);
+							}));
+		}
+
+		void benchParallel(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			for (unsigned threads : {1u, 2u, 4u, 0u})
+			{
+				options.threads = threads;
+				const auto name = threads ? std::to_string(threads) + " threads" : std::string("all cores");
+				printThroughput(name, program.size(), measure([&] {
+									lac::parser::parseBlock(program, options);
+								}));
+			}
+		}
+
+		void benchNumerals(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			const auto seconds = measure([&] {
+				lac::parser::parseBlock(program, options);
+			});
+			printThroughput("parseBlock", program.size(), seconds);
+			const auto count = std::count(program.begin(), program.end(), ','); // One after each numeral
+			std::cout << "    " << count / seconds / 1e6 << " M numerals/s\n";
+		}
+
+		void benchIdentifiers(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			printThroughput("parseBlock without positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+			printThroughput("validate", program.size(), measure([&] {
+								lac::parser::validate(program);
+							}));
+		}
+
+		void benchStrings(std::string_view program)
+		{
+			printThroughput("tokenize", program.size(), measure([&] {
+								lac::parser::tokenize(program);
+							}));
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			printThroughput("parseBlock without positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+			printThroughput("validate", program.size(), measure([&] {
+								lac::parser::validate(program);
+							}));
+		}
+
+		void benchKeywords(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			printThroughput("parseBlock without positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+			options.registerPositions = true;
+			printThroughput("parseBlock with positions", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+			printThroughput("validate", program.size(), measure([&] {
+								lac::parser::validate(program);
+							}));
+		}
+
+		void benchExpressions(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			options.useArena = false;
+			const Allocations before;
+			const auto res = lac::parser::parseBlock(program, options);
+			std::cout << "  " << allocationsSince(before) << "\n";
+			printThroughput("parseBlock", program.size(), measure([&] {
+								lac::parser::parseBlock(program, options);
+							}));
+			printThroughput("analyseBlock", program.size(), measure([&] {
+								lac::an::analyseBlock(res.block);
+							}));
+		}
+
+		void benchLazy(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			for (bool lazy : {false, true})
+			{
+				options.lazyFunctionBodies = lazy;
+				printThroughput(lazy ? "parseBlock with lazy bodies" : "parseBlock", program.size(), measure([&] {
+									lac::parser::parseBlock(program, options);
+								}));
+			}
+
+			// First update of the completion, then a query in the middle of a function
+			const auto pos = program.find("return a + b", program.size() / 2);
+			for (bool lazy : {false, true})
+			{
+				printThroughput(lazy ? "updateProgram with lazy bodies" : "updateProgram", program.size(), measure([&] {
+									lac::comp::Completion completion;
+									completion.setLazyParse(lazy);
+									completion.updateProgram(program);
+								}));
+				printThroughput(lazy ? "updateProgram and query with lazy bodies" : "updateProgram and query", program.size(), measure([&] {
+									lac::comp::Completion completion;
+									completion.setLazyParse(lazy);
+									completion.updateProgram(program);
+									completion.getVariableCompletionList(program, pos);
+								}));
+			}
+		}
+
+		// Update of the completion after each edit of a function, the other ones being unchanged
+		void benchReuse(std::string_view program)
+		{
+			std::string edited(program);
+			edited.insert(edited.find("return a + b", edited.size() / 2), "local edit = 1 ");
+			for (bool reuse : {false, true})
+			{
+				lac::comp::Completion completion;
+				completion.setReuseScopes(reuse);
+				completion.updateProgram(program);
+				bool toggle = false;
+				printThroughput(reuse ? "updateProgram reusing the scopes" : "updateProgram", program.size(), measure([&] {
+									toggle = !toggle;
+									completion.updateProgram(toggle ? edited : program);
+								}));
+			}
+		}
+
+		void benchData(std::string_view program)
+		{
+			for (bool direct : {false, true})
+			{
+				const Allocations before;
+				size_t nbMembers = 0;
+				if (direct)
+					nbMembers = lac::an::getDataType(program)->members.size();
+				else
+				{
+					const auto res = lac::parser::parseBlock(program, false);
+					nbMembers = lac::an::getType(lac::an::Scope{}, res.block.returnStatement->expressions.front()).members.size();
+				}
+				std::cout << "  " << (direct ? "getDataType" : "parseBlock and getType") << ": "
+						  << nbMembers << " members, " << allocationsSince(before) << "\n";
+				printThroughput(direct ? "getDataType" : "parseBlock and getType", program.size(), measure([&] {
+									if (direct)
+										lac::an::getDataType(program);
+									else
+									{
+										const auto res = lac::parser::parseBlock(program, false);
+										lac::an::getType(lac::an::Scope{}, res.block.returnStatement->expressions.front());
+									}
+								}));
+			}
+		}
+
+		// Number of TypeInfo objects kept by the type
+		size_t countTypes(const lac::an::TypeInfo& type)
+		{
+			size_t count = 1;
+			for (const auto& member : type.members)
+				count += countTypes(member.second);
+			if (type.element)
+				count += countTypes(*type.element);
+			return count;
+		}
+
+		// Memory used by the type of large table constructors
+		void benchSequences(std::string_view program)
+		{
+			const auto res = lac::parser::parseBlock(program, false);
+			const auto& expression = res.block.returnStatement->expressions.front();
+			for (bool direct : {false, true})
+			{
+				const Allocations before;
+				const auto type = direct ? *lac::an::getDataType(program) : lac::an::getType(lac::an::Scope{}, expression);
+				std::cout << "  " << (direct ? "getDataType" : "getType") << ": " << countTypes(type) << " types ("
+						  << countTypes(type) * sizeof(lac::an::TypeInfo) / 1024 << " KB), " << allocationsSince(before) << "\n";
+			}
+			printThroughput("getType", program.size(), measure([&] {
+								lac::an::getType(lac::an::Scope{}, expression);
+							}));
+			printThroughput("getDataType", program.size(), measure([&] {
+								lac::an::getDataType(program);
+							}));
+		}
+
+		// Full-document analysis of the variant tree and of the flat one
+		void benchFlat(std::string_view program)
+		{
+			lac::parser::ParseOptions options;
+			options.registerPositions = false;
+			options.useArena = false;
+			Allocations before;
+			const auto res = lac::parser::parseBlock(program, options);
+			std::cout << "  variant tree: " << allocationsSince(before) << "\n";
+
+			before = {};
+			const auto tree = lac::ast::flatten(res.block);
+			std::cout << "  flat tree: " << tree.size() << " nodes, " << tree.memoryUsage() / 1024 << " KB, "
+					  << allocationsSince(before) << "\n";
+
+			printThroughput("flatten", program.size(), measure([&] {
+								lac::ast::flatten(res.block);
+							}));
+			printThroughput("analyseBlock", program.size(), measure([&] {
+								lac::an::analyseBlock(res.block);
+							}));
+			printThroughput("analyseFlatTree", program.size(), measure([&] {
+								analyseFlatTree(tree);
+							}));
+
+			// Linear scan of the flat tree against a visit of the variant one
+			printThroughput("flatten and analyseFlatTree", program.size(), measure([&] {
+								analyseFlatTree(lac::ast::flatten(res.block));
+							}));
+		}
+
+		std::string repeat(std::string_view str, size_t n)
+		{
+			std::string result;
+			for (size_t i = 0; i < n; ++i)
+				result += str;
+			return result;
+		}
+
+		// Growth of the parse time with the nesting of the inputs, which should stay close to the growth of their size
+		void benchPathological(std::string_view /*program*/)
+		{
+			const std::vector<std::pair<std::string_view, std::function<std::string(size_t)>>> generators = {
+				{"brackets", [](size_t n) { return "x = " + repeat("(", n) + "x" + repeat(")", n); }},
+				{"tables", [](size_t n) { return "x = " + repeat("{", n) + repeat("}", n); }},
+				{"unary operators", [](size_t n) { return "x = " + repeat("- ", n) + "1"; }},
+				{"nested calls", [](size_t n) { return repeat("f(", n) + "1" + repeat(")", n); }},
+				{"call chain", [](size_t n) { return "a" + repeat(".b(c)[d]", n) + ".e = 1"; }},
+				{"nested callbacks", [](size_t n) { return repeat("f(function() ", n) + "g()" + repeat(" end)", n); }},
+				{"nested blocks", [](size_t n) { return repeat("do if x then ", n) + "g()" + repeat(" end end", n); }}};
+
+			const size_t small = 64, large = 1024;
+			for (const auto& [name, generator] : generators)
+			{
+				std::cout << "  " << name << ":";
+				double first = 0, duration = 0;
+				for (auto n = small; n <= large; n *= 2)
+				{
+					const auto program = generator(n);
+					duration = measure([&] { lac::parser::parseBlock(program); }, 0.1);
+					first = first ? first : duration;
+					std::cout << " " << duration * 1000 << " ms (" << n << ")";
+				}
+				std::cout << ", x" << duration / first << " for x" << large / small << " nesting\n";
+			}
+		}
+
+		struct Benchmark
+		{
+			std::string_view name;
+			std::function<void(std::string_view program)> func;
+			size_t generatedSize = 0;
+			std::function<std::string(size_t size)> generator = generateProgram;
+		};
+
+		const std::vector<Benchmark>& getBenchmarks()
+		{
+			static const std::vector<Benchmark> benchmarks = {
+				{"tokenizer", benchTokenizer, 1024 * 1024},
+				{"arena", benchArena, 1024 * 1024},
+				{"literals", benchLiterals, 4 * 1024 * 1024, generateDataProgram},
+				{"validate", benchValidate, 1024 * 1024},
+				{"parallel", benchParallel, 4 * 1024 * 1024},
+				{"numerals", benchNumerals, 1000 * 1000, generateNumbersProgram}, // Number of numerals
+				{"identifiers", benchIdentifiers, 1024 * 1024, generateIdentifiersProgram},
+				{"expressions", benchExpressions, 1024 * 1024, generateExpressionsProgram},
+				{"keywords", benchKeywords, 1024 * 1024, generateKeywordsProgram},
+				{"strings", benchStrings, 4 * 1024 * 1024, generateStringsProgram},
+				{"lazy", benchLazy, 1024 * 1024},
+				{"reuse", benchReuse, 1024 * 1024},
+				{"data", benchData, 4 * 1024 * 1024, generateConfigProgram},
+				{"sequences", benchSequences, 4 * 1024 * 1024, generateSequencesProgram},
+				{"flat", benchFlat, 1024 * 1024},
+				{"pathological", benchPathological}}; // Generates its own inputs
+			return benchmarks;
+		}
+	} // namespace
+
+	void runBenchmarks(std::string_view filter, std::string_view program)
+	{
+		for (const auto& benchmark : getBenchmarks())
+		{
+			if (filter != "all" && benchmark.name.find(filter) == std::string_view::npos)
+				continue;
+
+			std::cout << benchmark.name << "\n";
+			if (!program.empty())
+				benchmark.func(program);
+			else
+			{
+				const auto generated = benchmark.generator(benchmark.generatedSize);
+				benchmark.func(generated);
+			}
+		}
+	}
+} // namespace bench
+
+#ifdef COUNT_ALLOCATIONS
+// Replaces the allocation functions of the whole driver, so only enabled for the benchmarks
+void* operator new(std::size_t size)
+{
+	++bench::allocationCount;
+	bench::allocatedBytes += size;
+	if (auto ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+// Used by std::pmr::new_delete_resource
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	++bench::allocationCount;
+	bench::allocatedBytes += size;
+	const auto align = static_cast<std::size_t>(alignment);
+#ifdef _MSC_VER
+	if (auto ptr = _aligned_malloc(size ? size : 1, align))
+#else
+	if (auto ptr = std::aligned_alloc(align, (size + align - 1) / align * align))
+#endif
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(ptr, alignment);
+}
+#endif
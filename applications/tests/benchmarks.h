@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string_view>
+
+namespace bench
+{
+	// Run the benchmarks whose name contains filter ("all" for every one),
+	// on the given program or on generated ones if it is empty
+	void runBenchmarks(std::string_view filter, std::string_view program);
+} // namespace bench
@@ -0,0 +1,583 @@
+#include "flat_analysis.h"
+
+#include <lac/analysis/fold_expression.h>
+#include <lac/analysis/user_defined.h>
+#include <lac/parser/flat_ast.h>
+
+#include <doctest/doctest.h>
+
+#ifndef DOCTEST_CONFIG_DISABLE
+#include <lac/analysis/analyze_block.h>
+#include <lac/parser/parser.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	// Same rules as lac::an::analyseBlock, which is the reference: this copy only exists to measure the traversal
+	// of the flat tree against the one of the variant tree, and the test below keeps both in sync
+	namespace
+	{
+		using namespace lac::an;
+		using lac::ast::FlatTree;
+		using lac::ast::NodeKind;
+		using Index = FlatTree::Index;
+
+		// Types of the expressions, as GetType and GetSubType
+		class FlatGetType
+		{
+		public:
+			FlatGetType(const FlatTree& tree, const Scope& scope)
+				: m_tree(tree)
+				, m_scope(scope)
+			{
+			}
+
+			TypeInfo expression(Index node) const
+			{
+				const auto operand = node + 1;
+				auto next = m_tree.subtreeEnd(operand);
+				const auto end = m_tree.subtreeEnd(node);
+				if (next == end)
+					return (*this)(operand);
+
+				std::vector<Index> operations;
+				for (; next != end; next = m_tree.subtreeEnd(next))
+					operations.push_back(next);
+				return foldExpression(
+					operations.size(),
+					[&](size_t i) { return (*this)(i ? operations[i - 1] + 1 : operand); },
+					[&](size_t i) { return m_tree.operation(operations[i]); });
+			}
+
+			// Type of an operand
+			TypeInfo operator()(Index node) const
+			{
+				switch (m_tree.kind(node))
+				{
+				case NodeKind::constant:
+					return constantType(m_tree.constant(node));
+				case NodeKind::integer:
+				case NodeKind::floating:
+					return Type::number;
+				case NodeKind::literalString:
+					return Type::string;
+				case NodeKind::unaryOperation:
+					return unaryOperationType(m_tree.operation(node), expression(node + 1));
+				case NodeKind::tableConstructor:
+					return tableConstructor(node);
+				case NodeKind::prefixExpression:
+					return prefixExpression(node);
+				case NodeKind::functionBody:
+					return functionBody(node);
+				default:
+					return Type::error;
+				}
+			}
+
+			TypeInfo functionBody(Index node) const
+			{
+				TypeInfo info{Type::function};
+				const auto parameters = node + 1;
+				if (m_tree.kind(parameters) != NodeKind::parameters)
+					return info;
+
+				static const lac::ast::Atom self{"self"};
+				bool first = true;
+				for (const auto param : m_tree.children(parameters))
+				{
+					const auto name = m_tree.name(param);
+					if (first && name == self)
+						info.function.isMethod = true; // Ignore this parameter
+					else
+						info.function.parameters.emplace_back(name.str());
+					first = false;
+				}
+				return info;
+			}
+
+		private:
+			TypeInfo tableConstructor(Index node) const
+			{
+				const auto children = m_tree.children(node);
+				if (children.empty())
+					return Type::table;
+
+				// A sequence is an array, with the type of all its values
+				bool sequence = true;
+				for (const auto field : children)
+					sequence = sequence && m_tree.kind(field) == NodeKind::expression;
+				if (sequence)
+				{
+					auto it = children.begin();
+					auto element = expression(*it);
+					for (++it; it != children.end(); ++it)
+						widenType(element, expression(*it));
+					return TypeInfo::createArray(std::move(element));
+				}
+
+				TypeInfo info{Type::table};
+				int fieldIndex = 1;
+				for (const auto field : children)
+				{
+					if (m_tree.kind(field) == NodeKind::fieldByAssignment)
+						info.members[m_tree.name(field)] = expression(field + 1);
+					else if (m_tree.kind(field) == NodeKind::expression)
+						info.members[std::to_string(fieldIndex++)] = expression(field);
+				}
+				return info;
+			}
+
+			TypeInfo prefixExpression(Index node) const
+			{
+				const auto start = node + 1;
+				TypeInfo type = Type::unknown;
+				if (m_tree.kind(start) == NodeKind::name)
+					type.name = m_tree.name(start).str();
+				else
+					type = expression(start + 1);
+
+				const auto end = m_tree.subtreeEnd(node);
+				auto postfix = m_tree.subtreeEnd(start);
+				if (postfix == end)
+					return m_scope.getVariableType(type.name);
+
+				for (; postfix != end; postfix = m_tree.subtreeEnd(postfix))
+					type = subType(type, postfix);
+				return type;
+			}
+
+			TypeInfo subType(const TypeInfo& parentType, Index node) const
+			{
+				const auto parent = parentAsVariable(parentType);
+				switch (m_tree.kind(node))
+				{
+				case NodeKind::tableIndexExpression:
+					if (parent.type == Type::array && expression(node + 1).type == Type::number)
+						return parent.elementType();
+					return {};
+
+				case NodeKind::tableIndexName:
+					return parent.member(m_tree.name(node));
+
+				case NodeKind::call:
+				{
+					const auto type = m_tree.hasMember(node)
+										  ? parent.member(m_tree.member(node))
+										  : parent;
+					if (type.function.getResultTypeFunc)
+						return Type::unknown;
+					if (type.function.results.empty())
+						return {};
+					return type.function.results.front();
+				}
+
+				default:
+					return {};
+				}
+			}
+
+			TypeInfo parentAsVariable(const TypeInfo& parentType) const
+			{
+				if (parentType.type == Type::unknown && !parentType.name.empty())
+				{
+					auto info = m_scope.getVariableType(parentType.name);
+					if (!info)
+						info = m_scope.getUserType(parentType.name);
+					return m_scope.resolve(info);
+				}
+				return m_scope.resolve(parentType);
+			}
+
+			const FlatTree& m_tree;
+			const Scope& m_scope;
+		};
+
+		// Declarations of a block, as AnalysisVisitor
+		class FlatAnalysis
+		{
+		public:
+			FlatAnalysis(const FlatTree& tree, Scope& scope)
+				: m_tree(tree)
+				, m_scope(scope)
+			{
+			}
+
+			void block(Index node) const
+			{
+				for (const auto child : m_tree.children(node))
+					statement(child);
+			}
+
+		private:
+			void statement(Index node) const
+			{
+				switch (m_tree.kind(node))
+				{
+				case NodeKind::assignmentStatement:
+					return assignment(node);
+
+				case NodeKind::localAssignmentStatement:
+					return localAssignment(node);
+
+				case NodeKind::functionCallStatement:
+				case NodeKind::returnStatement:
+					return visitExpressions(node);
+
+				case NodeKind::labelStatement:
+					return m_scope.addLabel(m_tree.name(node));
+
+				case NodeKind::doStatement:
+					return analyseChild(m_tree.child(node, 0));
+
+				case NodeKind::whileStatement:
+					return analyseChild(m_tree.child(node, 1));
+
+				case NodeKind::repeatStatement:
+					return analyseChild(m_tree.child(node, 0));
+
+				case NodeKind::ifStatement:
+					for (const auto child : m_tree.children(node))
+					{
+						if (m_tree.kind(child) == NodeKind::block)
+							analyseChild(child);
+					}
+					return;
+
+				case NodeKind::numericalForStatement:
+				{
+					Scope scope{&m_scope};
+					scope.addVariable(m_tree.name(node), Type::number);
+					return analyse(std::move(scope), m_tree.lastChild(node));
+				}
+
+				case NodeKind::genericForStatement:
+					return genericFor(node);
+
+				case NodeKind::functionDeclarationStatement:
+					return functionDeclaration(node);
+
+				case NodeKind::localFunctionDeclarationStatement:
+				{
+					const auto name = m_tree.name(node);
+					m_scope.addVariable(name, getType().functionBody(node + 1));
+					return functionBody(node + 1, name);
+				}
+
+				default:
+					return;
+				}
+			}
+
+			void assignment(Index node) const
+			{
+				const auto variables = node + 1;
+				const auto expressions = m_tree.subtreeEnd(variables);
+				auto expression = m_tree.children(expressions).begin();
+				const auto expressionsEnd = m_tree.children(expressions).end();
+				for (const auto var : m_tree.children(variables))
+				{
+					TypeInfo type;
+					if (expression != expressionsEnd)
+					{
+						type = getType().expression(*expression);
+						++expression;
+					}
+
+					const auto start = var + 1;
+					if (m_tree.kind(start) != NodeKind::name)
+						continue;
+
+					// Named variables
+					const auto varName = m_tree.name(start);
+					const auto end = m_tree.subtreeEnd(var);
+					if (m_tree.subtreeEnd(start) == end)
+					{
+						m_scope.addVariable(varName, type);
+						continue;
+					}
+
+					// Table member
+					auto* memberType = &m_scope.modifyTable(varName);
+					for (auto postfix = m_tree.subtreeEnd(start); postfix != end; postfix = m_tree.subtreeEnd(postfix))
+					{
+						if (m_tree.kind(postfix) != NodeKind::tableIndexName)
+						{
+							memberType = nullptr;
+							break;
+						}
+						memberType = &memberType->members[m_tree.name(postfix)];
+					}
+
+					if (memberType)
+						*memberType = type;
+				}
+
+				// Visit expressions, add child scopes
+				visitExpressions(expressions);
+			}
+
+			void localAssignment(Index node) const
+			{
+				const auto names = node + 1;
+				const auto expressions = m_tree.subtreeEnd(names);
+				if (expressions == m_tree.subtreeEnd(node))
+				{
+					for (const auto name : m_tree.children(names))
+						m_scope.addVariable(m_tree.name(name), {Type::unknown});
+					return;
+				}
+
+				auto expression = m_tree.children(expressions).begin();
+				const auto expressionsEnd = m_tree.children(expressions).end();
+				for (const auto name : m_tree.children(names))
+				{
+					TypeInfo type;
+					if (expression != expressionsEnd)
+					{
+						type = getType().expression(*expression);
+						++expression;
+					}
+					m_scope.addVariable(m_tree.name(name), type);
+				}
+
+				// Visit expressions, add child scopes
+				visitExpressions(expressions);
+			}
+
+			void genericFor(Index node) const
+			{
+				const auto names = node + 1;
+				const auto expressions = m_tree.subtreeEnd(names);
+				const auto block = m_tree.subtreeEnd(expressions);
+				const auto firstExpression = m_tree.children(expressions).begin();
+				if (firstExpression == m_tree.children(expressions).end())
+				{
+					for (const auto name : m_tree.children(names))
+						m_scope.addVariable(m_tree.name(name), {});
+				}
+				else
+				{
+					const auto iterType = getType().expression(*firstExpression);
+					const auto& res = iterType.function.results;
+					size_t i = 0;
+					for (const auto name : m_tree.children(names))
+					{
+						TypeInfo type;
+						if (iterType.type == Type::function && i < res.size())
+							type = res[i];
+						m_scope.addVariable(m_tree.name(name), type);
+						++i;
+					}
+				}
+
+				analyse(Scope{&m_scope}, block);
+			}
+
+			void functionDeclaration(Index node) const
+			{
+				const auto name = node + 1;
+				const auto body = m_tree.subtreeEnd(name);
+				auto funcType = getType().functionBody(body);
+
+				// Global function
+				const auto start = m_tree.name(name + 1);
+				const auto nbNames = m_tree.childrenCount(name);
+				if (nbNames == 1)
+				{
+					m_scope.addVariable(start, std::move(funcType));
+					return functionBody(body, start);
+				}
+
+				// Declaration of a table function or method
+				auto* memberType = &m_scope.modifyTable(start);
+				const auto isMethod = m_tree.flag(name);
+				for (auto member = m_tree.subtreeEnd(name + 1); member != body; member = m_tree.subtreeEnd(member))
+				{
+					if (isMethod && m_tree.subtreeEnd(member) == body)
+						funcType.function.isMethod = true;
+					memberType = &memberType->members[m_tree.name(member)];
+				}
+				*memberType = funcType;
+
+				functionBody(body); // Visit the body scope
+			}
+
+			void functionBody(Index node, lac::ast::Atom functionName = {}) const
+			{
+				Scope scope{&m_scope};
+				scope.setLazy(m_tree.flag(node));
+				const auto parameters = node + 1;
+				if (m_tree.kind(parameters) == NodeKind::parameters)
+				{
+					// Test if the function has a defined signature
+					const auto userDefined = m_scope.getUserDefined();
+					const auto funcType = !functionName.empty() && userDefined
+											  ? userDefined->getScriptInput(functionName)
+											  : nullptr;
+					if (funcType)
+					{
+						// We want to use the given parameter names with the types previously defined
+						const auto& inputParams = funcType->function.parameters;
+						size_t i = 0;
+						for (const auto param : m_tree.children(parameters))
+						{
+							scope.addVariable(m_tree.name(param), i >= inputParams.size() ? Type::unknown : inputParams[i].type());
+							++i;
+						}
+					}
+					else
+					{
+						// We do not know the parameter types
+						for (const auto param : m_tree.children(parameters))
+							scope.addVariable(m_tree.name(param), Type::unknown);
+
+						if (!functionName.empty())
+							scope.addVariable(functionName, m_scope.getVariableType(functionName)); // The function can be called recursively
+					}
+				}
+
+				analyse(std::move(scope), m_tree.lastChild(node));
+			}
+
+			// The function bodies of the expressions in the subtree, in the order of the document
+			void visitExpressions(Index node) const
+			{
+				for (Index it = node + 1, end = m_tree.subtreeEnd(node); it < end;)
+				{
+					if (m_tree.kind(it) == NodeKind::functionBody)
+					{
+						functionBody(it);
+						it = m_tree.subtreeEnd(it);
+					}
+					else
+						++it;
+				}
+			}
+
+			void analyse(Scope scope, Index block) const
+			{
+				FlatAnalysis{m_tree, scope}.block(block);
+				m_scope.addChildScope(std::move(scope));
+			}
+
+			void analyseChild(Index block) const
+			{
+				analyse(Scope{&m_scope}, block);
+			}
+
+			FlatGetType getType() const
+			{
+				return {m_tree, m_scope};
+			}
+
+			const FlatTree& m_tree;
+			Scope& m_scope;
+		};
+	} // namespace
+
+	lac::an::Scope analyseFlatTree(const lac::ast::FlatTree& tree, lac::an::Scope* parentScope)
+	{
+		Scope scope(parentScope);
+		if (tree.size())
+			FlatAnalysis{tree, scope}.block(tree.root());
+		return scope;
+	}
+
+#ifndef DOCTEST_CONFIG_DISABLE
+	namespace
+	{
+		void checkSameType(const TypeInfo& type, const TypeInfo& expected)
+		{
+			CHECK(type.typeName() == expected.typeName());
+			CHECK(type.functionDefinition() == expected.functionDefinition());
+			if (type.type == Type::array)
+				checkSameType(type.elementType(), expected.elementType());
+			REQUIRE(type.members.size() == expected.members.size());
+			for (auto it = type.members.begin(), expectedIt = expected.members.begin(); it != type.members.end(); ++it, ++expectedIt)
+			{
+				CHECK(it->first == expectedIt->first);
+				checkSameType(it->second, expectedIt->second);
+			}
+		}
+
+		void checkSameScope(const Scope& scope, const Scope& expected)
+		{
+			const auto elements = scope.getElements(), expectedElements = expected.getElements();
+			REQUIRE(elements.size() == expectedElements.size());
+			for (auto it = elements.begin(), expectedIt = expectedElements.begin(); it != elements.end(); ++it, ++expectedIt)
+			{
+				CHECK(it->first == expectedIt->first);
+				checkSameType(it->second.typeInfo, expectedIt->second.typeInfo);
+			}
+			CHECK(scope.isLazy() == expected.isLazy());
+
+			const auto& children = scope.children();
+			const auto& expectedChildren = expected.children();
+			REQUIRE(children.size() == expectedChildren.size());
+			for (size_t i = 0; i < children.size(); ++i)
+				checkSameScope(children[i], expectedChildren[i]);
+		}
+
+		TEST_CASE("Flat tree analysis")
+		{
+			UserDefined user;
+			TypeInfo vec3Type = Type::table;
+			vec3Type.name = "Vector3";
+			vec3Type.members["x"] = Type::number;
+			vec3Type.members["length"] = "number method()";
+			user.addType(vec3Type);
+			user.addVariable("positions", "Vector3[]");
+			user.addVariable("getPos", "Vector3 function()");
+			user.addScriptInput("onUpdate", "function(number dt, Vector3 pos)");
+
+			const std::string_view program = R"~~(
+local n, s, b = 42, 'text', not x
+t = {x = 1, 'a', [2] = 3, sub = {y = -2.5 .. 'c'}}
+t.m = function(a) return a end
+t.sub.z = #t
+list = {{x = 1}, {x = 2, y = true}}
+a = list[2].y
+p = positions[1].x
+l = getPos():length()
+e = 1 + 2 * 3 ^ 2 ^ 1 .. 'x' == 'y' or n < 3 and {}
+function f(x, ...) local y = x * 2 return y end
+function t.g(self, v) end
+function t.sub:h(w) end
+local function r(k) return r(k - 1) end
+function onUpdate(delta, position) local l = position:length() end
+for i = 1, 10 do local j = i end
+for k, v in pairs(t) do print(k, v) end
+while n > 0 do n = n - 1 end
+repeat local u = 1 until true
+if n then local c = 1 elseif s then local c = 2 else local c = 3 end
+do local d = function() return {} end end
+::label::
+goto label
+(f)(function(q) local z = q end)
+return function() end
+)~~";
+
+			for (bool lazy : {false, true})
+			{
+				lac::parser::ParseOptions options;
+				options.lazyFunctionBodies = lazy;
+				const auto res = lac::parser::parseBlock(program, options);
+				REQUIRE(res.parsed);
+
+				Scope parentScope;
+				parentScope.setUserDefined(&user);
+				const auto scope = lac::an::analyseBlock(res.block, &parentScope);
+				const auto flatScope = analyseFlatTree(lac::ast::flatten(res.block), &parentScope);
+				checkSameScope(flatScope, scope);
+				CHECK(flatScope.getVariableType("a").type == Type::boolean);
+				CHECK(flatScope.getVariableType("p").type == Type::number);
+				CHECK(flatScope.getVariableType("l").type == Type::number);
+				CHECK(flatScope.getVariableType("e").type == Type::unknown);
+			}
+		}
+	} // namespace
+#endif
+} // namespace bench
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <lac/analysis/scope.h>
+
+namespace lac::ast
+{
+	class FlatTree;
+}
+
+namespace bench
+{
+	// Analysis of the flat representation of the tree, compared to analyseBlock by the "flat" benchmark.
+	// The child scopes have no block, and the result callbacks of the functions, which take the arguments
+	// of the variant tree, are not called.
+	lac::an::Scope analyseFlatTree(const lac::ast::FlatTree& tree, lac::an::Scope* parentScope = nullptr);
+} // namespace bench
@@ -1,14 +1,19 @@
+#include "benchmarks.h"
 #include "coloration_test.h"
 
 #define DOCTEST_CONFIG_IMPLEMENTATION_IN_DLL
 #include <doctest/doctest.h>
 
 #include <lac/parser/ast_adapted.h>
+#include <lac/parser/ast_cache.h>
 #include <lac/parser/parser.h>
 #include <lac/parser/positions.h>
 #include <lac/parser/printer.h>
 
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <vector>
 
 #ifdef WIN32
 #include <windows.h>
@@ -74,6 +79,40 @@ namespace
 			std::cout << "json library not available\n";
 #endif
 	}
+
+	// Load each file through the cache in the directory: cold (parsed then stored), then warm (memory-mapped)
+	void compareCacheLoads(const std::filesystem::path& directory, const std::vector<std::string>& paths)
+	{
+		using Clock = std::chrono::steady_clock;
+		lac::parser::AstCache cache(directory);
+		double totalCold = 0, totalWarm = 0;
+		for (const auto& path : paths)
+		{
+			const auto data = loadFile(path);
+			std::error_code error;
+			std::filesystem::remove(cache.path(data), error);
+
+			auto start = Clock::now();
+			const auto cold = cache.parseBlock(data);
+			const auto coldSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			const auto hits = cache.hits();
+			start = Clock::now();
+			const auto warm = cache.parseBlock(data);
+			const auto warmSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			std::cout << path << ": cold " << coldSeconds * 1000 << " ms, warm " << warmSeconds * 1000 << " ms";
+			if (cache.hits() == hits)
+				std::cout << " (not stored)";
+			else
+				std::cout << " (x" << coldSeconds / warmSeconds << ", " << std::filesystem::file_size(cache.path(data), error) / 1024 << " KB)";
+			std::cout << "\n";
+			totalCold += coldSeconds;
+			totalWarm += warmSeconds;
+		}
+		if (paths.size() > 1)
+			std::cout << "total: cold " << totalCold * 1000 << " ms, warm " << totalWarm * 1000 << " ms\n";
+	}
 } // namespace
 
 int main(int argc, char** argv)
@@ -91,6 +130,19 @@ int main(int argc, char** argv)
 			printAst(argv[++i]);
 			return 0;
 		}
+		else if (cmd == "cache" && i + 1 < argc)
+		{
+			const std::filesystem::path directory = argv[++i];
+			compareCacheLoads(directory, std::vector<std::string>(argv + i + 1, argv + argc));
+			return 0;
+		}
+		else if (cmd == "benchmark")
+		{
+			const std::string filter = i + 1 < argc ? argv[++i] : "all";
+			const auto program = i + 1 < argc ? loadFile(argv[++i]) : std::string{};
+			bench::runBenchmarks(filter, program);
+			return 0;
+		}
 	}
 
 	doctest::Context context;
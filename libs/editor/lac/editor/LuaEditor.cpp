@@ -641,11 +641,11 @@ namespace lac::editor
 		}
 	}
 
-	parser::ParseBlockResults LuaEditor::compileProgram()
+	parser::ParseBlockResults LuaEditor::compileProgram(std::string& source)
 	{
-		auto text = document()->toPlainText().toStdString();
-		removeNonASCII(text);
-		return lac::parser::parseBlock(text);
+		source = document()->toPlainText().toStdString();
+		removeNonASCII(source);
+		return lac::parser::parseBlock(source);
 	}
 
 } // namespace lac::editor
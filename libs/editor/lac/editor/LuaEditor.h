@@ -52,7 +52,8 @@ namespace lac::editor
 		std::vector<std::string> getTypeHierarchyAtCursor();
 		std::string getVariableNameAtCursor();
 
-		parser::ParseBlockResults compileProgram();
+		// Parse the program, copied in source. The literal strings of the results view it, it must outlive them.
+		parser::ParseBlockResults compileProgram(std::string& source);
 
 	protected:
 		bool event(QEvent* evt) override;
@@ -1,7 +1,16 @@
 #include <lac/analysis/analyze_block.h>
 #include <lac/analysis/scope.h>
+#include <lac/analysis/scope_cache.h>
 #include <lac/analysis/user_defined.h>
+#include <lac/completion/completion.h>
+#include <lac/completion/get_block.h>
 #include <lac/parser/chunk.h>
+#include <lac/parser/offset_positions.h>
+#include <lac/parser/parser.h>
+#include <lac/parser/visitor.h>
+#ifdef WITH_NLOHMANN_JSON
+#include <lac/parser/printer.h>
+#endif
 
 #include <lac/helper/arguments.h>
 #include <lac/helper/test_utils.h>
@@ -40,6 +49,8 @@ namespace lac
 			EXPRESSION_TYPE("'test'", Type::string);
 			EXPRESSION_TYPE("{}", Type::table);
 			EXPRESSION_TYPE("{x=1, 2}", Type::table);
+			EXPRESSION_TYPE("{1, 2}", Type::array);
+			EXPRESSION_TYPE("#{1, 2}", Type::number);
 			EXPRESSION_TYPE("function () end", Type::function);
 
 			// Logical operators
@@ -53,6 +64,14 @@ namespace lac
 			EXPRESSION_TYPE("42 + 3.14", Type::number);
 			EXPRESSION_TYPE("42 + 3 / 2 * 5 // 4", Type::number);
 			EXPRESSION_TYPE("'hello' .. ' world'", Type::string);
+			EXPRESSION_TYPE("1 .. 2 .. 3", Type::string);
+			EXPRESSION_TYPE("2 ^ 3 ^ 2", Type::number);
+			EXPRESSION_TYPE("1 + 2 < 4", Type::boolean);
+			EXPRESSION_TYPE("1 < 2 == true", Type::boolean);
+			EXPRESSION_TYPE("'a' .. 'b' == 'ab'", Type::boolean);
+			EXPRESSION_TYPE("-2 ^ 2 + 1", Type::number);
+			EXPRESSION_TYPE("not 1 == 2", Type::boolean);
+			EXPRESSION_TYPE("1 == 2 or 3 < 4", Type::boolean);
 			EXPRESSION_TYPE("1 or 42", Type::number);
 
 			// Unknown types (depend on the values)
@@ -69,6 +88,8 @@ namespace lac
 			EXPRESSION_TYPE("1 + {}", Type::error);
 			EXPRESSION_TYPE("1 + function() end", Type::error);
 			EXPRESSION_TYPE("2 > 'a'", Type::error);
+			EXPRESSION_TYPE("1 < 2 < 3", Type::error);
+			EXPRESSION_TYPE("'a' .. 'b' + {}", Type::error);
 		}
 
 		TEST_CASE("Simple assignment")
@@ -206,17 +227,37 @@ namespace lac
 
 			auto scope = analyseBlock(block);
 			const auto info = scope.getVariableType("t");
-			REQUIRE(info.type == Type::table);
-			REQUIRE(info.members.size() == 3);
-
-			REQUIRE(info.hasMember("1"));
-			CHECK(info.member("1").type == Type::number);
+			REQUIRE(info.type == Type::array);
+			CHECK(info.members.empty());
+			CHECK(info.elementType().type == Type::unknown); // The values have different types
+		}
 
-			REQUIRE(info.hasMember("2"));
-			CHECK(info.member("2").type == Type::string);
+		TEST_CASE("Table constructor sequence")
+		{
+			ast::Block block;
+			REQUIRE(test_phrase_parser(R"~~(
+t = {{x=1, y=2}, {x=3, y=4, name='b'}}
+nums = {1, 2.5, 0x10}
+a = t[1]
+b = nums[2]
+c = t[1].name
+)~~", parser::chunkRule(), block));
 
-			REQUIRE(info.hasMember("3"));
-			CHECK(info.member("3").type == Type::boolean);
+			auto scope = analyseBlock(block);
+			const auto info = scope.getVariableType("t");
+			REQUIRE(info.type == Type::array);
+			CHECK(info.members.empty());
+			const auto element = info.elementType();
+			REQUIRE(element.type == Type::table);
+			REQUIRE(element.members.size() == 3);
+			CHECK(element.member("x").type == Type::number);
+			CHECK(element.member("y").type == Type::number);
+			CHECK(element.member("name").type == Type::string);
+
+			CHECK(scope.getVariableType("nums").typeName() == "number[]");
+			CHECK(scope.getVariableType("a").type == Type::table);
+			CHECK(scope.getVariableType("b").type == Type::number);
+			CHECK(scope.getVariableType("c").type == Type::string);
 		}
 
 		TEST_CASE("Table constructor varied")
@@ -930,6 +971,280 @@ end
 			}
 		}
 
+		TEST_CASE("Analysis limits")
+		{
+			ast::Block block;
+			REQUIRE(test_phrase_parser("x = 1 do y = 2 do z = {a = {b = 3}} end end w = 'a'", parser::chunkRule(), block));
+
+			AnalysisOptions options;
+			{
+				Scope scope;
+				CHECK(analyseBlock(scope, block, options) == parser::AbortReason::none);
+				CHECK(scope.getVariableType("w").type == Type::string);
+			}
+
+			{
+				options.limits.maxDepth = 3;
+				Scope scope;
+				CHECK(analyseBlock(scope, block, options) == parser::AbortReason::depth);
+				CHECK(scope.getVariableType("x").type == Type::number);
+				CHECK(scope.getVariableType("w").type == Type::nil);
+			}
+
+			{
+				options.limits.maxDepth = 0;
+				options.limits.maxElements = 1;
+				Scope scope;
+				CHECK(analyseBlock(scope, block, options) == parser::AbortReason::elements);
+				CHECK(scope.getVariableType("x").type == Type::number);
+				CHECK(scope.getVariableType("w").type == Type::nil);
+			}
+
+			{
+				options.limits.maxElements = 0;
+				std::atomic<bool> cancel = true;
+				options.limits.cancel = &cancel;
+				Scope scope;
+				CHECK(analyseBlock(scope, block, options) == parser::AbortReason::cancelled);
+				CHECK(scope.getVariableType("x").type == Type::nil);
+			}
+		}
+
+		void checkSameType(const TypeInfo& type, const TypeInfo& expected)
+		{
+			CHECK(type.typeName() == expected.typeName());
+			CHECK(type.functionDefinition() == expected.functionDefinition());
+			if (type.type == Type::array)
+				checkSameType(type.elementType(), expected.elementType());
+			REQUIRE(type.members.size() == expected.members.size());
+			for (auto it = type.members.begin(), expectedIt = expected.members.begin(); it != type.members.end(); ++it, ++expectedIt)
+			{
+				CHECK(it->first == expectedIt->first);
+				checkSameType(it->second, expectedIt->second);
+			}
+		}
+
+		void checkSameScope(const Scope& scope, const Scope& expected)
+		{
+			const auto elements = scope.getElements(), expectedElements = expected.getElements();
+			REQUIRE(elements.size() == expectedElements.size());
+			for (auto it = elements.begin(), expectedIt = expectedElements.begin(); it != elements.end(); ++it, ++expectedIt)
+			{
+				CHECK(it->first == expectedIt->first);
+				checkSameType(it->second.typeInfo, expectedIt->second.typeInfo);
+			}
+			CHECK(scope.isLazy() == expected.isLazy());
+
+			const auto& children = scope.children();
+			const auto& expectedChildren = expected.children();
+			REQUIRE(children.size() == expectedChildren.size());
+			for (size_t i = 0; i < children.size(); ++i)
+				checkSameScope(children[i], expectedChildren[i]);
+		}
+
+		void checkSameBlocks(const Scope& scope, const Scope& expected)
+		{
+			CHECK(scope.block() == expected.block());
+			const auto& children = scope.children();
+			const auto& expectedChildren = expected.children();
+			REQUIRE(children.size() == expectedChildren.size());
+			for (size_t i = 0; i < children.size(); ++i)
+				checkSameBlocks(children[i], expectedChildren[i]);
+		}
+
+		TEST_CASE("Scope cache")
+		{
+			UserDefined user;
+			TypeInfo vec3Type = Type::table;
+			vec3Type.name = "Vector3";
+			vec3Type.members["length"] = "number method()";
+			user.addType(vec3Type);
+			user.addScriptInput("onUpdate", "function(number dt, Vector3 pos)");
+
+			const std::string program = R"~~(
+local n = 42
+t = {x = 1}
+function f(a) local b = a + n return b end
+function g() local s = t.x for i = 1, 10 do local j = i end return s end
+local function h(k) if k then return function() return k end end end
+function onUpdate(delta, position) local l = position:length() end
+)~~";
+			auto shifted = "-- Comment\n" + program;
+			auto modified = shifted;
+			modified.replace(modified.find("local n = 42"), 12, "local n = 'a'");  // f uses n
+			modified.replace(modified.find("return s end"), 12, "return 1 end"); // g is modified
+
+			struct Version
+			{
+				std::string text;
+				size_t hits;
+			};
+			const std::vector<Version> versions = {{program, 0}, {shifted, 4}, {modified, 2}, {modified, 4}};
+
+			ScopeCache cache;
+			Scope previous;
+			for (const auto& [text, hits] : versions)
+			{
+				parser::ParseOptions parseOptions;
+				parseOptions.hashBlocks = true;
+				const auto res = parser::parseBlock(text, parseOptions);
+				REQUIRE(res.parsed);
+
+				Scope scope{res.block}, expected{res.block};
+				scope.setUserDefined(&user);
+				expected.setUserDefined(&user);
+				cache.setPrevious(std::move(previous)); // Its blocks are released, only the new ones are used
+				AnalysisOptions options;
+				options.cache = &cache;
+				CHECK(analyseBlock(scope, res.block, options) == parser::AbortReason::none);
+				analyseBlock(expected, res.block);
+
+				checkSameScope(scope, expected);
+				checkSameBlocks(scope, expected);
+				CHECK(cache.hits() == hits);
+				CHECK(cache.size() == 5); // With the function nested in h
+				previous = std::move(scope);
+			}
+
+			// Nothing is kept from an incomplete analysis
+			const auto res = parser::parseBlock(program);
+			Scope scope{res.block};
+			cache.setPrevious(std::move(previous));
+			AnalysisOptions options;
+			options.cache = &cache;
+			options.limits.maxElements = 3;
+			CHECK(analyseBlock(scope, res.block, options) != parser::AbortReason::none);
+			CHECK(cache.size() == 0);
+		}
+
+		// Count the function bodies, and stop the traversal at the first one if asked
+		class CountFunctions : public ast::Visitor<CountFunctions>
+		{
+		public:
+			CountFunctions(bool stop)
+				: m_stop(stop)
+			{
+			}
+
+			using Visitor::operator();
+
+			bool operator()(const ast::FunctionBody& fb) const
+			{
+				++count;
+				return !m_stop && Visitor::operator()(fb);
+			}
+
+			mutable size_t count = 0;
+
+		private:
+			bool m_stop = false;
+		};
+
+		TEST_CASE("Zero-copy traversal")
+		{
+			const std::string_view program = R"~~(
+local t = {1, 2, x = {y = 3}}
+t[1 + 1] = (t).x.y
+local v = (t[1] + 2) * t.x["y"]
+function t.f(a) return t[a] end
+local g = function(b) return (b) end
+for i = 1, #t do t[i] = (i) end
+if t[1] then print(t[2]) end
+return (t.f)(1)
+)~~";
+			const auto res = parser::parseBlock(program);
+			REQUIRE(res.parsed);
+
+			// Any copy of a node would be allocated in this resource
+			helper::CountingResource resource;
+			ast::ScopedResource scopedResource(&resource);
+
+			CountFunctions counter{false};
+			CHECK(counter(res.block));
+			CHECK(counter.count == 2);
+
+			CountFunctions stopped{true};
+			CHECK_FALSE(stopped(res.block));
+			CHECK(stopped.count == 1);
+
+			CHECK(analyseBlock(res.block).children().size() == 4);
+			CHECK(pos::getChildren(res.block).size() == 5);
+			pos::offsetPositions(res.block, 0);
+#ifdef WITH_NLOHMANN_JSON
+			CHECK_FALSE(toJson(res.block).empty());
+#endif
+			CHECK(resource.allocations == 0);
+		}
+
+		std::string repeat(std::string_view text, size_t count)
+		{
+			std::string result;
+			result.reserve(text.size() * count);
+			for (size_t i = 0; i < count; ++i)
+				result += text;
+			return result;
+		}
+
+		TEST_CASE("Deeply nested code")
+		{
+			// The parser is recursive and needs a large stack, but not the traversals
+			constexpr size_t parserStack = 512 << 20, traversalStack = 256 << 10;
+			constexpr size_t length = 100000, depth = 10000;
+
+			struct Program
+			{
+				std::string text;
+				Type type;           // Of x
+				size_t nestedScopes; // Around the position of "g"
+			};
+			const std::vector<Program> programs = {
+				{"x = " + repeat("- ", length) + "1", Type::number, 0},
+				{"x = 1" + repeat(" + 1", length), Type::number, 0},
+				{"x = 'a'" + repeat(" .. 'a'", length), Type::string, 0},
+				{"x = t" + repeat("[1]", length), Type::nil, 0},
+				{"x = " + repeat("{", depth) + repeat("}", depth), Type::array, 0},
+				{"x = " + repeat("(", depth) + "1" + repeat(")", depth), Type::nil, 0},
+				{"x = " + repeat("t[", depth) + "1" + repeat("]", depth), Type::nil, 0},
+				{"x = " + repeat("f(", depth) + "1" + repeat(")", depth), Type::nil, 0},
+				{"x = " + repeat("function() return ", depth) + "g" + repeat(" end", depth), Type::function, depth},
+				{"x = " + repeat("f(function() return ", depth) + "g()" + repeat(" end)", depth), Type::nil, depth},
+				{repeat("do if x then ", depth) + "g()" + repeat(" end end", depth) + " x = true", Type::boolean, 2 * depth},
+			};
+
+			for (const auto& program : programs)
+			{
+				INFO(program.text.substr(0, 20));
+				std::optional<parser::ParseBlockResults> res;
+				helper::runWithStack(parserStack, [&] { res.emplace(parser::parseBlock(program.text)); });
+				REQUIRE(res->parsed);
+
+				helper::runWithStack(traversalStack, [&] {
+					const auto scope = analyseBlock(res->block);
+					CHECK(scope.getVariableType("x").type == program.type);
+
+					const auto pos = program.text.find('g');
+					const auto blocks = pos::getChildren(res->block);
+					CHECK(blocks.size() == program.nestedScopes + 1);
+					if (program.nestedScopes)
+					{
+						CHECK(pos::getBlockAtPos(blocks, pos) == blocks.back());
+
+						// A single child at each level
+						size_t nestedScopes = 0;
+						auto innermost = &scope;
+						for (; !innermost->children().empty(); innermost = &innermost->children().front())
+							++nestedScopes;
+						CHECK(nestedScopes == program.nestedScopes);
+						CHECK(pos::getScopeAtPos(scope, pos) == innermost);
+					}
+
+					comp::extendBlock(scope, res->positions);
+				});
+
+				helper::runWithStack(parserStack, [&] { res.reset(); });
+			}
+		}
+
 		TEST_SUITE_END();
 	} // namespace an
 #endif
@@ -1,38 +1,65 @@
 #include <lac/analysis/analyze_block.h>
 #include <lac/analysis/scope.h>
+#include <lac/analysis/scope_cache.h>
 #include <lac/analysis/get_type.h>
 #include <lac/analysis/user_defined.h>
 
 #include <lac/parser/ast.h>
+#include <lac/parser/governor.h>
+#include <lac/parser/visitor.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
 
 namespace lac::an
 {
-	class AnalysisVisitor : public boost::static_visitor<void>
+	// Analyse the blocks with an explicit stack of tasks instead of recursion, as generated code can nest blocks,
+	// tables and functions very deeply. The overloads of the nodes schedule the tasks of their children in the order
+	// of the source, and the caller reverses them: the tasks are run in that order, before the ones of the next node.
+	class Analysis : public ast::Dispatcher<Analysis, void>
 	{
 	public:
-		AnalysisVisitor(Scope& scope)
-			: m_scope(scope)
+		Analysis(Scope& scope, parser::Governor* governor = nullptr, const AnalysisOptions* options = nullptr)
+			: m_rootScope(scope)
+			, m_governor(governor)
+			, m_options(options)
 		{
 		}
 
-		void operator()(const ast::ExpressionConstant&) const
+		void analyse(const ast::Block& block) const
 		{
-			// Nothing to do here
+			m_tasks.push_back({Step::block, &block});
+			while (!m_tasks.empty())
+			{
+				const auto task = m_tasks.back();
+				m_tasks.pop_back();
+				if (running())
+					run(task);
+				else if (task.step == Step::closeScope) // Once a limit is reached, only keep the scopes being analysed
+					closeScope();
+			}
 		}
 
-		void operator()(const ast::Numeral&) const
-		{
-			// Nothing to do here
-		}
+		using Dispatcher::operator();
 
-		void operator()(const ast::LiteralString&) const
+		// Expressions: only the functions and the tables are analysed
+		void operator()(ast::ExpressionConstant) const {}
+		void operator()(const ast::Numeral&) const {}
+		void operator()(const ast::LiteralString&) const {}
+		void operator()(ast::Atom) const {}
+		void operator()(const ast::TableIndexName&) const {}
+		void operator()(const ast::EmptyArguments&) const {}
+
+		void operator()(const ast::Expression& ex) const
 		{
-			// Nothing to do here
+			m_tasks.push_back({Step::expression, &ex});
 		}
 
-		void operator()(const std::string&) const
+		void operator()(const ast::ExpressionsList& el) const
 		{
-			// Nothing to do here
+			for (const auto& ex : el)
+				(*this)(ex);
 		}
 
 		void operator()(const ast::UnaryOperation& uo) const
@@ -40,11 +67,6 @@ namespace lac::an
 			(*this)(uo.expression);
 		}
 
-		void operator()(const ast::BinaryOperation& bo) const
-		{
-			(*this)(bo.expression);
-		}
-
 		void operator()(const ast::FieldByExpression& f) const
 		{
 			(*this)(f.key);
@@ -56,149 +78,43 @@ namespace lac::an
 			(*this)(f.value);
 		}
 
-		void operator()(const ast::Field& f) const
-		{
-			boost::apply_visitor(*this, f);
-		}
-
 		void operator()(const ast::TableConstructor& tc) const
 		{
 			if (tc.fields)
-			{
-				for (const auto& f : *tc.fields)
-					(*this)(f);
-			}
+				m_tasks.push_back({Step::table, &tc});
 		}
 
-		void operator()(const ast::FunctionBody& fb, const std::string& functionName = {}) const
+		void operator()(const ast::FunctionBody& fb) const
 		{
-			Scope scope{fb.block, &m_scope};
-			bool isScriptInput = false;
-			if (fb.parameters)
-			{
-				// Test if the function has a defined signature
-				if (!functionName.empty())
-				{
-					const auto userDefined = m_scope.getUserDefined();
-					if (userDefined)
-					{
-						const auto funcType = userDefined->getScriptInput(functionName);
-						if (funcType)
-						{
-							isScriptInput = true;
-
-							// We want to use the given parameter names with the types previously defined
-							const auto& inputParams = funcType->function.parameters;
-							const auto nbInParams = inputParams.size();
-							const auto& funcParams = fb.parameters->parameters;
-							const auto nbFuncParams = funcParams.size();
-							for (size_t i = 0; i < nbFuncParams; ++i)
-							{
-								scope.addVariable(funcParams[i],
-												  i >= nbInParams
-													  ? Type::unknown
-													  : inputParams[i].type());
-							}
-						}
-					}
-				}
-
-				// We do not know the parameter types
-				if (!isScriptInput)
-				{
-					for (const auto& p : fb.parameters->parameters)
-						scope.addVariable(p, Type::unknown);
-
-					if (!functionName.empty())
-						scope.addVariable(functionName, m_scope.getVariableType(functionName)); // The function can be called recursively
-				}
-			}
-
-			analyseBlock(scope, fb.block);
-			m_scope.addChildScope(std::move(scope));
-		}
-
-		void operator()(const ast::Operand& op) const
-		{
-			boost::apply_visitor(*this, op);
-		}
-
-		void operator()(const ast::Expression& ex) const
-		{
-			(*this)(ex.operand);
-			if (ex.binaryOperation)
-				(*this)(*ex.binaryOperation);
+			m_tasks.push_back({Step::function, &fb});
 		}
 
-		void operator()(const ast::ExpressionsList& el) const
-		{
-			for (const auto& ex : el)
-				(*this)(ex);
-		}
-
-		void operator()(const ast::BracketedExpression be) const
+		void operator()(const ast::BracketedExpression& be) const
 		{
 			(*this)(be.expression);
 		}
 
-		void operator()(const ast::TableIndexExpression tie) const
+		void operator()(const ast::TableIndexExpression& tie) const
 		{
 			(*this)(tie.expression);
 		}
 
-		void operator()(const ast::TableIndexName&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::EmptyArguments&) const
-		{
-			// Nothing to do here
-		}
-
 		void operator()(const ast::FunctionCallEnd& fce) const
 		{
-			boost::apply_visitor(*this, fce.arguments);
+			(*this)(fce.arguments);
 		}
 
 		void operator()(const ast::PrefixExpression& pe) const
 		{
-			boost::apply_visitor(*this, pe.start);
+			(*this)(pe.start);
 			for (const auto& pp : pe.rest)
-				boost::apply_visitor(*this, pp);
-		}
-
-		void operator()(const ast::VariableFunctionCall& vfc) const
-		{
-			(*this)(vfc.functionCall);
-			boost::apply_visitor(*this, vfc.postVariable);
-		}
-
-		void operator()(const ast::Variable& v) const
-		{
-			boost::apply_visitor(*this, v.start);
-			for (const auto& vp : v.rest)
-				boost::apply_visitor(*this, vp);
-		}
-
-		void operator()(const ast::FunctionCallPostfix& fcp) const
-		{
-			for (const auto& ti : fcp.tableIndex)
-				boost::apply_visitor(*this, ti);
-			(*this)(fcp.functionCall);
-		}
-
-		void operator()(const ast::FunctionCall& fc) const
-		{
-			boost::apply_visitor(*this, fc.start);
-			for (const auto& r : fc.rest)
-				(*this)(r);
+				(*this)(pp);
 		}
 
+		// Statements
 		void operator()(const ast::ReturnStatement& rs) const
 		{
-			for (const auto& ex : rs.expressions)
-				(*this)(ex);
+			(*this)(rs.expressions);
 		}
 
 		void operator()(const ast::EmptyStatement&) const
@@ -208,6 +124,7 @@ namespace lac::an
 
 		void operator()(const ast::AssignmentStatement& as) const
 		{
+			auto& scope = currentScope();
 			size_t nbV = as.variables.size(), nbE = as.expressions.size();
 			auto varIt = as.variables.begin();
 			for (size_t i = 0; i < nbV; ++i)
@@ -215,19 +132,19 @@ namespace lac::an
 				TypeInfo type;
 				// TODO: support expressions with multiple returns
 				if (i < nbE)
-					type = getType(m_scope, as.expressions[i]);
+					type = getType(scope, as.expressions[i]);
 
 				auto& var = *varIt++;
 
-				if (var.start.get().type() == typeid(std::string))
+				if (var.start.get().type() == typeid(ast::Atom))
 				{
-					const auto& varName = boost::get<std::string>(var.start.get());
+					const auto& varName = boost::get<ast::Atom>(var.start.get());
 					// Named variables
 					if (var.rest.empty())
-						m_scope.addVariable(varName, type);
+						scope.addVariable(varName, type);
 					else
 					{
-						auto& tableType = m_scope.modifyTable(varName);
+						auto& tableType = scope.modifyTable(varName);
 						auto* memberType = &tableType;
 
 						// Table member
@@ -256,13 +173,23 @@ namespace lac::an
 			}
 
 			// Visit expressions, add child scopes
-			for (const auto& e : as.expressions)
-				(*this)(e);
+			(*this)(as.expressions);
+		}
+
+		void operator()(const ast::FunctionCall& fc) const
+		{
+			(*this)(fc.start);
+			for (const auto& fcp : fc.rest)
+			{
+				for (const auto& ti : fcp.tableIndex)
+					(*this)(ti);
+				(*this)(fcp.functionCall);
+			}
 		}
 
 		void operator()(const ast::LabelStatement& ls) const
 		{
-			m_scope.addLabel(ls.name);
+			currentScope().addLabel(ls.name);
 		}
 
 		void operator()(const ast::GotoStatement&) const
@@ -276,47 +203,44 @@ namespace lac::an
 
 		void operator()(const ast::DoStatement& ds) const
 		{
-			m_scope.addChildScope(analyseBlock(ds.block, &m_scope));
+			analyseChild(ds.block);
 		}
 
 		void operator()(const ast::WhileStatement& ws) const
 		{
-			m_scope.addChildScope(analyseBlock(ws.block, &m_scope));
+			analyseChild(ws.block);
 		}
 
 		void operator()(const ast::RepeatStatement& rs) const
 		{
-			m_scope.addChildScope(analyseBlock(rs.block, &m_scope));
+			analyseChild(rs.block);
 		}
 
 		void operator()(const ast::IfThenElseStatement& s) const
 		{
-			m_scope.addChildScope(analyseBlock(s.first.block, &m_scope));
+			analyseChild(s.first.block);
 			for (const auto& es : s.rest)
-				m_scope.addChildScope(analyseBlock(es.block, &m_scope));
+				analyseChild(es.block);
 			if (s.elseBlock)
-				m_scope.addChildScope(analyseBlock(*s.elseBlock, &m_scope));
+				analyseChild(*s.elseBlock);
 		}
 
 		void operator()(const ast::NumericalForStatement& s) const
 		{
-			Scope scope{s.block, &m_scope};
-			scope.addVariable(s.variable, Type::number);
-			analyseBlock(scope, s.block);
-			m_scope.addChildScope(std::move(scope));
+			openScope(s.block).addVariable(s.variable, Type::number);
 		}
 
 		void operator()(const ast::GenericForStatement& s) const
 		{
-			Scope scope{s.block, &m_scope};
+			auto& scope = currentScope();
 			if (s.expressions.empty())
 			{
 				for (const auto& var : s.variables)
-					m_scope.addVariable(var, {});
+					scope.addVariable(var, {});
 			}
 			else
 			{
-				const auto iterType = getType(m_scope, s.expressions.front());
+				const auto iterType = getType(scope, s.expressions.front());
 				size_t nbV = s.variables.size();
 				if (iterType.type == Type::function)
 				{
@@ -327,34 +251,33 @@ namespace lac::an
 						TypeInfo type;
 						if (i < nbR)
 							type = res[i];
-						m_scope.addVariable(s.variables[i], type);
+						scope.addVariable(s.variables[i], type);
 					}
 				}
 				else
 				{
 					for (const auto& var : s.variables)
-						m_scope.addVariable(var, {});
+						scope.addVariable(var, {});
 				}
 			}
 
-			analyseBlock(scope, s.block);
-			m_scope.addChildScope(std::move(scope));
+			openScope(s.block);
 		}
 
 		void operator()(const ast::FunctionDeclarationStatement& s) const
 		{
-			auto funcType = getType(m_scope, s.body);
+			auto& scope = currentScope();
+			auto funcType = getType(scope, s.body);
 
 			// Global function
 			if (s.name.rest.empty() && !s.name.member)
 			{
-				m_scope.addVariable(s.name.start, std::move(funcType));
-				(*this)(s.body, s.name.start);
-				return;
+				scope.addVariable(s.name.start, std::move(funcType));
+				return analyseFunction(s.body, s.name.start);
 			}
 
 			// Declaration of a table function or method
-			auto& tableType = m_scope.modifyTable(s.name.start);
+			auto& tableType = scope.modifyTable(s.name.start);
 			auto* memberType = &tableType;
 
 			// Table member
@@ -372,22 +295,23 @@ namespace lac::an
 				*memberType = funcType;
 			}
 			
-			(*this)(s.body); // Visit the body scope
+			analyseFunction(s.body, {}); // Visit the body scope
 		}
 
 		void operator()(const ast::LocalFunctionDeclarationStatement& s) const
 		{
-			auto funcType = getType(m_scope, s.body);
-			m_scope.addVariable(s.name, std::move(funcType));
-			(*this)(s.body, s.name);
+			auto funcType = getType(currentScope(), s.body);
+			currentScope().addVariable(s.name, std::move(funcType));
+			analyseFunction(s.body, s.name);
 		}
 
 		void operator()(const ast::LocalAssignmentStatement& s) const
 		{
+			auto& scope = currentScope();
 			if (!s.expressions)
 			{
 				for (const auto& v : s.variables)
-					m_scope.addVariable(v, {Type::unknown});
+					scope.addVariable(v, {Type::unknown});
 			}
 			else
 			{
@@ -398,31 +322,241 @@ namespace lac::an
 					TypeInfo type;
 					// TODO: support expressions with multiple returns
 					if (i < nbE)
-						type = getType(m_scope, expressions[i]);
-					m_scope.addVariable(s.variables[i], type);
+						type = getType(scope, expressions[i]);
+					scope.addVariable(s.variables[i], type);
 				}
 
 				// Visit expressions, add child scopes
-				for (const auto& e : *s.expressions)
-					(*this)(e);
+				(*this)(expressions);
+			}
+		}
+
+	private:
+		enum class Step
+		{
+			block,      // Statement index of the block, then its return statement
+			childBlock, // Open the scope of the block, then analyse it
+			closeScope, // Add the current scope to its parent
+			expression, // Schedule the operands
+			table,      // Field index of the table
+			function,   // Open the scope of the function, then analyse its block
+		};
+
+		struct Task
+		{
+			Step step;
+			const void* node;
+			size_t index = 0;
+		};
+
+		void run(const Task& task) const
+		{
+			switch (task.step)
+			{
+			case Step::block:
+				return block(*static_cast<const ast::Block*>(task.node), task.index);
+
+			case Step::childBlock:
+				return inOrder([&] { openScope(*static_cast<const ast::Block*>(task.node)); });
+
+			case Step::closeScope:
+				return closeScope();
+
+			case Step::expression:
+				return inOrder([&] {
+					const auto& ex = *static_cast<const ast::Expression*>(task.node);
+					(*this)(ex.operand);
+					for (const auto& bo : ex.binaryOperations)
+						(*this)(bo.operand);
+				});
+
+			case Step::table:
+				return table(*static_cast<const ast::TableConstructor*>(task.node), task.index);
+
+			case Step::function:
+				return inOrder([&] { analyseFunction(*static_cast<const ast::FunctionBody*>(task.node), {}); });
+
+			default:
+				return;
 			}
 		}
 
-		void operator()(const ast::Block& b) const
+		void block(const ast::Block& b, size_t index) const
 		{
-			for (const auto& s : b.statements)
-				boost::apply_visitor(*this, s);
-			if (b.returnStatement)
-				(*this)(*b.returnStatement);
+			if (!index && !enter())
+				return;
+
+			const auto nbStatements = b.statements.size();
+			if (index < nbStatements)
+			{
+				if (!count())
+					return;
+				return inOrder([&] {
+					(*this)(b.statements[index]);
+					m_tasks.push_back({Step::block, &b, index + 1});
+				});
+			}
+
+			if (index == nbStatements && b.returnStatement)
+			{
+				if (!count())
+					return;
+				return inOrder([&] {
+					(*this)(*b.returnStatement);
+					m_tasks.push_back({Step::block, &b, index + 1});
+				});
+			}
+
+			exit();
 		}
 
-	private:
-		Scope& m_scope;
+		void table(const ast::TableConstructor& tc, size_t index) const
+		{
+			if (!index && !enter())
+				return;
+
+			const auto& fields = *tc.fields;
+			if (index == fields.size())
+				return exit();
+			if (!count())
+				return;
+
+			inOrder([&] {
+				(*this)(fields[index]);
+				m_tasks.push_back({Step::table, &tc, index + 1});
+			});
+		}
+
+		void analyseFunction(const ast::FunctionBody& fb, ast::Atom functionName) const
+		{
+			auto& parentScope = currentScope();
+			if (m_options && m_options->cache && m_scopes.size() < ScopeCache::maxDepth)
+			{
+				if (auto scope = m_options->cache->reuse(fb, functionName, parentScope))
+					return parentScope.addChildScope(std::move(*scope));
+			}
+
+			auto& scope = openScope(fb.block);
+			scope.setLazy(fb.lazy.is_initialized());
+			bool isScriptInput = false;
+			if (fb.parameters)
+			{
+				// Test if the function has a defined signature
+				if (!functionName.empty())
+				{
+					const auto userDefined = parentScope.getUserDefined();
+					if (userDefined)
+					{
+						const auto funcType = userDefined->getScriptInput(functionName);
+						if (funcType)
+						{
+							isScriptInput = true;
+
+							// We want to use the given parameter names with the types previously defined
+							const auto& inputParams = funcType->function.parameters;
+							const auto nbInParams = inputParams.size();
+							const auto& funcParams = fb.parameters->parameters;
+							const auto nbFuncParams = funcParams.size();
+							for (size_t i = 0; i < nbFuncParams; ++i)
+							{
+								scope.addVariable(funcParams[i],
+												  i >= nbInParams
+													  ? Type::unknown
+													  : inputParams[i].type());
+							}
+						}
+					}
+				}
+
+				// We do not know the parameter types
+				if (!isScriptInput)
+				{
+					for (const auto& p : fb.parameters->parameters)
+						scope.addVariable(p, Type::unknown);
+
+					if (!functionName.empty())
+						scope.addVariable(functionName, parentScope.getVariableType(functionName)); // The function can be called recursively
+				}
+			}
+		}
+
+		void analyseChild(const ast::Block& block) const
+		{
+			m_tasks.push_back({Step::childBlock, &block});
+		}
+
+		// The new scope is analysed by the next tasks, then added to its parent
+		Scope& openScope(const ast::Block& block) const
+		{
+			auto& scope = m_scopes.emplace_back(block, &currentScope());
+			m_tasks.push_back({Step::block, &block});
+			m_tasks.push_back({Step::closeScope, nullptr});
+			return scope;
+		}
+
+		void closeScope() const
+		{
+			auto scope = std::move(m_scopes.back());
+			m_scopes.pop_back();
+			currentScope().addChildScope(std::move(scope));
+		}
+
+		Scope& currentScope() const
+		{
+			return m_scopes.empty() ? m_rootScope : m_scopes.back();
+		}
+
+		// Schedule the tasks pushed by the function in the order they are pushed
+		template <typename Schedule>
+		void inOrder(const Schedule& schedule) const
+		{
+			const auto first = m_tasks.size();
+			schedule();
+			std::reverse(m_tasks.begin() + first, m_tasks.end());
+		}
+
+		// The checks of the governor, if any: the analysis stops once a limit is reached
+		bool enter() const
+		{
+			return !m_governor || m_governor->enter();
+		}
+
+		void exit() const
+		{
+			if (m_governor)
+				m_governor->exit();
+		}
+
+		bool count() const
+		{
+			return !m_governor || m_governor->count();
+		}
+
+		bool running() const
+		{
+			return !m_governor || m_governor->reason() == parser::AbortReason::none;
+		}
+
+		Scope& m_rootScope;
+		parser::Governor* m_governor = nullptr;
+		const AnalysisOptions* m_options = nullptr;
+		mutable std::vector<Task> m_tasks;
+		mutable std::deque<Scope> m_scopes; // Being analysed, the current one last
 	};
 
 	void analyseBlock(Scope& scope, const ast::Block& block)
 	{
-		AnalysisVisitor{scope}(block);
+		Analysis{scope}.analyse(block);
+	}
+
+	parser::AbortReason analyseBlock(Scope& scope, const ast::Block& block, const AnalysisOptions& options)
+	{
+		std::atomic<size_t> elements = 0;
+		parser::Governor governor{options.limits, elements};
+		Analysis{scope, &governor, &options}.analyse(block);
+		if (options.cache)
+			options.cache->update(scope, governor.reason() == parser::AbortReason::none);
+		return governor.reason();
 	}
 
 	Scope analyseBlock(const ast::Block& block, Scope* parentScope)
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <lac/analysis/scope.h>
+#include <lac/core_api.h>
+#include <lac/parser/governor.h>
 
 namespace lac
 {
@@ -10,7 +12,20 @@ namespace lac
 	}
 	namespace an
 	{
-		void analyseBlock(Scope& scope, const ast::Block& block);
-		Scope analyseBlock(const ast::Block& block, Scope* parentScope = nullptr);
+		class ScopeCache;
+
+		CORE_API void analyseBlock(Scope& scope, const ast::Block& block);
+		CORE_API Scope analyseBlock(const ast::Block& block, Scope* parentScope = nullptr);
+
+		struct AnalysisOptions
+		{
+			parser::Limits limits; // Stop the analysis early on pathological inputs
+
+			// Reuse the scopes of the unchanged function bodies from the previous analysis, and keep the new ones
+			ScopeCache* cache = nullptr;
+		};
+
+		// Returns the reason why the analysis was stopped, the scope then only contains the statements analysed before
+		CORE_API parser::AbortReason analyseBlock(Scope& scope, const ast::Block& block, const AnalysisOptions& options);
 	} // namespace an
 } // namespace lac
@@ -0,0 +1,295 @@
+#include <lac/analysis/data_type.h>
+#include <lac/parser/chunk.h>
+#include <lac/parser/numeral.h>
+#include <lac/parser/scan.h>
+#include <lac/parser/symbols.h>
+
+#ifdef WITH_TESTS
+#include <lac/analysis/get_type.h>
+#include <lac/analysis/scope.h>
+#include <lac/parser/ast.h>
+#include <lac/parser/parser.h>
+#include <doctest/doctest.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace lac::an
+{
+	namespace
+	{
+		namespace x3 = boost::spirit::x3;
+
+		// Parse a value and set its type, chosen from its first token.
+		// The types of the fields of a table are added to it as they are parsed, then the field is discarded.
+		struct data_type_parser : x3::parser<data_type_parser>
+		{
+			using attribute_type = TypeInfo;
+			static const bool has_attribute = true;
+
+			template <typename Iterator, typename Context, typename RContext, typename Attribute>
+			bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+			{
+				x3::skip_over(first, last, context);
+				if (first == last)
+					return false;
+
+				const auto begin = &*first, end = begin + (last - first);
+				const auto skipTo = [&first, begin](const char* next, Type type, TypeInfo& info) {
+					if (!next)
+						return false;
+					first += next - begin;
+					info = type;
+					return true;
+				};
+
+				switch (*first)
+				{
+				case '{':
+					return parseTable(first, last, context, rcontext, attr);
+				case '"':
+				case '\'':
+					return skipTo(scan::skipQuotedString(begin, end), Type::string, attr);
+				case '[':
+					return skipTo(scan::skipLongString(begin, end), Type::string, attr);
+				case '-': // Only before a numeral, which is then not a comment
+				{
+					const auto save = first;
+					++first;
+					x3::skip_over(first, last, context);
+					if (first != last && parseNumeral(first, last, attr))
+						return true;
+					first = save;
+					return false;
+				}
+				default:
+					if (scan::isNameFirstLetter(*first))
+					{
+						const std::string_view word(begin, scan::skipName(begin + 1, end) - begin);
+						if (word == "nil")
+							return skipTo(begin + word.size(), Type::nil, attr);
+						if (word == "true" || word == "false")
+							return skipTo(begin + word.size(), Type::boolean, attr);
+						return false; // A variable
+					}
+					return parseNumeral(first, last, attr);
+				}
+			}
+
+		private:
+			template <typename Iterator>
+			static bool parseNumeral(Iterator& first, const Iterator& last, TypeInfo& attr)
+			{
+				const auto scan = lac::parser::scanNumeral({&*first, static_cast<size_t>(last - first)});
+				if (!scan.size)
+					return false;
+				first += scan.size;
+				attr = Type::number;
+				return true;
+			}
+
+			// Same type as GetType: an array for a sequence, otherwise the named fields and the positional ones,
+			// but not the fields by expression
+			template <typename Iterator, typename Context, typename RContext>
+			bool parseTable(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, TypeInfo& attr) const
+			{
+				const auto save = first;
+				++first; // '{'
+				attr = Type::table;
+				bool sequence = true;
+				std::vector<std::pair<TypeInfo, size_t>> values; // Runs of positional values of the same type
+				TypeInfo field;
+				while (true)
+				{
+					x3::skip_over(first, last, context);
+					if (first == last)
+						break;
+					if (*first == '}')
+					{
+						++first;
+						setPositionalFields(attr, std::move(values), sequence);
+						return true;
+					}
+
+					const auto fieldStart = first;
+					if (const auto name = parseFieldName(first, last, context))
+					{
+						if (!parse(first, last, context, rcontext, field))
+							break;
+						attr.members.insert_or_assign(ast::Atom(*name), std::move(field));
+						sequence = false;
+					}
+					else if (first = fieldStart; parseFieldKey(first, last, context, rcontext))
+					{
+						if (!parse(first, last, context, rcontext, field))
+							break;
+						sequence = false;
+					}
+					else if (first = fieldStart; parse(first, last, context, rcontext, field))
+					{
+						if (!values.empty() && sameType(values.back().first, field))
+							++values.back().second;
+						else
+							values.emplace_back(std::move(field), 1);
+					}
+					else
+						break;
+
+					x3::skip_over(first, last, context);
+					if (first != last && (*first == ',' || *first == ';'))
+						++first;
+					else if (first == last || *first != '}')
+						break;
+				}
+
+				first = save;
+				return false;
+			}
+
+			static bool sameType(const TypeInfo& lhs, const TypeInfo& rhs)
+			{
+				if (lhs.type != rhs.type || lhs.name != rhs.name || lhs.members.size() != rhs.members.size()
+					|| !lhs.element != !rhs.element || (lhs.element && !sameType(*lhs.element, *rhs.element)))
+					return false;
+				return std::equal(lhs.members.begin(), lhs.members.end(), rhs.members.begin(), [](const auto& lhs, const auto& rhs) {
+					return lhs.first == rhs.first && sameType(lhs.second, rhs.second);
+				});
+			}
+
+			static void setPositionalFields(TypeInfo& attr, std::vector<std::pair<TypeInfo, size_t>> values, bool sequence)
+			{
+				if (values.empty())
+					return;
+
+				if (sequence)
+				{
+					auto element = std::move(values.front().first);
+					for (auto it = std::next(values.begin()); it != values.end(); ++it)
+						widenType(element, it->first);
+					attr = TypeInfo::createArray(std::move(element));
+					return;
+				}
+
+				size_t index = 1;
+				for (const auto& [value, count] : values)
+				{
+					for (size_t i = 0; i < count; ++i)
+						attr.members.insert_or_assign(ast::Atom(std::to_string(index++)), value);
+				}
+			}
+
+			// "name =", but not "name =="
+			template <typename Iterator, typename Context>
+			static std::optional<std::string_view> parseFieldName(Iterator& first, const Iterator& last, const Context& context)
+			{
+				if (!scan::isNameFirstLetter(*first))
+					return {};
+				const auto begin = &*first;
+				const std::string_view name(begin, scan::skipName(begin + 1, begin + (last - first)) - begin);
+				if (lac::parser::symbols::keywords.find(name))
+					return {};
+				first += name.size();
+				x3::skip_over(first, last, context);
+				if (first == last || *first != '=' || (first + 1 != last && first[1] == '='))
+					return {};
+				++first;
+				return name;
+			}
+
+			// "[key] =", with a key of any data type
+			template <typename Iterator, typename Context, typename RContext>
+			bool parseFieldKey(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext) const
+			{
+				if (*first != '[' || scan::longBracketLevel(&*first, &*first + (last - first)) >= 0)
+					return false; // Or a long string
+				++first; // '['
+				TypeInfo key;
+				if (!parse(first, last, context, rcontext, key))
+					return false;
+				x3::skip_over(first, last, context);
+				if (first == last || *first != ']')
+					return false;
+				++first;
+				x3::skip_over(first, last, context);
+				if (first == last || *first != '=')
+					return false;
+				++first;
+				return true;
+			}
+		};
+
+		const auto dataChunk = parser::word_parser("return") >> data_type_parser{} >> -x3::lit(';');
+	} // namespace
+
+	std::optional<TypeInfo> getDataType(std::string_view program)
+	{
+		TypeInfo type;
+		auto f = program.begin();
+		const auto l = program.end();
+		if (!x3::phrase_parse(f, l, dataChunk, parser::skipperRule(), type) || f != l)
+			return {};
+		return type;
+	}
+
+#ifdef WITH_TESTS
+	namespace
+	{
+		void checkSameType(const TypeInfo& type, const TypeInfo& expected)
+		{
+			CHECK(type.type == expected.type);
+			CHECK(type.typeName() == expected.typeName());
+			if (type.type == Type::array)
+				checkSameType(type.elementType(), expected.elementType());
+			REQUIRE(type.members.size() == expected.members.size());
+			for (auto it = type.members.begin(), expectedIt = expected.members.begin(); it != type.members.end(); ++it, ++expectedIt)
+			{
+				CHECK(it->first == expectedIt->first);
+				checkSameType(it->second, expectedIt->second);
+			}
+		}
+
+		void test_data_type(std::string_view program)
+		{
+			const auto type = getDataType(program);
+			REQUIRE(type);
+			const auto res = parser::parseBlock(program);
+			REQUIRE(res.parsed);
+			REQUIRE(res.block.returnStatement);
+			checkSameType(*type, getType(Scope{}, res.block.returnStatement->expressions.front()));
+		}
+	} // namespace
+
+	TEST_CASE("data type")
+	{
+		test_data_type("return 42");
+		test_data_type("return {}");
+		test_data_type("return {1, -2.5, 0x1F, 'str', \"str\", [[long]], [==[long]==], nil, true, false}");
+		test_data_type("return {1, -2.5, 0x1F}");
+		test_data_type("return {{x = 1, y = 2}, {x = 3, z = 'a'}, {x = 4, y = true}}");
+		test_data_type("return {[1] = 'a', [2] = 'b'}");
+		test_data_type("return {1, 2, n = 2}");
+		test_data_type(R"~~(-- Configuration
+return {
+	name = "config", --[[ comment ]] version = 3;
+	flags = {true, false, debug = false},
+	items = {
+		{id = 1, tags = {'a', 'b'}, [1] = 'key', ["x"] = {}},
+		{id = 2, tags = {}, parent = {id = 1}},
+	},
+	name = 42, -- The last one is kept
+};
+)~~");
+
+		// Not only data
+		for (const auto program : {"", "return", "x = 1", "local t = {} return t", "return {x = y}", "return {f()}",
+								   "return {1 + 2}", "return {'a' .. 'b'}", "return {x == 1}", "return {true = 1}",
+								   "return {x = function() end}", "return {1, 2", "return {[1] 2}", "return {} x = 1",
+								   "return {}, {}", "return -'1'", "return {1 2}"})
+		{
+			CHECK_FALSE(getDataType(program));
+		}
+	}
+#endif
+} // namespace lac::an
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <lac/analysis/type_info.h>
+#include <lac/core_api.h>
+
+#include <optional>
+#include <string_view>
+
+namespace lac::an
+{
+	// Type of the value returned by a data-only chunk: "return" followed by a table of constants, numerals,
+	// literal strings and other tables. It is built during the parse, without creating the tree,
+	// and is the same as the type of the returned expression after a complete parse and analysis.
+	// Returns nothing if the chunk contains anything else.
+	CORE_API std::optional<TypeInfo> getDataType(std::string_view program);
+} // namespace lac::an
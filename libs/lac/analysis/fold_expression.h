@@ -0,0 +1,71 @@
+#pragma once
+
+#include <lac/analysis/get_type.h>
+#include <lac/parser/ast.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace lac::an
+{
+	// Type of operands separated by binary operators: operand(i) returns the type of the operand i,
+	// operation(i) the operator between the operands i and i + 1.
+	// Apply the precedence of the operators with a stack of operands, without recursion.
+	template <typename GetOperand, typename GetOperation>
+	TypeInfo foldExpression(size_t nbOperations, const GetOperand& operand, const GetOperation& operation)
+	{
+		auto first = operand(0);
+		if (!nbOperations)
+			return first;
+
+		// Common case of a chain with a single precedence level: no stack needed
+		const auto prec = ast::precedence(operation(0));
+		bool samePrecedence = true;
+		for (size_t i = 1; i < nbOperations && samePrecedence; ++i)
+			samePrecedence = ast::precedence(operation(i)) == prec;
+		if (samePrecedence && !ast::isRightAssociative(operation(0)))
+		{
+			for (size_t i = 0; i < nbOperations; ++i)
+				first = binaryOperationType(first, operation(i), operand(i + 1));
+			return first;
+		}
+		if (samePrecedence)
+		{
+			auto right = operand(nbOperations);
+			for (auto i = nbOperations - 1; i > 0; --i)
+				right = binaryOperationType(operand(i), operation(i), right);
+			return binaryOperationType(first, operation(0), right);
+		}
+
+		std::vector<TypeInfo> operands;
+		std::vector<ast::Operation> operators;
+		operands.reserve(nbOperations + 1);
+		operators.reserve(nbOperations);
+		operands.push_back(std::move(first));
+
+		auto reduce = [&] {
+			auto right = std::move(operands.back());
+			operands.pop_back();
+			operands.back() = binaryOperationType(operands.back(), operators.back(), right);
+			operators.pop_back();
+		};
+
+		for (size_t i = 0; i < nbOperations; ++i)
+		{
+			const auto current = ast::precedence(operation(i));
+			while (!operators.empty())
+			{
+				const auto top = ast::precedence(operators.back());
+				if (top < current || (top == current && ast::isRightAssociative(operation(i))))
+					break;
+				reduce();
+			}
+			operators.push_back(operation(i));
+			operands.push_back(operand(i + 1));
+		}
+
+		while (!operators.empty())
+			reduce();
+		return std::move(operands.front());
+	}
+} // namespace lac::an
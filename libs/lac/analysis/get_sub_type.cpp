@@ -2,10 +2,11 @@
 #include <lac/analysis/get_type.h>
 #include <lac/analysis/scope.h>
 #include <lac/parser/ast.h>
+#include <lac/parser/visitor.h>
 
 namespace lac::an
 {
-	class GetSubType : public boost::static_visitor<TypeInfo>
+	class GetSubType : public ast::Dispatcher<GetSubType, TypeInfo>
 	{
 	public:
 		GetSubType(const Scope& scope, const TypeInfo& parentType)
@@ -14,16 +15,18 @@ namespace lac::an
 		{
 		}
 
-		TypeInfo operator()(const ast::PostPrefix& pp) const
+		using Dispatcher::operator();
+
+		TypeInfo operator()(const ast::TableIndexExpression& tie) const
 		{
-			return boost::apply_visitor(*this, pp);
+			return index(getType(m_scope, tie.expression));
 		}
 
-		TypeInfo operator()(const ast::TableIndexExpression& tie) const
+		TypeInfo index(const TypeInfo& keyType) const
 		{
 			const auto parent = parentAsVariable();
-			if (parent.type == Type::array && getType(m_scope, tie.expression).type == Type::number)
-				return TypeInfo::fromTypeName(parent.name);
+			if (parent.type == Type::array && keyType.type == Type::number)
+				return parent.elementType();
 
 			return {};
 		}
@@ -48,11 +51,6 @@ namespace lac::an
 			return type.function.results.front(); // TODO: return all results
 		}
 
-		TypeInfo operator()(const ast::VariablePostfix& vp) const
-		{
-			return boost::apply_visitor(*this, vp);
-		}
-
 		TypeInfo operator()(const ast::VariableFunctionCall& vfc) const
 		{
 			const auto funcType = getSubType(m_scope, m_parentType, vfc.functionCall);
@@ -91,4 +89,9 @@ namespace lac::an
 		return GetSubType{scope, parentType}(fce);
 	}
 
+	TypeInfo getIndexedType(const Scope& scope, const TypeInfo& parentType, const TypeInfo& keyType)
+	{
+		return GetSubType{scope, parentType}.index(keyType);
+	}
+
 } // namespace lac::an
@@ -16,4 +16,5 @@ namespace lac::an
 	TypeInfo getSubType(const Scope& scope, const TypeInfo& parentType, const ast::PostPrefix& pp);
 	TypeInfo getSubType(const Scope& scope, const TypeInfo& parentType, const ast::VariablePostfix& vp);
 	TypeInfo getSubType(const Scope& scope, const TypeInfo& parentType, const ast::FunctionCallEnd& fce);
+	TypeInfo getIndexedType(const Scope& scope, const TypeInfo& parentType, const TypeInfo& keyType); // For a key already evaluated
 } // namespace lac::an
@@ -1,11 +1,19 @@
 #include <lac/analysis/get_type.h>
+#include <lac/analysis/fold_expression.h>
 #include <lac/analysis/get_sub_type.h>
 #include <lac/analysis/scope.h>
 #include <lac/parser/ast.h>
+#include <lac/parser/visitor.h>
+
+#include <algorithm>
+#include <vector>
 
 namespace lac::an
 {
-	class GetType : public boost::static_visitor<TypeInfo>
+	// Evaluate the type of an expression with explicit stacks, as generated code can nest expressions very deeply.
+	// The tasks are run in LIFO order, and each one leaves the type it computes on the stack of values.
+	// The overloads of the operands only schedule their evaluation.
+	class GetType : public ast::Dispatcher<GetType, void>
 	{
 	public:
 		GetType(const Scope& scope)
@@ -13,229 +21,392 @@ namespace lac::an
 		{
 		}
 
-		TypeInfo operator()(ast::ExpressionConstant ec) const
+		// A nested evaluation, from a callback of a function type, works above the stacks of the current one
+		TypeInfo evaluate(const ast::Expression& e) const
 		{
-			using EC = ast::ExpressionConstant;
-			switch (ec)
+			const auto nbTasks = m_tasks.size(), nbValues = m_values.size();
+			try
 			{
-			case EC::nil:
-				return Type::nil;
+				schedule(e);
+				while (m_tasks.size() > nbTasks)
+				{
+					const auto task = m_tasks.back();
+					m_tasks.pop_back();
+					run(task);
+				}
+			}
+			catch (...)
+			{
+				m_tasks.resize(nbTasks);
+				m_values.resize(nbValues);
+				throw;
+			}
 
-			case EC::dots:
-				return Type::unknown;
+			auto type = std::move(m_values.back());
+			m_values.pop_back();
+			return type;
+		}
 
-			case EC::False:
-			case EC::True:
-				return Type::boolean;
+		using Dispatcher::operator();
 
-			default:
-				return Type::error;
-			}
+		void operator()(ast::ExpressionConstant ec) const
+		{
+			m_values.push_back(constantType(ec));
 		}
 
-		TypeInfo operator()(const ast::Numeral&) const
+		void operator()(const ast::Numeral&) const
 		{
-			return Type::number;
+			m_values.push_back(Type::number);
 		}
 
-		TypeInfo operator()(const ast::LiteralString&) const
+		void operator()(const ast::LiteralString&) const
 		{
-			return Type::string;
+			m_values.push_back(Type::string);
 		}
 
-		TypeInfo operator()(const std::string& str) const
+		void operator()(ast::Atom name) const
 		{
 			TypeInfo type = Type::unknown;
-			type.name = str;
-			return type;
+			type.name = name.str();
+			m_values.push_back(std::move(type));
 		}
 
-		TypeInfo operator()(const ast::UnaryOperation& uo) const
+		void operator()(const ast::UnaryOperation& uo) const
 		{
-			const auto right = (*this)(uo.expression);
+			m_tasks.push_back({Step::unary, &uo});
+			m_tasks.push_back({Step::expression, &uo.expression});
+		}
 
-			using OP = ast::Operation;
-			switch (uo.operation)
+		void operator()(const ast::TableConstructor& tc) const
+		{
+			if (!tc.fields || tc.fields->empty())
 			{
-			case OP::unm:
-			case OP::bnot:
-				return right.convert(Type::number);
-
-			case OP::len:
-				return (right.type == Type::string || right.type == Type::table)
-						   ? Type::number
-						   : Type::error;
-
-			case OP::lnot:
-				return Type::boolean;
-
-			default:
-				return Type::error;
+				m_values.push_back(Type::table);
+				return;
 			}
-		}
 
-		TypeInfo operator()(const ast::TableConstructor& tc) const
-		{
-			TypeInfo info{Type::table};
-			if (!tc.fields)
-				return info;
+			// A sequence is an array, with the type of all its values
+			const auto& fields = *tc.fields;
+			const auto sequence = std::all_of(fields.begin(), fields.end(), [](const ast::Field& field) {
+				return field.get().type() == typeid(ast::Expression);
+			});
+			m_tasks.push_back({sequence ? Step::sequence : Step::table, &tc});
 
-			int fieldIndex = 1;
-			for (const ast::Field& field : *tc.fields)
+			// The values of the fields, in reverse order to be evaluated in order
+			for (auto it = fields.rbegin(); it != fields.rend(); ++it)
 			{
-				const auto& fieldType = field.get().type();
+				const auto& fieldType = it->get().type();
 				if (fieldType == typeid(ast::FieldByAssignment))
-				{
-					const auto& assignment = boost::get<ast::FieldByAssignment>(field.get());
-					info.members[assignment.name] = getType(m_scope, assignment.value);
-				}
+					m_tasks.push_back({Step::expression, &boost::get<ast::FieldByAssignment>(it->get()).value});
 				else if (fieldType == typeid(ast::Expression))
-				{
-					const auto& expression = boost::get<ast::Expression>(field.get());
-					const auto fieldName = std::to_string(fieldIndex++);
-					info.members[fieldName] = getType(m_scope, expression);
-				}
+					m_tasks.push_back({Step::expression, &boost::get<ast::Expression>(it->get())});
 				// TODO support field by expression
 			}
+		}
 
-			return info;
+		void operator()(const ast::FunctionBody& fb) const
+		{
+			m_values.push_back(functionType(fb));
+		}
+
+		void operator()(const ast::BracketedExpression& be) const
+		{
+			m_tasks.push_back({Step::expression, &be.expression});
 		}
 
-		TypeInfo operator()(const ast::FunctionBody& fb) const
+		void operator()(const ast::PrefixExpression& pe) const
+		{
+			m_tasks.push_back({Step::postfixes, &pe});
+			(*this)(pe.start);
+		}
+
+		TypeInfo functionType(const ast::FunctionBody& fb) const
 		{
 			TypeInfo info{Type::function};
 			if (fb.parameters && !fb.parameters->parameters.empty())
 			{
 				const auto& params = fb.parameters->parameters;
 				size_t i = 0;
-				if (params.front() == "self")
+				static const ast::Atom self{"self"};
+				if (params.front() == self)
 				{
 					info.function.isMethod = true;
 					++i; // Ignore this parameter
 				}
 
 				for (size_t nb = params.size(); i<nb; ++i)
-					info.function.parameters.emplace_back(params[i]);
+					info.function.parameters.emplace_back(params[i].str());
 			}
 			// TODO: fill the function results
 			return info;
 		}
 
-		TypeInfo operator()(const ast::BracketedExpression& be) const
+	private:
+		enum class Step
+		{
+			expression, // Schedule the operands and the fold
+			operand,    // Dispatch the operand to its overload
+			fold,       // Apply the binary operations to the types of the operands
+			unary,      // Apply the unary operation to the type of its expression
+			sequence,   // Array of the types of the values
+			table,      // Members of the types of the named and positional fields
+			postfixes,  // Apply the postfixes from index, until the next one that has an expression to evaluate
+		};
+
+		struct Task
+		{
+			Step step;
+			const void* node;
+			size_t index = 0;
+		};
+
+		void schedule(const ast::Expression& e) const
 		{
-			return (*this)(be.expression);
+			const auto& operations = e.binaryOperations;
+			if (operations.empty())
+				return (*this)(e.operand);
+
+			m_tasks.push_back({Step::fold, &e});
+			for (auto it = operations.rbegin(); it != operations.rend(); ++it)
+				m_tasks.push_back({Step::operand, &it->operand});
+			m_tasks.push_back({Step::operand, &e.operand});
 		}
 
-		TypeInfo operator()(const ast::PrefixExpression& pe) const
+		void run(const Task& task) const
 		{
-			auto type = boost::apply_visitor(*this, pe.start);
-			if (pe.rest.empty())
-				return m_scope.getVariableType(type.name);
+			switch (task.step)
+			{
+			case Step::expression:
+				return schedule(*static_cast<const ast::Expression*>(task.node));
 
-			for (const auto& r : pe.rest)
-				type = getSubType(m_scope, type, r);
-			return type;
+			case Step::operand:
+				return (*this)(*static_cast<const ast::Operand*>(task.node));
+
+			case Step::fold:
+			{
+				const auto& operations = static_cast<const ast::Expression*>(task.node)->binaryOperations;
+				const auto first = m_values.size() - operations.size() - 1;
+				auto type = foldExpression(
+					operations.size(),
+					[&](size_t i) { return std::move(m_values[first + i]); },
+					[&](size_t i) { return operations[i].operation; });
+				m_values.resize(first);
+				return m_values.push_back(std::move(type));
+			}
+
+			case Step::unary:
+			{
+				auto& type = m_values.back();
+				type = unaryOperationType(static_cast<const ast::UnaryOperation*>(task.node)->operation, type);
+				return;
+			}
+
+			case Step::sequence:
+			{
+				const auto nbFields = static_cast<const ast::TableConstructor*>(task.node)->fields->size();
+				const auto first = m_values.size() - nbFields;
+				auto element = std::move(m_values[first]);
+				for (auto i = first + 1; i < m_values.size(); ++i)
+					widenType(element, m_values[i]);
+				m_values.resize(first);
+				return m_values.push_back(TypeInfo::createArray(std::move(element)));
+			}
+
+			case Step::table:
+				return table(*static_cast<const ast::TableConstructor*>(task.node));
+
+			case Step::postfixes:
+				return postfixes(*static_cast<const ast::PrefixExpression*>(task.node), task.index);
+
+			default:
+				return;
+			}
 		}
 
-		TypeInfo operator()(const ast::Variable& v) const
+		void table(const ast::TableConstructor& tc) const
 		{
-			auto type = boost::apply_visitor(*this, v.start);
-			if (v.rest.empty())
-				return m_scope.getVariableType(type.name);
+			const auto& fields = *tc.fields;
+			const auto nbValues = std::count_if(fields.begin(), fields.end(), [](const ast::Field& field) {
+				return field.get().type() != typeid(ast::FieldByExpression);
+			});
+			auto value = m_values.end() - nbValues;
 
-			for (const auto& r : v.rest)
-				type = getSubType(m_scope, type, r);
-			return type;
+			TypeInfo info{Type::table};
+			int fieldIndex = 1;
+			for (const ast::Field& field : fields)
+			{
+				const auto& fieldType = field.get().type();
+				if (fieldType == typeid(ast::FieldByAssignment))
+					info.members[boost::get<ast::FieldByAssignment>(field.get()).name] = std::move(*value++);
+				else if (fieldType == typeid(ast::Expression))
+					info.members[std::to_string(fieldIndex++)] = std::move(*value++);
+			}
+
+			m_values.resize(m_values.size() - nbValues);
+			m_values.push_back(std::move(info));
 		}
 
-		TypeInfo operator()(const ast::Expression& e) const
+		// The type of the start, or of the previous postfixes, is on the top of the stack,
+		// above the type of the key if the previous postfix is an index expression
+		void postfixes(const ast::PrefixExpression& pe, size_t index) const
 		{
-			const auto first = boost::apply_visitor(*this, e.operand);
-			if (!e.binaryOperation)
-				return first;
+			if (pe.rest.empty())
+			{
+				auto& type = m_values.back();
+				type = m_scope.getVariableType(type.name);
+				return;
+			}
 
-			return binaryOperation(first, *e.binaryOperation);
+			if (index)
+			{
+				const auto key = std::move(m_values.back());
+				m_values.pop_back();
+				m_values.back() = getIndexedType(m_scope, m_values.back(), key);
+			}
+
+			for (; index < pe.rest.size(); ++index)
+			{
+				const auto& postfix = pe.rest[index];
+				if (postfix.get().type() == typeid(ast::TableIndexExpression))
+				{
+					m_tasks.push_back({Step::postfixes, &pe, index + 1});
+					m_tasks.push_back({Step::expression, &boost::get<ast::TableIndexExpression>(postfix).expression});
+					return;
+				}
+				m_values.back() = getSubType(m_scope, m_values.back(), postfix);
+			}
 		}
 
-		TypeInfo binaryOperation(const TypeInfo& left, const ast::BinaryOperation& bo) const
+		struct Stacks
 		{
-			// TODO: we cannot correctly support left associative operations
-			//  (must rework the parser)
+			std::vector<Task> tasks;
+			std::vector<TypeInfo> values;
+		};
 
-			const auto operand = (*this)(bo.expression);
+		// Shared by the evaluations of a thread, to keep their capacity as getType is called for most statements
+		static Stacks& stacks()
+		{
+			thread_local Stacks stacks;
+			return stacks;
+		}
 
-			auto convertAll = [&](Type type) {
-				if (left.convert(type) && operand.convert(type))
-					return type;
-				return Type::error;
-			};
+		const Scope& m_scope;
+		std::vector<Task>& m_tasks = stacks().tasks;
+		std::vector<TypeInfo>& m_values = stacks().values;
+	};
 
-			auto allType = [&](Type type) {
-				return left.type == type && operand.type == type;
-			};
+	TypeInfo constantType(ast::ExpressionConstant ec)
+	{
+		using EC = ast::ExpressionConstant;
+		switch (ec)
+		{
+		case EC::nil:
+			return Type::nil;
 
-			using OP = ast::Operation;
-			switch (bo.operation)
-			{
-			case OP::add:
-			case OP::sub:
-			case OP::mul:
-			case OP::div:
-			case OP::idiv:
-			case OP::mod:
-				return convertAll(Type::number);
-
-			case OP::pow: // Right associative
-				return convertAll(Type::number);
-
-			case OP::band:
-			case OP::bor:
-			case OP::bxor:
-			case OP::bnot:
-			case OP::shl:
-			case OP::shr:
-				return convertAll(Type::number);
-
-			case OP::concat: // Right associative
-				return convertAll(Type::string);
-
-			case OP::lt:
-			case OP::le:
-			case OP::gt:
-			case OP::ge:
-				if (allType(Type::number) || allType(Type::string))
-					return Type::boolean;
-				return Type::error;
+		case EC::dots:
+			return Type::unknown;
+
+		case EC::False:
+		case EC::True:
+			return Type::boolean;
+
+		default:
+			return Type::error;
+		}
+	}
+
+	TypeInfo unaryOperationType(ast::Operation operation, const TypeInfo& right)
+	{
+		using OP = ast::Operation;
+		switch (operation)
+		{
+		case OP::unm:
+		case OP::bnot:
+			return right.convert(Type::number);
+
+		case OP::len:
+			return (right.type == Type::string || right.type == Type::table || right.type == Type::array)
+					   ? Type::number
+					   : Type::error;
+
+		case OP::lnot:
+			return Type::boolean;
 
-			case OP::eq:
-			case OP::ineq:
+		default:
+			return Type::error;
+		}
+	}
+
+	TypeInfo binaryOperationType(const TypeInfo& left, ast::Operation operation, const TypeInfo& operand)
+	{
+		auto convertAll = [&](Type type) {
+			if (left.convert(type) && operand.convert(type))
+				return type;
+			return Type::error;
+		};
+
+		auto allType = [&](Type type) {
+			return left.type == type && operand.type == type;
+		};
+
+		using OP = ast::Operation;
+		switch (operation)
+		{
+		case OP::add:
+		case OP::sub:
+		case OP::mul:
+		case OP::div:
+		case OP::idiv:
+		case OP::mod:
+			return convertAll(Type::number);
+
+		case OP::pow:
+			return convertAll(Type::number);
+
+		case OP::band:
+		case OP::bor:
+		case OP::bxor:
+		case OP::bnot:
+		case OP::shl:
+		case OP::shr:
+			return convertAll(Type::number);
+
+		case OP::concat:
+			return convertAll(Type::string);
+
+		case OP::lt:
+		case OP::le:
+		case OP::gt:
+		case OP::ge:
+			if (allType(Type::number) || allType(Type::string))
 				return Type::boolean;
+			return Type::error;
 
-			case OP::land:
-			case OP::lor:
-				// TODO: create a variant type
-				if (!left && !operand)
-					return Type::error;
-				if (left.type == operand.type)
-					return left;
-				return Type::unknown;
+		case OP::eq:
+		case OP::ineq:
+			return Type::boolean;
 
-			default:
+		case OP::land:
+		case OP::lor:
+			// TODO: create a variant type
+			if (!left && !operand)
 				return Type::error;
-			}
-		}
+			if (left.type == operand.type)
+				return left;
+			return Type::unknown;
 
-	private:
-		const Scope& m_scope;
-	};
+		default:
+			return Type::error;
+		}
+	}
 
 	TypeInfo getType(const Scope& scope, const ast::Expression& e)
 	{
-		return GetType{scope}(e);
+		return GetType{scope}.evaluate(e);
 	}
 
 	TypeInfo getType(const Scope& scope, const ast::FunctionBody& f)
 	{
-		return GetType{scope}(f);
+		return GetType{scope}.functionType(f);
 	}
 } // namespace lac::an
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <lac/analysis/type_info.h>
+#include <lac/core_api.h>
 
 namespace lac::ast
 {
+	enum class Operation;
+	enum class ExpressionConstant;
 	struct Expression;
 	struct FunctionBody;
 }
@@ -12,6 +15,10 @@ namespace lac::an
 {
 	class Scope;
 
-	TypeInfo getType(const Scope& scope, const ast::Expression& e);
-	TypeInfo getType(const Scope& scope, const ast::FunctionBody& f);
+	CORE_API TypeInfo getType(const Scope& scope, const ast::Expression& e);
+	CORE_API TypeInfo getType(const Scope& scope, const ast::FunctionBody& f);
+
+	CORE_API TypeInfo constantType(ast::ExpressionConstant constant);
+	CORE_API TypeInfo unaryOperationType(ast::Operation operation, const TypeInfo& right);
+	CORE_API TypeInfo binaryOperationType(const TypeInfo& left, ast::Operation operation, const TypeInfo& right);
 } // namespace lac::an
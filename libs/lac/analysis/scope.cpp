@@ -11,7 +11,31 @@ namespace lac::an
 	{
 	}
 
-	void Scope::addVariable(const std::string& name, TypeInfo type)
+	Scope::Scope(Scope* parent)
+		: m_parent(parent)
+	{
+	}
+
+	Scope::~Scope()
+	{
+		// Destroy the descendants level by level, as the recursive destruction can overflow the stack on nested code
+		if (m_children.empty())
+			return;
+		std::vector<std::vector<Scope>> pending;
+		pending.push_back(std::move(m_children));
+		while (!pending.empty())
+		{
+			auto children = std::move(pending.back());
+			pending.pop_back();
+			for (auto& child : children)
+			{
+				if (!child.m_children.empty())
+					pending.push_back(std::move(child.m_children));
+			}
+		}
+	}
+
+	void Scope::addVariable(ast::Atom name, TypeInfo type)
 	{
 		if (getUserDefined() && type.type == Type::function)
 		{
@@ -26,22 +50,33 @@ namespace lac::an
 		m_variables[name] = std::move(type);
 	}
 
-	TypeInfo Scope::getVariableType(const std::string& name) const
+	TypeInfo Scope::getVariableType(ast::Atom name) const
+	{
+		if (const auto type = findVariable(name))
+			return *type;
+		return Type::nil;
+	}
+
+	const TypeInfo* Scope::findVariable(ast::Atom name) const
 	{
 		const auto it = m_variables.find(name);
 		if (it != m_variables.end())
-			return it->second;
+			return &it->second;
 		if (getUserDefined())
 		{
 			if (auto var = getUserDefined()->getVariable(name))
-				return *var;
+				return var;
 		}
-		if (m_parent)
-			return m_parent->getVariableType(name);
-		return Type::nil;
+		for (auto scope = m_parent; scope; scope = scope->m_parent)
+		{
+			const auto parentIt = scope->m_variables.find(name);
+			if (parentIt != scope->m_variables.end())
+				return &parentIt->second;
+		}
+		return nullptr;
 	}
 
-	TypeInfo& Scope::modifyTable(const std::string& name)
+	TypeInfo& Scope::modifyTable(ast::Atom name)
 	{
 		const auto it = m_variables.find(name);
 		if (it != m_variables.end())
@@ -51,38 +86,37 @@ namespace lac::an
 		return m_variables[name];
 	}
 
-	void Scope::addLabel(const std::string& name)
+	void Scope::addLabel(ast::Atom name)
 	{
 		m_labels.insert(name);
 	}
 
-	bool Scope::hasLabel(const std::string& name) const
+	bool Scope::hasLabel(ast::Atom name) const
 	{
-		if (m_labels.count(name))
-			return true;
-		if (m_parent)
-			return m_parent->hasLabel(name);
+		for (auto scope = this; scope; scope = scope->m_parent)
+		{
+			if (scope->m_labels.count(name))
+				return true;
+		}
 		return false;
 	}
 
-	TypeInfo Scope::getUserType(std::string_view name) const
+	TypeInfo Scope::getUserType(ast::Atom name) const
 	{
 		if (getUserDefined())
 		{
 			if (auto user = getUserDefined()->getType(name))
 				return *user;
 		}
-
-		if (m_parent)
-			return m_parent->getUserType(name);
 		return {};
 	}
 
 	Scope& Scope::getGlobalScope()
 	{
-		return m_parent
-				   ? m_parent->getGlobalScope()
-				   : *this;
+		auto scope = this;
+		while (scope->m_parent)
+			scope = scope->m_parent;
+		return *scope;
 	}
 
 	void Scope::addChildScope(Scope&& scope)
@@ -97,9 +131,10 @@ namespace lac::an
 
 	const UserDefined* Scope::getUserDefined() const
 	{
-		return m_parent
-				   ? m_parent->getUserDefined()
-				   : m_userDefined;
+		auto scope = this;
+		while (scope->m_parent)
+			scope = scope->m_parent;
+		return scope->m_userDefined;
 	}
 
 	TypeInfo Scope::resolve(const TypeInfo& type) const
@@ -131,10 +166,21 @@ namespace lac::an
 		return m_children;
 	}
 
+	void Scope::setLazy(bool lazy)
+	{
+		m_lazy = lazy;
+	}
+
+	bool Scope::isLazy() const
+	{
+		return m_lazy;
+	}
+
 	std::map<std::string, Element> Scope::getElements(bool localOnly) const
 	{
 		std::map<std::string, Element> elements;
-		auto addVariable = [&elements](const std::string& name, const TypeInfo& type, bool local) {
+		auto addVariable = [&elements](ast::Atom atom, const TypeInfo& type, bool local) {
+			const auto& name = atom.str();
 			if (elements.count(name))
 				return;
 
@@ -175,12 +221,13 @@ namespace lac::an
 		ElementsMap elements;
 		for (const auto& it : type.members)
 		{
+			const auto& name = it.first.str();
 			Element elt;
-			elt.name = it.first;
+			elt.name = name;
 			elt.typeInfo = it.second;
 			if (it.second.isMethod())
 				elt.elementType = ElementType::method;
-			elements[it.first] = std::move(elt);
+			elements[name] = std::move(elt);
 		}
 
 		return elements;
@@ -194,12 +241,13 @@ namespace lac::an
 			if (it.second.isMethod() != (filter == ElementType::method))
 				continue;
 
+			const auto& name = it.first.str();
 			Element elt;
-			elt.name = it.first;
+			elt.name = name;
 			elt.typeInfo = it.second;
 			if (it.second.isMethod())
 				elt.elementType = ElementType::method;
-			elements[it.first] = std::move(elt);
+			elements[name] = std::move(elt);
 		}
 
 		return elements;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <lac/analysis/type_info.h>
+#include <lac/core_api.h>
+#include <lac/parser/atom.h>
 
 #include <map>
 #include <set>
@@ -32,21 +34,29 @@ namespace lac::an
 	};
 	using ElementsMap = std::map<std::string, Element>;
 
-	class Scope
+	class CORE_API Scope
 	{
 	public:
 		Scope() = default;
 		Scope(const ast::Block& block, Scope* parent = nullptr);
+		explicit Scope(Scope* parent); // Without block, for the flat tree
+		~Scope();
 
-		void addVariable(const std::string& name, TypeInfo type);
-		TypeInfo getVariableType(const std::string& name) const;
+		Scope(const Scope&) = default;
+		Scope& operator=(const Scope&) = default;
+		Scope(Scope&&) = default;
+		Scope& operator=(Scope&&) = default;
 
-		TypeInfo& modifyTable(const std::string& name);
+		void addVariable(ast::Atom name, TypeInfo type);
+		TypeInfo getVariableType(ast::Atom name) const;
+		const TypeInfo* findVariable(ast::Atom name) const; // Same lookup without copy, nullptr for nil
 
-		void addLabel(const std::string& name);
-		bool hasLabel(const std::string& name) const;
+		TypeInfo& modifyTable(ast::Atom name);
 
-		TypeInfo getUserType(std::string_view name) const;
+		void addLabel(ast::Atom name);
+		bool hasLabel(ast::Atom name) const;
+
+		TypeInfo getUserType(ast::Atom name) const;
 
 		Scope& getGlobalScope();
 		void addChildScope(Scope&& scope);
@@ -58,16 +68,23 @@ namespace lac::an
 		const ast::Block* block() const;
 		const std::vector<Scope>& children() const;
 
+		// Scope of a function body that is not parsed yet, only its parameters are known
+		void setLazy(bool lazy);
+		bool isLazy() const;
+
 		ElementsMap getElements(bool localOnly = true) const;
 
 	private:
+		friend class ScopeCache;
+
 		const ast::Block* m_block = nullptr;
 		Scope* m_parent = nullptr;
 		UserDefined* m_userDefined = nullptr;
+		bool m_lazy = false;
 
 		std::vector<Scope> m_children;
-		std::map<std::string, TypeInfo> m_variables;
-		std::set<std::string> m_labels;
+		std::map<ast::Atom, TypeInfo> m_variables;
+		std::set<ast::Atom> m_labels;
 	};
 
 	ElementsMap getElements(const TypeInfo& type);
@@ -0,0 +1,308 @@
+#include <lac/analysis/scope_cache.h>
+#include <lac/parser/ast.h>
+#include <lac/parser/visitor.h>
+
+#include <boost/container_hash/hash.hpp>
+
+#include <algorithm>
+#include <functional>
+
+namespace lac::an
+{
+	namespace
+	{
+		// The blocks of the body in the order of the source, its own block first,
+		// and if asked the names it looks up: variables, functions and the start of the function names
+		class CollectBody : public ast::Visitor<CollectBody>
+		{
+		public:
+			CollectBody(bool withNames)
+				: m_withNames(withNames)
+			{
+			}
+
+			using Visitor::operator();
+
+			bool operator()(const ast::Block& b) const
+			{
+				blocks.push_back(&b);
+				return Visitor::operator()(b);
+			}
+
+			bool operator()(ast::Atom name) const
+			{
+				if (m_withNames)
+					names.push_back(name);
+				return true;
+			}
+
+			bool operator()(const ast::FunctionName& fn) const
+			{
+				return (*this)(fn.start);
+			}
+
+			mutable std::vector<const ast::Block*> blocks;
+			mutable std::vector<ast::Atom> names;
+
+		private:
+			bool m_withNames = false;
+		};
+
+		size_t bodyKey(const ast::FunctionBody& body, ast::Atom name)
+		{
+			size_t seed = body.block.hash;
+			boost::hash_combine(seed, name.id());
+			boost::hash_combine(seed, body.parameters.is_initialized());
+			if (body.parameters)
+			{
+				for (const auto& parameter : body.parameters->parameters)
+					boost::hash_combine(seed, parameter.id());
+				boost::hash_combine(seed, body.parameters->varargs);
+			}
+			return seed;
+		}
+
+		size_t fingerprint(const Scope& parent, const std::vector<ast::Atom>& names)
+		{
+			size_t seed = std::hash<const void*>{}(parent.getUserDefined());
+			for (const auto name : names)
+			{
+				const auto type = parent.findVariable(name);
+				boost::hash_combine(seed, type ? hashType(*type) : 0);
+			}
+			return seed;
+		}
+
+		// Visit the descendants of the root in pre-order, with their path from it, until the given depth
+		template <typename Visit>
+		void visitDescendants(const Scope& root, size_t maxDepth, const Visit& visit)
+		{
+			std::vector<std::pair<const std::vector<Scope>*, size_t>> stack{{&root.children(), 0}}; // Children and index of the next one
+			std::vector<size_t> path;
+			while (!stack.empty())
+			{
+				const auto [children, next] = stack.back();
+				if (next == children->size() || stack.size() > maxDepth)
+				{
+					stack.pop_back();
+					if (!path.empty())
+						path.pop_back();
+					continue;
+				}
+
+				++stack.back().second;
+				path.push_back(next);
+				const auto& child = (*children)[next];
+				visit(child, path);
+				stack.emplace_back(&child.children(), 0);
+			}
+		}
+
+		// Index of the block of each scope in the blocks of its body, in the pre-order of the scopes.
+		// Both are in the order of the source, but not all the blocks have a scope.
+		std::optional<std::vector<size_t>> blockIndices(const Scope& scope, const std::vector<const ast::Block*>& blocks)
+		{
+			std::vector<size_t> result;
+			std::vector<const Scope*> pending{&scope};
+			size_t index = 0;
+			while (!pending.empty())
+			{
+				const auto current = pending.back();
+				pending.pop_back();
+				while (index < blocks.size() && blocks[index] != current->block())
+					++index;
+				if (index == blocks.size())
+					return {};
+				result.push_back(index++);
+
+				const auto& children = current->children();
+				for (auto child = children.rbegin(); child != children.rend(); ++child)
+					pending.push_back(&*child);
+			}
+			return result;
+		}
+	} // namespace
+
+	void ScopeCache::setPrevious(Scope&& root)
+	{
+		m_previous = std::move(root);
+		m_byScope.clear();
+		m_hits = 0;
+		for (size_t i = 0; i < m_entries.size(); ++i) // The enclosing entries are before the nested ones
+		{
+			auto& entry = m_entries[i];
+			entry.parent = noParent;
+			entry.hasNested = false;
+			auto scope = &m_previous;
+			for (const auto index : entry.path)
+			{
+				if (const auto it = m_byScope.find(scope); it != m_byScope.end())
+				{
+					entry.parent = it->second;
+					m_entries[it->second].hasNested = true;
+				}
+				if (index >= scope->m_children.size())
+				{
+					scope = nullptr;
+					break;
+				}
+				scope = &scope->m_children[index];
+			}
+
+			entry.scope = scope;
+			if (scope)
+				m_byScope.emplace(scope, i);
+		}
+	}
+
+	std::optional<Scope> ScopeCache::reuse(const ast::FunctionBody& body, ast::Atom name, const Scope& parent)
+	{
+		if (!body.block.hash || body.lazy)
+			return {};
+
+		const auto key = bodyKey(body, name);
+		const auto [first, last] = m_byKey.equal_range(key);
+		for (auto it = first; it != last; ++it)
+		{
+			auto& entry = m_entries[it->second];
+			if (!entry.scope || fingerprint(parent, entry.names) != entry.fingerprint)
+				continue;
+
+			CollectBody collect(false);
+			collect(body.block);
+			const auto nbBlocks = collect.blocks.size();
+			if (std::any_of(entry.blocks.begin(), entry.blocks.end(), [nbBlocks](size_t index) { return index >= nbBlocks; }))
+				continue;
+
+			// The entries of the reused scope are kept with it, their enclosing scopes being the same
+			const auto previousScope = entry.scope;
+			Pending pending;
+			pending.block = &body.block;
+			if (entry.hasNested)
+			{
+				visitDescendants(*previousScope, maxDepth, [&](const Scope& scope, const std::vector<size_t>& path) {
+					const auto nested = m_byScope.find(&scope);
+					if (nested == m_byScope.end())
+						return;
+					auto& nestedEntry = pending.nested.emplace_back(std::move(m_entries[nested->second]));
+					nestedEntry.path = path;
+					nestedEntry.scope = nullptr;
+					m_entries[nested->second].scope = nullptr;
+				});
+			}
+
+			// The scopes containing it can no longer be reused
+			for (auto enclosing = entry.parent; enclosing != noParent; enclosing = m_entries[enclosing].parent)
+				m_entries[enclosing].scope = nullptr;
+
+			pending.entry = std::move(entry);
+			pending.entry.path.clear();
+			pending.entry.scope = nullptr;
+			entry.scope = nullptr;
+
+			auto scope = std::move(*previousScope);
+			rebaseScope(scope, collect.blocks, pending.entry.blocks);
+			m_pending.push_back(std::move(pending));
+			++m_hits;
+			return scope;
+		}
+
+		// Analysed by the caller, the block indices are computed by update
+		CollectBody collect(true);
+		collect(body);
+		auto& names = collect.names;
+		if (!name.empty())
+			names.push_back(name);
+		std::sort(names.begin(), names.end());
+		names.erase(std::unique(names.begin(), names.end()), names.end());
+
+		Entry entry;
+		entry.key = key;
+		entry.fingerprint = fingerprint(parent, names);
+		entry.names = std::move(names);
+		m_pending.push_back({&body.block, std::move(entry), {}, std::move(collect.blocks)});
+		return {};
+	}
+
+	void ScopeCache::update(const Scope& root, bool complete)
+	{
+		m_entries.clear();
+		m_byKey.clear();
+		m_byScope.clear();
+		m_previous = Scope{};
+		auto pending = std::move(m_pending);
+		m_pending.clear();
+		if (!complete)
+			return;
+
+		// The bodies are analysed in pre-order, as their scopes are added to the tree
+		auto next = pending.begin();
+		visitDescendants(root, maxDepth, [&](const Scope& scope, const std::vector<size_t>& path) {
+			if (next == pending.end() || next->block != scope.block())
+				return;
+
+			auto& current = *next++;
+			auto& entry = current.entry;
+			if (entry.blocks.empty())
+			{
+				auto indices = blockIndices(scope, current.blocks);
+				if (!indices)
+					return;
+				entry.blocks = std::move(*indices);
+			}
+			entry.path = path;
+			add(std::move(entry));
+
+			for (auto& nested : current.nested)
+			{
+				if (path.size() + nested.path.size() > maxDepth)
+					continue;
+				nested.path.insert(nested.path.begin(), path.begin(), path.end());
+				add(std::move(nested));
+			}
+		});
+	}
+
+	void ScopeCache::clear()
+	{
+		m_entries.clear();
+		m_byKey.clear();
+		m_byScope.clear();
+		m_pending.clear();
+		m_previous = Scope{};
+		m_hits = 0;
+	}
+
+	size_t ScopeCache::size() const
+	{
+		return m_entries.size();
+	}
+
+	size_t ScopeCache::hits() const
+	{
+		return m_hits;
+	}
+
+	void ScopeCache::rebaseScope(Scope& scope, const std::vector<const ast::Block*>& blocks, const std::vector<size_t>& indices)
+	{
+		// In the same pre-order as the indices, without recursion as the scopes can be deeply nested
+		std::vector<Scope*> pending{&scope};
+		auto index = indices.begin();
+		while (!pending.empty())
+		{
+			const auto current = pending.back();
+			pending.pop_back();
+			current->m_block = blocks[*index++];
+
+			auto& children = current->m_children;
+			for (auto child = children.rbegin(); child != children.rend(); ++child)
+				pending.push_back(&*child);
+		}
+	}
+
+	void ScopeCache::add(Entry entry)
+	{
+		m_byKey.emplace(entry.key, m_entries.size());
+		m_entries.push_back(std::move(entry));
+	}
+} // namespace lac::an
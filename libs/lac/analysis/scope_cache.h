@@ -0,0 +1,79 @@
+#pragma once
+
+#include <lac/analysis/scope.h>
+#include <lac/core_api.h>
+#include <lac/parser/atom.h>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace lac::ast
+{
+	struct Block;
+	struct FunctionBody;
+} // namespace lac::ast
+
+namespace lac::an
+{
+	// Reuse the scopes of the function bodies analysed by the previous analysis, when the body has the same structural hash
+	// (see ast::hashBlocks), the same parameters and name, and each name it uses has the same type in the enclosing scopes.
+	// The scopes are moved from the previous analysis and rebased on the blocks of the new tree, so each one is reused once.
+	// The user-defined types and their callbacks are assumed not to change between the analyses: the cache must be cleared otherwise.
+	// Usage: setPrevious with the root scope of the previous analysis, then analyseBlock with AnalysisOptions::cache set.
+	class CORE_API ScopeCache
+	{
+	public:
+		static constexpr size_t maxDepth = 8; // The bodies nested deeper are only reused with the one containing them
+
+		// Take the root scope given to the last update, the scopes being moved from it
+		void setPrevious(Scope&& root);
+
+		// Returns the scope of the body if it can be reused, to be added to the parent scope.
+		// Otherwise the body must be analysed, then its scope will be cached by update.
+		std::optional<Scope> reuse(const ast::FunctionBody& body, ast::Atom name, const Scope& parent);
+
+		// Keep the scopes of the bodies given to reuse, and release the previous analysis.
+		// Nothing is kept if the analysis of root is not complete.
+		void update(const Scope& root, bool complete);
+
+		void clear();
+
+		size_t size() const;
+		size_t hits() const; // Number of scopes reused since setPrevious
+
+	private:
+		static constexpr size_t noParent = static_cast<size_t>(-1);
+
+		struct Entry
+		{
+			size_t key = 0;
+			size_t fingerprint = 0;          // Of the types of the names in the enclosing scopes
+			std::vector<ast::Atom> names;    // Used in the body, sorted
+			std::vector<size_t> blocks;      // Index of the block of each scope, in the pre-order of the blocks and of the scopes
+			std::vector<size_t> path;        // Indices of the children from the root scope
+			Scope* scope = nullptr;          // In the previous root, set by setPrevious and reset once moved
+			size_t parent = noParent;        // Entry of the enclosing body
+			bool hasNested = false;          // If it is the parent of other entries
+		};
+
+		struct Pending
+		{
+			const ast::Block* block = nullptr;     // Of the body
+			Entry entry;                           // Without path
+			std::vector<Entry> nested;             // Entries of the reused scope, with a path relative to it
+			std::vector<const ast::Block*> blocks; // Of the analysed body, in the order of the source
+		};
+
+		// Set the blocks of the scope and its descendants to the ones given by the indices of Entry::blocks
+		static void rebaseScope(Scope& scope, const std::vector<const ast::Block*>& blocks, const std::vector<size_t>& indices);
+		void add(Entry entry);
+
+		std::vector<Entry> m_entries;
+		std::unordered_multimap<size_t, size_t> m_byKey;            // Index of the entries
+		std::unordered_map<const Scope*, size_t> m_byScope;         // Index of the entries
+		std::vector<Pending> m_pending;                             // In the order of the calls to reuse, the pre-order of the bodies
+		Scope m_previous;
+		size_t m_hits = 0;
+	};
+} // namespace lac::an
@@ -1,5 +1,7 @@
 #include <lac/analysis/type_info.h>
 #include <lac/analysis/parse_type.h>
+
+#include <boost/container_hash/hash.hpp>
 #ifdef WITH_TESTS
 #include <doctest/doctest.h>
 #endif
@@ -66,6 +68,19 @@ namespace lac::an
 	/****************************************************************************/
 
 	TypeInfo::TypeInfo() = default;
+	TypeInfo::TypeInfo(const TypeInfo&) = default;
+	TypeInfo::TypeInfo(TypeInfo&&) noexcept = default;
+	TypeInfo& TypeInfo::operator=(const TypeInfo&) = default;
+	TypeInfo& TypeInfo::operator=(TypeInfo&&) noexcept = default;
+
+	TypeInfo::~TypeInfo()
+	{
+		// Release the elements of nested arrays one after the other, instead of recursively.
+		// They are created as non-const objects (see createArray), and are not shared when unique.
+		auto element = std::move(this->element);
+		while (element && element.use_count() == 1)
+			element = std::move(const_cast<TypeInfo&>(*element).element);
+	}
 
 	TypeInfo::TypeInfo(Type type)
 		: type(type)
@@ -145,6 +160,13 @@ namespace lac::an
 		return type;
 	}
 
+	TypeInfo TypeInfo::createArray(TypeInfo element)
+	{
+		TypeInfo type{Type::array};
+		type.element = std::make_shared<TypeInfo>(std::move(element));
+		return type;
+	}
+
 	TypeInfo TypeInfo::convert(Type destination) const
 	{
 		if (type == destination)
@@ -189,18 +211,27 @@ namespace lac::an
 		}
 	}
 
-	bool TypeInfo::hasMember(const std::string& name) const
+	bool TypeInfo::hasMember(ast::Atom name) const
 	{
 		return members.count(name) != 0;
 	}
 
-	TypeInfo TypeInfo::member(const std::string& name) const
+	TypeInfo TypeInfo::member(ast::Atom name) const
 	{
 		return members.count(name)
 				   ? members.at(name)
 				   : TypeInfo{};
 	}
 
+	TypeInfo TypeInfo::elementType() const
+	{
+		if (element)
+			return *element;
+		if (name.empty())
+			return Type::unknown;
+		return fromTypeName(name);
+	}
+
 	bool TypeInfo::isMethod() const
 	{
 		return function.isMethod;
@@ -227,6 +258,8 @@ namespace lac::an
 			return "string";
 		case Type::table:
 			return "table";
+		case Type::array:
+			return elementType().typeName() + "[]";
 		case Type::function:
 			return function.isMethod
 					   ? "method"
@@ -284,6 +317,71 @@ namespace lac::an
 
 		return str;
 	}
+	void widenType(TypeInfo& type, const TypeInfo& other)
+	{
+		if (type.type != other.type || type.name != other.name)
+		{
+			type = Type::unknown;
+			return;
+		}
+
+		switch (type.type)
+		{
+		case Type::table:
+			for (const auto& [name, member] : other.members)
+			{
+				const auto [it, inserted] = type.members.try_emplace(name, member);
+				if (!inserted)
+					widenType(it->second, member);
+			}
+			break;
+
+		case Type::array:
+			if (type.element != other.element)
+			{
+				auto element = type.elementType();
+				widenType(element, other.elementType());
+				type.element = std::make_shared<TypeInfo>(std::move(element));
+			}
+			break;
+
+		case Type::function:
+			if (type.functionDefinition() != other.functionDefinition())
+				type = Type::function;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	size_t hashType(const TypeInfo& type)
+	{
+		size_t seed = static_cast<size_t>(type.type);
+		boost::hash_combine(seed, type.name);
+		for (const auto& [name, member] : type.members)
+		{
+			boost::hash_combine(seed, name.id());
+			boost::hash_combine(seed, hashType(member));
+		}
+		if (type.element)
+			boost::hash_combine(seed, hashType(*type.element));
+
+		const auto& function = type.function;
+		for (const auto& parameter : function.parameters)
+		{
+			boost::hash_combine(seed, parameter.name());
+			boost::hash_combine(seed, hashType(parameter.type()));
+		}
+		for (const auto& result : function.results)
+			boost::hash_combine(seed, hashType(result));
+		boost::hash_combine(seed, function.isMethod);
+		boost::hash_combine(seed, static_cast<bool>(function.getResultTypeFunc));
+		boost::hash_combine(seed, static_cast<bool>(function.getCompletionFunc));
+		boost::hash_combine(seed, type.custom.has_value());
+		return seed;
+	}
+
 #ifdef WITH_TESTS
 	TEST_CASE("Text construction")
 	{
@@ -354,6 +452,48 @@ namespace lac::an
 		CHECK(info.function.isMethod);
 		CHECK(info.typeName() == "method");
 		CHECK(info.functionDefinition() == "Player method(number a, string str)");
+
+		info = TypeInfo::createArray(Type::string);
+		CHECK(info.type == Type::array);
+		CHECK(info.name.empty());
+		CHECK(info.elementType().type == Type::string);
+		CHECK(info.typeName() == "string[]");
+	}
+
+	TEST_CASE("Widen type")
+	{
+		TypeInfo type = Type::number;
+		widenType(type, Type::number);
+		CHECK(type.type == Type::number);
+		widenType(type, Type::string);
+		CHECK(type.type == Type::unknown);
+
+		TypeInfo first = Type::table, second = Type::table;
+		first.members["x"] = Type::number;
+		first.members["y"] = Type::number;
+		second.members["x"] = Type::number;
+		second.members["y"] = Type::string;
+		second.members["z"] = Type::boolean;
+		widenType(first, second);
+		CHECK(first.type == Type::table);
+		REQUIRE(first.members.size() == 3);
+		CHECK(first.member("x").type == Type::number);
+		CHECK(first.member("y").type == Type::unknown);
+		CHECK(first.member("z").type == Type::boolean);
+
+		type = TypeInfo::createArray(Type::number);
+		widenType(type, TypeInfo::createArray(Type::number));
+		CHECK(type.typeName() == "number[]");
+		widenType(type, TypeInfo::createArray(Type::boolean));
+		CHECK(type.typeName() == "unknown[]");
+		widenType(type, Type::table);
+		CHECK(type.type == Type::unknown);
+
+		type = "number function()";
+		widenType(type, "number function()");
+		CHECK(type.functionDefinition() == "number function()");
+		widenType(type, "string function()");
+		CHECK(type.functionDefinition() == "function()");
 	}
 	#endif
 } // namespace lac::an
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lac/core_api.h>
+#include <lac/parser/atom.h>
 
 #include <any>
 #include <functional>
@@ -80,6 +81,11 @@ namespace lac::an
 	public:
 		TypeInfo();
 		TypeInfo(Type type);
+		TypeInfo(const TypeInfo&);
+		TypeInfo(TypeInfo&&) noexcept;
+		TypeInfo& operator=(const TypeInfo&);
+		TypeInfo& operator=(TypeInfo&&) noexcept;
+		~TypeInfo();
 
 		TypeInfo(std::string_view text); // Parse the given string to build the type
 		TypeInfo(const char* text);
@@ -91,6 +97,7 @@ namespace lac::an
 			FunctionInfo::GetResultType getResult = {}, FunctionInfo::GetCompletion getCompletion = {});
 		static TypeInfo createMethod(std::vector<VariableInfo> parameters, std::vector<TypeInfo> results = {}, 
 			FunctionInfo::GetResultType getResult = {}, FunctionInfo::GetCompletion getCompletion = {});
+		static TypeInfo createArray(TypeInfo element);
 
 		// Returns destination if possible, error otherwise
 		TypeInfo convert(Type destination) const;
@@ -101,9 +108,13 @@ namespace lac::an
 		Type type = Type::nil;
 
 		// For tables
-		std::map<std::string, TypeInfo> members;
-		bool hasMember(const std::string& name) const;
-		TypeInfo member(const std::string& name) const;
+		std::map<ast::Atom, TypeInfo> members; // Ordered by atom id
+		bool hasMember(ast::Atom name) const;
+		TypeInfo member(ast::Atom name) const;
+
+		// For arrays, the element type is either given by its name or stored here
+		std::shared_ptr<const TypeInfo> element; // Shared by the copies of this type, released without recursion
+		TypeInfo elementType() const;
 
 		// For functions
 		FunctionInfo function;
@@ -119,4 +130,12 @@ namespace lac::an
 
 		std::string description; // For documentation purposes
 	};
+
+	// Widen the type so that it also describes the other one:
+	// the members of tables are merged, and different types become unknown
+	CORE_API void widenType(TypeInfo& type, const TypeInfo& other);
+
+	// Hash of the description of the type, equal for equal types.
+	// The callbacks of the functions and the custom data are only hashed by their presence.
+	CORE_API size_t hashType(const TypeInfo& type);
 } // namespace lac::an
@@ -1,5 +1,7 @@
 #include <lac/analysis/user_defined.h>
 
+#include <algorithm>
+
 #ifdef WITH_TESTS
 #include <doctest/doctest.h>
 #endif
@@ -10,28 +12,28 @@
 
 namespace lac::an
 {
-	void UserDefined::addVariable(std::string_view name, TypeInfo type)
+	void UserDefined::addVariable(ast::Atom name, TypeInfo type)
 	{
-		variables[std::string{name}] = type;
+		variables[name] = type;
 	}
 
-	const TypeInfo* UserDefined::getVariable(std::string_view name) const
+	const TypeInfo* UserDefined::getVariable(ast::Atom name) const
 	{
-		const auto it = variables.find(std::string{name});
+		const auto it = variables.find(name);
 		if (it != variables.end())
 			return &it->second;
 		return nullptr;
 	}
 
-	void UserDefined::addScriptInput(std::string_view name, TypeInfo info)
+	void UserDefined::addScriptInput(ast::Atom name, TypeInfo info)
 	{
 		if (info.type == Type::function)
-			scriptEntries[std::string{name}] = std::move(info);
+			scriptEntries[name] = std::move(info);
 	}
 
-	const TypeInfo* UserDefined::getScriptInput(std::string_view name) const
+	const TypeInfo* UserDefined::getScriptInput(ast::Atom name) const
 	{
-		const auto it = scriptEntries.find(std::string{name});
+		const auto it = scriptEntries.find(name);
 		if (it != scriptEntries.end())
 			return &it->second;
 		return nullptr;
@@ -45,9 +47,9 @@ namespace lac::an
 		types[type.name] = std::move(type);
 	}
 
-	const TypeInfo* UserDefined::getType(std::string_view name) const
+	const TypeInfo* UserDefined::getType(ast::Atom name) const
 	{
-		const auto it = types.find(std::string{name});
+		const auto it = types.find(name);
 		if (it != types.end())
 			return &it->second;
 		return nullptr;
@@ -93,7 +95,7 @@ namespace lac::an
 		{
 			auto& jMembers = j["members"];
 			for (const auto& it : info.members)
-				jMembers[it.first] = typeToJson(it.second);
+				jMembers[it.first.str()] = typeToJson(it.second);
 		}
 		return j;
 	}
@@ -126,23 +128,31 @@ namespace lac::an
 		nlohmann::json j;
 		if (!types.empty())
 		{
-			auto& jTypes = j["types"];
+			// The map is ordered by atom id, sort the types by name to keep a stable output
+			std::vector<const TypeInfo*> sortedTypes;
 			for (const auto& it : types)
-				jTypes.push_back(typeToJson(it.second));
+				sortedTypes.push_back(&it.second);
+			std::sort(sortedTypes.begin(), sortedTypes.end(), [](const TypeInfo* lhs, const TypeInfo* rhs) {
+				return lhs->name < rhs->name;
+			});
+
+			auto& jTypes = j["types"];
+			for (const auto type : sortedTypes)
+				jTypes.push_back(typeToJson(*type));
 		}
 
 		if (!variables.empty())
 		{
 			auto& jVars = j["variables"];
 			for (const auto& it : variables)
-				jVars[it.first] = typeToJson(it.second);
+				jVars[it.first.str()] = typeToJson(it.second);
 		}
 
 		if (!scriptEntries.empty())
 		{
 			auto& jInputs = j["script_inputs"];
 			for (const auto& it : scriptEntries)
-				jInputs[it.first] = typeToJson(it.second);
+				jInputs[it.first.str()] = typeToJson(it.second);
 		}
 
 		return j.dump(1, '\t');
@@ -10,16 +10,16 @@ namespace lac::an
 	class CORE_API UserDefined
 	{
 	public:
-		using TypeMap = std::map<std::string, TypeInfo>;
+		using TypeMap = std::map<ast::Atom, TypeInfo>;
 
-		void addVariable(std::string_view name, TypeInfo type);
-		const TypeInfo* getVariable(std::string_view name) const;
+		void addVariable(ast::Atom name, TypeInfo type);
+		const TypeInfo* getVariable(ast::Atom name) const;
 
-		void addScriptInput(std::string_view name, TypeInfo func); // Setup the signature of a function called by the application
-		const TypeInfo* getScriptInput(std::string_view name) const;
+		void addScriptInput(ast::Atom name, TypeInfo func); // Setup the signature of a function called by the application
+		const TypeInfo* getScriptInput(ast::Atom name) const;
 
 		void addType(TypeInfo type);
-		const TypeInfo* getType(std::string_view name) const;
+		const TypeInfo* getType(ast::Atom name) const;
 
 #ifdef WITH_NLOHMANN_JSON
 		void addFromJson(const std::string& json);
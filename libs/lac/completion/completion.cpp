@@ -10,7 +10,10 @@
 #ifdef WITH_TESTS
 #include <doctest/doctest.h>
 #endif
+#include <algorithm>
 #include <cctype>
+#include <utility>
+#include <vector>
 
 namespace
 {
@@ -23,14 +26,14 @@ namespace
 		if (var.start.get().type() == typeid(lac::ast::Variable))
 		{
 			const auto& variable = boost::get<lac::ast::Variable>(var.start);
-			if (variable.rest.empty() && variable.start.get().type() == typeid(std::string))
-				return boost::get<std::string>(variable.start);
+			if (variable.rest.empty() && variable.start.get().type() == typeid(lac::ast::Atom))
+				return boost::get<lac::ast::Atom>(variable.start).str();
 		}
 		else
 		{
 			const auto& call = boost::get<lac::ast::FunctionCall>(var.start);
-			if (call.rest.empty() && call.start.get().type() == typeid(std::string))
-				return boost::get<std::string>(call.start);
+			if (call.rest.empty() && call.start.get().type() == typeid(lac::ast::Atom))
+				return boost::get<lac::ast::Atom>(call.start).str();
 		}
 
 		return {};
@@ -53,6 +56,7 @@ namespace lac::comp
 	void Completion::setUserDefined(lac::an::UserDefined userDefined)
 	{
 		m_userDefined = std::move(userDefined);
+		m_scopeCache.clear(); // The types of the cached scopes can depend on it
 	}
 
 	lac::an::UserDefined Completion::userDefined() const
@@ -62,63 +66,153 @@ namespace lac::comp
 				   : lac::an::UserDefined{};
 	}
 
+	void Completion::setIncrementalParse(bool incremental)
+	{
+		m_incrementalParse = incremental;
+	}
+
+	void Completion::setLazyParse(bool lazy)
+	{
+		m_lazyParse = lazy;
+		m_scopeCache.clear();
+	}
+
+	void Completion::setLimits(parser::Limits limits)
+	{
+		m_limits = limits;
+	}
+
+	void Completion::setReuseScopes(bool reuse)
+	{
+		m_reuseScopes = reuse;
+		m_scopeCache.clear();
+	}
+
 	bool Completion::updateProgram(std::string_view view, size_t currentPosition)
 	{
 		if (view.empty())
 			return false;
 
-		if (currentPosition == std::string_view::npos)
-			currentPosition = view.size() - 1;
+		// Keep our own copy, as the tree views the parsed text
+		auto text = std::make_shared<const std::string>(view);
+
+		// An incomplete tree or scope is not reused
+		const auto previousAborted = std::exchange(m_aborted, parser::AbortReason::none);
+		if (previousAborted != parser::AbortReason::none)
+			m_rootScope = an::Scope{};
 
-		auto ret = lac::parser::parseBlock(view);
-		if (!ret.parsed)
+		// The statements containing errors are always parsed again
+		if (m_incrementalParse && m_parseErrors.empty() && m_parsedText && previousAborted == parser::AbortReason::none
+			&& lac::parser::reparseBlock(m_rootBlock, m_positions, *m_parsedText, *text, parseOptions()))
 		{
-			// Remove the current line and retry
-			std::string str{view};
-			auto start = str.find_last_of("\t\r\n;", currentPosition);
-			auto end = str.find_first_of("\t\r\n;", currentPosition);
-			if (start != std::string::npos || end != std::string::npos)
-			{
-				if (start == std::string::npos)
-					start = 0;
-				if (end == std::string::npos)
-					end = view.size() - 1;
-				++start; // Start after the white space
-				if (start < end)
-					str.replace(start, end - start, end - start, ' '); // Replace the current line with spaces
-
-				// Retry
-				ret = lac::parser::parseBlock(str);
-			}
+			m_parsedText = std::move(text);
+			const auto expanded = analyseProgram(currentPosition);
+			m_rootBlock.end = view.size();
+			return expanded && m_aborted == parser::AbortReason::none;
 		}
 
-		if (ret.parsed)
-		{
-			std::swap(m_rootBlock, ret.block);
-			std::swap(m_positions, ret.positions);
+		auto ret = lac::parser::parseBlock(*text, parseOptions());
+		std::swap(m_arena, ret.arena);
+		std::swap(m_rootBlock, ret.block);
+		std::swap(m_positions, ret.positions);
+		std::swap(m_parseErrors, ret.errors);
+		m_parsedText = std::move(text);
+		m_aborted = ret.aborted;
+		const auto expanded = analyseProgram(currentPosition);
 
-			m_rootScope = an::Scope{m_rootBlock};
-			if (m_userDefined)
-				m_rootScope.setUserDefined(&m_userDefined.get());
-			an::analyseBlock(m_rootScope, m_rootBlock);
+		// Always update the boundary of the root block
+		m_rootBlock.end = view.size();
+
+		return ret.parsed && expanded && m_aborted == parser::AbortReason::none;
+	}
+
+	parser::ParseOptions Completion::parseOptions() const
+	{
+		// Also used to parse again the modified statements and the function bodies, in the tree of the first parse
+		parser::ParseOptions options;
+		options.useArena = true; // The previous tree is freed at once
+		options.lazyFunctionBodies = m_lazyParse;
+		options.hashBlocks = m_reuseScopes && !m_lazyParse;
+		options.limits = m_limits;
+		return options;
+	}
+
+	const parser::ParseErrors& Completion::parseErrors() const
+	{
+		return m_parseErrors;
+	}
 
-			// Extend each block until the following keyword
-			extendBlock(m_rootScope, m_positions.elements());
+	parser::AbortReason Completion::aborted() const
+	{
+		return m_aborted;
+	}
+
+	bool Completion::analyseProgram(size_t position)
+	{
+		const auto reuseScopes = m_reuseScopes && !m_lazyParse && m_rootBlock.hash;
+		if (reuseScopes)
+			m_scopeCache.setPrevious(std::move(m_rootScope));
+		else
+			m_scopeCache.clear();
+
+		m_rootScope = an::Scope{m_rootBlock};
+		if (m_userDefined)
+			m_rootScope.setUserDefined(&m_userDefined.get());
+
+		// Only the function bodies containing the position are analysed, the other ones only declare their parameters.
+		// The range of their blocks, as the one of their scopes, can have been extended after the parse.
+		parser::ExpandResults expanded;
+		if (m_lazyParse && m_parsedText)
+			expanded = parser::expandFunctionBodies(m_rootBlock, *m_parsedText, position, &m_positions, parseOptions());
+		const auto& errors = expanded.errors;
+		if (!errors.empty())
+		{
+			const auto middle = m_parseErrors.insert(m_parseErrors.end(), errors.begin(), errors.end());
+			std::inplace_merge(m_parseErrors.begin(), middle, m_parseErrors.end(),
+							   [](const parser::ParseError& lhs, const parser::ParseError& rhs) { return lhs.begin < rhs.begin; });
 		}
 
-		// Always update the boundary of the root block
-		m_rootBlock.end = view.size();
+		an::AnalysisOptions options;
+		options.limits = m_limits;
+		if (reuseScopes)
+			options.cache = &m_scopeCache;
+		const auto analysisAborted = an::analyseBlock(m_rootScope, m_rootBlock, options);
+
+		// Extend each block until the following keyword
+		extendBlock(m_rootScope, m_positions);
+
+		// Only the first limit reached is reported
+		if (m_aborted == parser::AbortReason::none)
+			m_aborted = (expanded.aborted != parser::AbortReason::none) ? expanded.aborted : analysisAborted;
 
-		return ret.parsed;
+		return errors.empty();
+	}
+
+	void Completion::expandAtPos(std::string_view str, size_t pos)
+	{
+		if (!m_lazyParse || str.empty())
+			return;
+		if (pos == std::string_view::npos)
+			pos = str.size() - 1;
+
+		const auto scope = pos::getScopeAtPos(m_rootScope, pos);
+		if (scope && scope->isLazy())
+		{
+			const auto end = m_rootBlock.end;
+			analyseProgram(pos);
+			m_rootBlock.end = end;
+		}
 	}
 
 	an::ElementsMap Completion::getVariableCompletionList(std::string_view str, size_t pos)
 	{
+		expandAtPos(str, pos);
 		return comp::getAutoCompletionList(m_rootScope, str, pos);
 	}
 
 	an::ElementsMap Completion::getArgumentCompletionList(std::string_view str, size_t pos)
 	{
+		expandAtPos(str, pos);
 		const auto argData = getArgumentAtPos(m_rootScope, str, pos);
 		if (argData && argData->function.function.getCompletionFunc)
 		{
@@ -134,6 +228,7 @@ namespace lac::comp
 
 	an::TypeInfo Completion::getTypeAtPos(std::string_view str, size_t pos)
 	{
+		expandAtPos(str, pos);
 		return comp::getTypeAtPos(m_rootScope, str, pos);
 	}
 
@@ -143,6 +238,7 @@ namespace lac::comp
 			pos = str.size() - 1;
 
 		// Parse what is under the cursor
+		expandAtPos(str, pos);
 		const auto var = parseVariableAtPos(str, pos);
 		if (!var)
 			return {};
@@ -156,15 +252,15 @@ namespace lac::comp
 		if (var->start.get().type() == typeid(ast::Variable))
 		{
 			const auto& variable = boost::get<ast::Variable>(var->start);
-			if (variable.start.get().type() == typeid(std::string))
-				return boost::get<std::string>(variable.start);
+			if (variable.start.get().type() == typeid(ast::Atom))
+				return boost::get<ast::Atom>(variable.start).str();
 			return {};
 		}
 		else
 		{
 			const auto& call = boost::get<ast::FunctionCall>(var->start);
-			if (call.start.get().type() == typeid(std::string))
-				return boost::get<std::string>(call.start);
+			if (call.start.get().type() == typeid(ast::Atom))
+				return boost::get<ast::Atom>(call.start).str();
 			return {};
 		}
 
@@ -173,6 +269,7 @@ namespace lac::comp
 
 	std::vector<std::string> Completion::getTypeHierarchyAtPos(std::string_view str, size_t pos)
 	{
+		expandAtPos(str, pos);
 		return comp::getTypeHierarchyAtPos(m_rootScope, str, pos);
 	}
 
@@ -307,35 +404,29 @@ namespace lac::comp
 		return removeLastPart(*var);
 	}
 
-	void extendBlock(const an::Scope& scope, const pos::Elements& elements)
+	void extendBlock(const an::Scope& scope, const pos::Positions<std::string_view::const_iterator>& positions)
 	{
-		auto block = scope.block();
-		if (!block)
-			return;
+		// Process the children scopes with a stack, as they can be deeply nested
+		std::vector<const an::Scope*> pending{&scope};
+		while (!pending.empty())
+		{
+			const auto current = pending.back();
+			pending.pop_back();
+
+			auto block = current->block();
+			if (!block)
+				continue;
 
-		// Filter only the keyword in the list of elements
-		pos::Elements keywords;
-		std::copy_if(elements.begin(), elements.end(), std::back_inserter(keywords), [](const pos::Element& elt) {
-			return elt.type == ast::ElementType::keyword;
-		});
-
-		// Find the keyword just before the start of the block
-		auto reversed = helper::reverse{elements};
-		auto itStart = helper::upper_bound(reversed, block->begin, [](size_t pos, const pos::Element& elt) {
-			return pos > elt.end;
-		});
-		if (itStart != reversed.end())
-			block->begin = itStart->end;
-
-		// Find the keyword just after the end of the block
-		auto itEnd = helper::upper_bound(keywords, block->end, [](size_t pos, const pos::Element& elt) {
-			return pos < elt.begin;
-		});
-		if (itEnd != keywords.end())
-			block->end = itEnd->begin;
-
-		// Process the children blocks
-		for (const auto& child : scope.children())
-			extendBlock(child, elements);
+			// Find the element just before the start of the block
+			if (const auto previous = positions.elementBefore(block->begin))
+				block->begin = previous->end;
+
+			// Find the keyword just after the end of the block
+			if (const auto next = positions.nextOfType(block->end, ast::ElementType::keyword))
+				block->end = next->begin;
+
+			for (const auto& child : current->children())
+				pending.push_back(&child);
+		}
 	}
 } // namespace lac::comp
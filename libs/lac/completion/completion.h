@@ -1,8 +1,10 @@
 #pragma once
 
 #include <lac/parser/ast.h>
+#include <lac/parser/parser.h>
 #include <lac/parser/positions.h>
 #include <lac/analysis/scope.h>
+#include <lac/analysis/scope_cache.h>
 #include <lac/analysis/user_defined.h>
 
 #include <boost/optional.hpp>
@@ -24,7 +26,27 @@ namespace lac
 			void setUserDefined(lac::an::UserDefined userDefined);
 			lac::an::UserDefined userDefined() const;
 
+			// If enabled, only the top-level statements modified since the last update are parsed again
+			void setIncrementalParse(bool incremental);
+
+			// If enabled, the body of a function is only parsed when a position inside it is used
+			void setLazyParse(bool lazy);
+
+			// Stop the parse and the analysis of the following updates and queries once a limit is reached, see aborted.
+			// The deadline is a point in time: it must be set again before each update.
+			void setLimits(parser::Limits limits);
+
+			// If enabled, the scopes of the function bodies unchanged since the last update are not analysed again.
+			// Not used with the lazy parse.
+			void setReuseScopes(bool reuse);
+
+			// Returns false if the program has errors or a limit was reached, the valid statements being analysed nonetheless.
+			// The current position is only used by the lazy parse, the error recovery being done by the parser.
+			// With the lazy parse, the errors of the function bodies are only reported once they are expanded,
+			// by this position or by a later query inside them.
 			bool updateProgram(std::string_view str, size_t currentPosition = std::string_view::npos);
+			const parser::ParseErrors& parseErrors() const;
+			parser::AbortReason aborted() const; // First limit reached since the last update, the program then being partially analysed
 			an::ElementsMap getVariableCompletionList(std::string_view str, size_t pos = std::string_view::npos);
 			an::ElementsMap getArgumentCompletionList(std::string_view str, size_t pos = std::string_view::npos);
 			an::TypeInfo getTypeAtPos(std::string_view str, size_t pos);
@@ -32,10 +54,23 @@ namespace lac
 			std::vector<std::string> getTypeHierarchyAtPos(std::string_view str, size_t pos);
 
 		private:
+			parser::ParseOptions parseOptions() const;
+			bool analyseProgram(size_t position = std::string_view::npos); // Returns false if the expanded function bodies have errors
+			void expandAtPos(std::string_view str, size_t pos); // Parse and analyse the lazy function bodies containing pos
+
 			boost::optional<lac::an::UserDefined> m_userDefined;
+			std::shared_ptr<std::pmr::memory_resource> m_arena; // Owns the nodes of m_rootBlock
 			ast::Block m_rootBlock;
 			an::Scope m_rootScope;
+			an::ScopeCache m_scopeCache; // Scopes of the function bodies of the previous analysis
 			pos::Positions<std::string_view::const_iterator> m_positions;
+			std::shared_ptr<const std::string> m_parsedText; // The text corresponding to m_rootBlock, viewed by its literal strings
+			parser::ParseErrors m_parseErrors;
+			parser::Limits m_limits;
+			parser::AbortReason m_aborted = parser::AbortReason::none;
+			bool m_incrementalParse = true;
+			bool m_lazyParse = false;
+			bool m_reuseScopes = true;
 		};
 
 		// Remove the last member of the variable. If not possible, return empty.
@@ -48,7 +83,7 @@ namespace lac
 		an::ElementsMap getAutoCompletionList(const an::Scope& rootScope, std::string_view str, size_t pos = std::string_view::npos);
 		an::ElementsMap getAutoCompletionList(const an::Scope& localScope, const boost::optional<ast::VariableOrFunction>& var, CompletionFilter filter = CompletionFilter::none);
 
-		// Extend the block in the scope until the following keyword (and recurse over children)
-		void extendBlock(const an::Scope& scope, const pos::Elements& elements);
+		// Extend the block in the scope until the following keyword (and the blocks of its children)
+		void extendBlock(const an::Scope& scope, const pos::Positions<std::string_view::const_iterator>& positions);
 	} // namespace comp
 } // namespace lac
@@ -6,6 +6,7 @@
 #include <lac/helper/test_utils.h>
 #include <lac/parser/chunk.h>
 
+#include <atomic>
 #include <cctype>
 
 namespace lac::ast
@@ -13,7 +14,7 @@ namespace lac::ast
 	// The next functions are incomplete and must only be used for the tests in this file
 	bool operator==(const ast::Variable& lhs, const ast::Variable& rhs)
 	{
-		if (boost::get<std::string>(lhs.start) != boost::get<std::string>(rhs.start))
+		if (boost::get<ast::Atom>(lhs.start) != boost::get<ast::Atom>(rhs.start))
 			return false;
 
 		if (lhs.rest.size() != rhs.rest.size())
@@ -72,9 +73,9 @@ namespace lac::ast
 		if (!var)
 			return "{}";
 
-		std::string str = boost::get<std::string>(var->start);
+		std::string str = boost::get<ast::Atom>(var->start).str();
 		for (const auto& r : var->rest)
-			str += '.' + boost::get<TableIndexName>(r).name;
+			str += '.' + boost::get<TableIndexName>(r).name.str();
 
 		return str.c_str();
 	}
@@ -88,24 +89,24 @@ namespace lac::ast
 		if (var->start.get().type() == typeid(ast::Variable))
 		{
 			const auto& variable = boost::get<ast::Variable>(var->start);
-			str += boost::get<std::string>(variable.start);
+			str += boost::get<ast::Atom>(variable.start).str();
 			for (const auto& r : variable.rest)
-				str += '.' + boost::get<TableIndexName>(r).name;
+				str += '.' + boost::get<TableIndexName>(r).name.str();
 		}
 		else
 		{
 			const auto& variable = boost::get<ast::FunctionCall>(var->start);
-			str += boost::get<std::string>(variable.start);
+			str += boost::get<ast::Atom>(variable.start).str();
 			for (const auto& r : variable.rest)
 			{
-				if (r.tableIndex)
-					str += '.' + boost::get<TableIndexName>(*r.tableIndex).name;
+				for (const auto& ti : r.tableIndex)
+					str += '.' + boost::get<TableIndexName>(ti).name.str();
 				str += "()";
 			}
 		}
 
 		if (var->member)
-			str += ':' + var->member->name;
+			str += ':' + var->member->name.str();
 
 		return str.c_str();
 	}
@@ -348,9 +349,8 @@ myTable.m_meth2 = function(self, a) return a * 2 end
 
 		TEST_CASE("Completion with errors")
 		{
-			// This program does not compile because of an error on line 2
-			// but if we tell Completion that we are currently editing that line
-			// it will remove it and the program can compile
+			// This program does not compile because of an error on line 2,
+			// but the parser skips the invalid statement and the rest can be analysed
 			std::string program = R"~~(
 function test(first, second)
 	fir
@@ -359,10 +359,25 @@ end
 
 			Completion completion;
 			REQUIRE_FALSE(completion.updateProgram(program));
-			REQUIRE(completion.updateProgram(program, 32));
+			REQUIRE(completion.parseErrors().size() == 1);
+			CHECK(completion.parseErrors()[0].begin == 31);
+			CHECK(completion.parseErrors()[0].end == 34);
 
 			auto list = completion.getVariableCompletionList(program, 32);
 			CHECK(list.count("first") == 1);
+
+			// The error is not on the line being edited
+			program += "local x = 1\nlocal y = x.\n";
+			REQUIRE_FALSE(completion.updateProgram(program, 10));
+			list = completion.getVariableCompletionList(program, 32);
+			CHECK(list.count("first") == 1);
+			list = completion.getVariableCompletionList(program, program.size()); // Root scope
+			CHECK(list.count("test") == 1);
+			CHECK(list.count("x") == 1);
+			CHECK(list.count("y") == 1);
+
+			REQUIRE(completion.updateProgram("local z = 1"));
+			CHECK(completion.parseErrors().empty());
 		}
 
 		TEST_CASE("Completion with user defined types")
@@ -554,6 +569,177 @@ len = vec:length()
 			CHECK(getTypeHierarchyAtPos(scope, "getPos()[1]:length") == StrVec{ "Vector3", "length" });
 		}
 
+		TEST_CASE("Completion of sequence elements")
+		{
+			std::string program = R"~~(
+points = {
+	{x = 1, y = 2},
+	{x = 3, y = 4, name = 'end'},
+}
+)~~";
+
+			Completion completion;
+			REQUIRE(completion.updateProgram(program));
+
+			const auto list = completion.getVariableCompletionList("points[1].");
+			CHECK(list.size() == 3);
+			CHECK(list.count("x"));
+			CHECK(list.count("y"));
+			CHECK(list.count("name"));
+			CHECK(completion.getVariableCompletionList("points.").empty());
+		}
+
+		TEST_CASE("Incremental completion")
+		{
+			Completion incremental, full;
+			full.setIncrementalParse(false);
+
+			auto compare = [&](const std::string& text) {
+				CHECK(incremental.updateProgram(text) == full.updateProgram(text));
+				for (size_t pos = 0, size = text.size(); pos < size; pos += 7)
+				{
+					const auto incList = incremental.getVariableCompletionList(text, pos);
+					const auto fullList = full.getVariableCompletionList(text, pos);
+					CHECK(incList.size() == fullList.size());
+					for (const auto& it : fullList)
+						CHECK(incList.count(it.first) == 1);
+				}
+			};
+
+			// Type a new line in the middle of the program, one character at a time
+			std::string text = program;
+			compare(text);
+			const std::string line = "\tz = t.f(x, 'end')\n";
+			auto insertPos = text.find("\ty = ");
+			for (auto c : line)
+			{
+				text.insert(insertPos++, 1, c);
+				compare(text);
+			}
+
+			// Then remove it
+			text = program;
+			compare(text);
+		}
+
+		TEST_CASE("Completion reusing the scopes")
+		{
+			for (bool incremental : {true, false})
+			{
+				Completion reuse, fresh;
+				reuse.setIncrementalParse(incremental);
+				fresh.setReuseScopes(false);
+
+				auto compare = [&](const std::string& text) {
+					CHECK(reuse.updateProgram(text) == fresh.updateProgram(text));
+					for (size_t pos = 0, size = text.size(); pos < size; pos += 7)
+					{
+						const auto reuseList = reuse.getVariableCompletionList(text, pos);
+						const auto freshList = fresh.getVariableCompletionList(text, pos);
+						CHECK(reuseList.size() == freshList.size());
+						for (const auto& it : freshList)
+							CHECK(reuseList.count(it.first) == 1);
+						CHECK(reuse.getTypeAtPos(text, pos).type == fresh.getTypeAtPos(text, pos).type);
+					}
+				};
+
+				// Shift the functions, then modify the body of one of them and the type of a variable they use
+				std::string text = program;
+				compare(text);
+				text.insert(0, "-- Comment\n\n");
+				compare(text);
+				const auto valuePos = text.find("'world'");
+				text.replace(valuePos, 7, "42");
+				compare(text);
+				text.insert(0, "split = 1\n");
+				compare(text);
+			}
+		}
+
+		TEST_CASE("Lazy completion")
+		{
+			Completion full;
+			REQUIRE(full.updateProgram(program));
+
+			// The function bodies are parsed at the first query inside them
+			for (size_t pos = 0, size = program.size(); pos < size; pos += 5)
+			{
+				Completion lazy;
+				lazy.setLazyParse(true);
+				REQUIRE(lazy.updateProgram(program));
+				const auto lazyList = lazy.getVariableCompletionList(program, pos);
+				const auto fullList = full.getVariableCompletionList(program, pos);
+				CHECK(lazyList.size() == fullList.size());
+				for (const auto& it : fullList)
+					CHECK(lazyList.count(it.first) == 1);
+				CHECK(lazy.getTypeAtPos(program, pos).type == full.getTypeAtPos(program, pos).type);
+			}
+
+			// Or when updating the program with the current position
+			Completion lazy;
+			lazy.setLazyParse(true);
+			const auto pos = program.find("y = t.f");
+			REQUIRE(lazy.updateProgram(program, pos));
+			CHECK(lazy.getVariableCompletionList(program, pos).count("secondNum") == 0);
+			CHECK(lazy.getVariableCompletionList(program, pos).count("x") == 1);
+
+			// The statements parsed again by an incremental update keep their bodies lazy
+			std::string edited = program;
+			edited.replace(pos, 7, "z = t.f");
+			REQUIRE(lazy.updateProgram(edited));
+			CHECK(lazy.getVariableCompletionList(edited, pos).count("y") == 0);
+			CHECK(lazy.getVariableCompletionList(edited, pos).count("z") == 1);
+			CHECK(lazy.getVariableCompletionList(edited, pos).count("testValue") == 1);
+
+			// The errors of a body are reported once it is expanded
+			std::string invalid = program;
+			const auto bodyPos = invalid.find("return firstNum");
+			invalid.replace(bodyPos, 27, "ylocal y = inner return ,a");
+			Completion invalidFull;
+			CHECK_FALSE(invalidFull.updateProgram(invalid));
+			Completion invalidLazy;
+			invalidLazy.setLazyParse(true);
+			CHECK(invalidLazy.updateProgram(invalid));
+			CHECK(invalidLazy.parseErrors().empty());
+			invalidLazy.getVariableCompletionList(invalid, bodyPos);
+			REQUIRE_FALSE(invalidLazy.parseErrors().empty());
+			CHECK(invalidLazy.parseErrors().front().begin == bodyPos);
+
+			// The bodies are delimited before being parsed, so the recovery does not skip their end as in the full parse
+			CHECK_FALSE(invalidLazy.updateProgram(invalid, bodyPos));
+			REQUIRE(invalidLazy.parseErrors().size() == 2);
+			CHECK(invalidLazy.parseErrors().front().begin == bodyPos);
+			CHECK(invalidLazy.parseErrors().back().begin == invalid.find(",a"));
+			CHECK(invalidFull.parseErrors().size() == 5);
+		}
+
+		TEST_CASE("Completion limits")
+		{
+			Completion completion;
+			std::atomic<bool> cancel = true;
+			parser::Limits limits;
+			limits.cancel = &cancel;
+			completion.setLimits(limits);
+			CHECK_FALSE(completion.updateProgram(program));
+			CHECK(completion.aborted() == parser::AbortReason::cancelled);
+			CHECK(completion.parseErrors().empty());
+
+			cancel = false;
+			CHECK(completion.updateProgram(program));
+			CHECK(completion.aborted() == parser::AbortReason::none);
+			CHECK(completion.getVariableCompletionList(program).count("myFunc") == 1);
+
+			// Also when expanding a lazy function body
+			Completion lazy;
+			lazy.setLazyParse(true);
+			limits.maxDepth = 2;
+			lazy.setLimits(limits);
+			CHECK(lazy.updateProgram(program));
+			const auto pos = program.find("print('even')");
+			CHECK_FALSE(lazy.updateProgram(program, pos));
+			CHECK(lazy.aborted() == parser::AbortReason::depth);
+		}
+
 		TEST_SUITE_END();
 	} // namespace comp
 #endif
@@ -1,13 +1,20 @@
 #include <lac/completion/get_block.h>
 #include <lac/analysis/scope.h>
+#include <lac/parser/visitor.h>
 
 #include <lac/helper/algorithm.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace lac::pos
 {
 	using namespace ast;
 
-	class GetChildrenBlocks : public boost::static_visitor<void>
+	// Collect the blocks in the order of the source, with an explicit stack of the blocks and expressions
+	// still to visit instead of recursion, as generated code can nest them very deeply.
+	// The other nodes are visited directly, down to the blocks and expressions they contain.
+	class GetChildrenBlocks : public Dispatcher<GetChildrenBlocks, void>
 	{
 	public:
 		GetChildrenBlocks(Blocks& blocks)
@@ -15,240 +22,111 @@ namespace lac::pos
 		{
 		}
 
-		void operator()(ast::ExpressionConstant) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::Numeral&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::LiteralString&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const std::string&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::UnaryOperation& uo) const
-		{
-			(*this)(uo.expression);
-		}
-
-		void operator()(const ast::BinaryOperation& bo) const
-		{
-			(*this)(bo.expression);
-		}
-
-		void operator()(const ast::FieldByExpression& f) const
-		{
-			(*this)(f.key);
-			(*this)(f.value);
-		}
-
-		void operator()(const ast::FieldByAssignment& f) const
-		{
-			(*this)(f.value);
-		}
-
-		void operator()(const ast::Field& f) const
-		{
-			boost::apply_visitor(*this, f);
-		}
-
-		void operator()(const ast::TableConstructor& tc) const
+		void collect(const Block& root) const
 		{
-			if (tc.fields)
+			m_pending.push_back({&root, nullptr});
+			while (!m_pending.empty())
 			{
-				for (const auto& f : *tc.fields)
-					(*this)(f);
+				const auto item = m_pending.back();
+				m_pending.pop_back();
+				const auto first = m_pending.size();
+				if (item.block)
+					visitBlock(*item.block);
+				else
+					visitExpression(*item.expression);
+				std::reverse(m_pending.begin() + first, m_pending.end()); // The first child is visited next
 			}
 		}
 
-		void operator()(const ast::Operand& op) const
-		{
-			boost::apply_visitor(*this, op);
-		}
-
-		void operator()(const ast::BracketedExpression be) const
-		{
-			(*this)(be.expression);
-		}
-
-		void operator()(const ast::TableIndexExpression tie) const
-		{
-			(*this)(tie.expression);
-		}
-
-		void operator()(const ast::TableIndexName&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::EmptyArguments&) const
-		{
-			// Nothing to do here
-		}
-
-		void operator()(const ast::FunctionCallEnd& fce) const
-		{
-			boost::apply_visitor(*this, fce.arguments);
-		}
-
-		void operator()(const ast::PrefixExpression& pe) const
-		{
-			boost::apply_visitor(*this, pe.start);
-			for (const auto& pp : pe.rest)
-				boost::apply_visitor(*this, pp);
-		}
-
-		void operator()(const ast::VariableFunctionCall& vfc) const
-		{
-			(*this)(vfc.functionCall);
-			boost::apply_visitor(*this, vfc.postVariable);
-		}
-
-		void operator()(const ast::Variable& v) const
-		{
-			boost::apply_visitor(*this, v.start);
-			for (const auto& vp : v.rest)
-				boost::apply_visitor(*this, vp);
-		}
-
-		void operator()(const ast::Expression& e) const
-		{
-			(*this)(e.operand);
-			if (e.binaryOperation)
-				(*this)(*e.binaryOperation);
-		}
-
-		void operator()(const ast::ExpressionsList& el) const
-		{
-			for (const auto& ex : el)
-				(*this)(ex);
-		}
-
-		void operator()(const ast::ReturnStatement& rs) const
-		{
-			for (const auto& ex : rs.expressions)
-				(*this)(ex);
-		}
-
-		void operator()(const ast::FunctionBody& fb) const
-		{
-			(*this)(fb.block);
-		}
-
-		void operator()(const ast::EmptyStatement&) const
-		{
-		}
-
-		void operator()(const ast::AssignmentStatement& as) const
-		{
-			(*this)(as.expressions);
-		}
-
-		void operator()(const ast::FunctionCall&) const
-		{
-		}
-
-		void operator()(const ast::LabelStatement&) const
-		{
-		}
-
-		void operator()(const ast::GotoStatement&) const
-		{
-		}
-
-		void operator()(const ast::BreakStatement&) const
-		{
-		}
-
-		void operator()(const ast::DoStatement& ds) const
-		{
-			(*this)(ds.block);
-		}
-
-		void operator()(const ast::WhileStatement& ws) const
-		{
-			(*this)(ws.condition);
-			(*this)(ws.block);
-		}
-
-		void operator()(const ast::RepeatStatement& rs) const
-		{
-			(*this)(rs.block);
-			(*this)(rs.condition);
-		}
-
-		void operator()(const ast::IfStatement& s) const
-		{
-			(*this)(s.condition);
-			(*this)(s.block);
-		}
-
-		void operator()(const ast::IfThenElseStatement& s) const
-		{
-			(*this)(s.first);
-			for (const auto& es : s.rest)
-				(*this)(es);
-			if (s.elseBlock)
-				(*this)(*s.elseBlock);
-		}
-
-		void operator()(const ast::NumericalForStatement& s) const
-		{
-			(*this)(s.first);
-			(*this)(s.last);
-			if (s.step)
-				(*this)(*s.step);
-			(*this)(s.block);
-		}
-
-		void operator()(const ast::GenericForStatement& s) const
-		{
-			(*this)(s.expressions);
-			(*this)(s.block);
-		}
+		using Dispatcher::operator();
+
+		void operator()(const Block& b) const { m_pending.push_back({&b, nullptr}); }
+		void operator()(const Expression& ex) const { m_pending.push_back({nullptr, &ex}); }
+
+		template <typename T>
+		void operator()(const Vector<T>& nodes) const
+		{
+			for (const auto& node : nodes)
+				(*this)(node);
+		}
+
+		template <typename T>
+		void operator()(const boost::optional<T>& node) const
+		{
+			if (node)
+				(*this)(*node);
+		}
+
+		// Expressions
+		void operator()(ExpressionConstant) const {}
+		void operator()(const Numeral&) const {}
+		void operator()(const LiteralString&) const {}
+		void operator()(Atom) const {}
+		void operator()(const TableIndexName&) const {}
+		void operator()(const EmptyArguments&) const {}
+		void operator()(const UnaryOperation& uo) const { traverse(uo.expression); }
+		void operator()(const FieldByExpression& f) const { traverse(f.key, f.value); }
+		void operator()(const FieldByAssignment& f) const { traverse(f.value); }
+		void operator()(const TableConstructor& tc) const { traverse(tc.fields); }
+		void operator()(const BracketedExpression& be) const { traverse(be.expression); }
+		void operator()(const TableIndexExpression& tie) const { traverse(tie.expression); }
+		void operator()(const FunctionCallEnd& fce) const { traverse(fce.arguments); }
+		void operator()(const PrefixExpression& pe) const { traverse(pe.start, pe.rest); }
+		void operator()(const FunctionBody& fb) const { traverse(fb.block); } // The block is empty if lazy
+
+		// Statements, the variables of the assignments and the function calls are not visited
+		void operator()(const ReturnStatement& rs) const { traverse(rs.expressions); }
+		void operator()(const EmptyStatement&) const {}
+		void operator()(const AssignmentStatement& s) const { traverse(s.expressions); }
+		void operator()(const FunctionCall&) const {}
+		void operator()(const LabelStatement&) const {}
+		void operator()(const GotoStatement&) const {}
+		void operator()(const BreakStatement&) const {}
+		void operator()(const DoStatement& s) const { traverse(s.block); }
+		void operator()(const WhileStatement& s) const { traverse(s.condition, s.block); }
+		void operator()(const RepeatStatement& s) const { traverse(s.block, s.condition); }
+		void operator()(const IfStatement& s) const { traverse(s.condition, s.block); }
+		void operator()(const IfThenElseStatement& s) const { traverse(s.first, s.rest, s.elseBlock); }
+		void operator()(const NumericalForStatement& s) const { traverse(s.first, s.last, s.step, s.block); }
+		void operator()(const GenericForStatement& s) const { traverse(s.expressions, s.block); }
+		void operator()(const FunctionDeclarationStatement& s) const { traverse(s.body); }
+		void operator()(const LocalFunctionDeclarationStatement& s) const { traverse(s.body); }
+		void operator()(const LocalAssignmentStatement& s) const { traverse(s.expressions); }
 
-		void operator()(const ast::FunctionDeclarationStatement& s) const
+	private:
+		template <typename... Nodes>
+		void traverse(const Nodes&... nodes) const
 		{
-			(*this)(s.body);
+			((*this)(nodes), ...);
 		}
 
-		void operator()(const ast::LocalFunctionDeclarationStatement& s) const
+		struct Item
 		{
-			(*this)(s.body);
-		}
+			const Block* block;
+			const Expression* expression;
+		};
 
-		void operator()(const ast::LocalAssignmentStatement& s) const
+		void visitBlock(const Block& b) const
 		{
-			if (s.expressions)
-				(*this)(*s.expressions);
+			m_blocks.push_back(&b);
+			traverse(b.statements, b.returnStatement);
 		}
 
-		void operator()(const Block& b) const
+		void visitExpression(const Expression& ex) const
 		{
-			m_blocks.push_back(&b);
-			for (const auto& s : b.statements)
-				boost::apply_visitor(*this, s);
-			if (b.returnStatement)
-				(*this)(*b.returnStatement);
+			(*this)(ex.operand);
+			for (const auto& bo : ex.binaryOperations)
+				(*this)(bo.operand);
 		}
 
-	private:
 		Blocks& m_blocks;
+		mutable std::vector<Item> m_pending;
 	};
 
 	Blocks getChildren(const ast::Block& block)
 	{
 		Blocks blocks;
-		GetChildrenBlocks{blocks}(block);
+		GetChildrenBlocks{blocks}.collect(block);
 		return blocks;
 	}
 
@@ -279,13 +157,23 @@ namespace lac::pos
 		if (!block || block->begin > pos || block->end < pos)
 			return nullptr;
 
-		for (const auto& child : scope.children())
+		// Descend into the first child containing the position, without recursion as the scopes can be deeply nested
+		auto current = &scope;
+		for (auto next = current; next;)
 		{
-			const auto ptr = getScopeAtPos(child, pos);
-			if (ptr)
-				return ptr;
+			current = next;
+			next = nullptr;
+			for (const auto& child : current->children())
+			{
+				const auto childBlock = child.block();
+				if (childBlock && childBlock->begin <= pos && childBlock->end >= pos)
+				{
+					next = &child;
+					break;
+				}
+			}
 		}
 
-		return &scope;
+		return current;
 	}
 } // namespace lac::pos
@@ -10,7 +10,7 @@
 #endif
 namespace
 {
-	lac::an::TypeInfo getType(const lac::an::Scope& scope, const std::string& name)
+	lac::an::TypeInfo getType(const lac::an::Scope& scope, lac::ast::Atom name)
 	{
 		auto type = scope.getVariableType(name);
 		if (!type)
@@ -36,13 +36,13 @@ namespace
 			return scope.resolve(type.member(boost::get<lac::ast::TableIndexName>(vpf).name));
 		else if (vpfType == typeid(lac::ast::TableIndexExpression))
 		{
-			const auto tie = boost::get<lac::ast::TableIndexExpression>(vpf);
+			const auto& tie = boost::get<lac::ast::TableIndexExpression>(vpf);
 			if (type.type == lac::an::Type::array && lac::an::getType(scope, tie.expression).type == lac::an::Type::number)
-				return scope.resolve(lac::an::TypeInfo::fromTypeName(type.name));
+				return scope.resolve(type.elementType());
 		}
 		else if (vpfType == typeid(lac::ast::f_VariableFunctionCall))
 		{
-			const auto fc = boost::get<lac::ast::f_VariableFunctionCall>(vpf).get();
+			const auto& fc = boost::get<lac::ast::f_VariableFunctionCall>(vpf).get();
 			const auto parent = type;
 			if (fc.functionCall.member)
 				type = type.member(*fc.functionCall.member);
@@ -65,9 +65,9 @@ namespace
 				type = scope.resolve(type.member(boost::get<lac::ast::TableIndexName>(ti).name));
 			else
 			{
-				const auto tie = boost::get<lac::ast::TableIndexExpression>(ti);
+				const auto& tie = boost::get<lac::ast::TableIndexExpression>(ti);
 				if (type.type == lac::an::Type::array && lac::an::getType(scope, tie.expression).type == lac::an::Type::number)
-					return scope.resolve(lac::an::TypeInfo::fromTypeName(type.name));
+					return scope.resolve(type.elementType());
 				else
 					return lac::an::Type::unknown;
 			}
@@ -85,10 +85,10 @@ namespace
 
 	lac::an::TypeInfo getVariableType(const lac::an::Scope& localScope, const lac::ast::Variable& var)
 	{
-		if (var.start.get().type() != typeid(std::string))
+		if (var.start.get().type() != typeid(lac::ast::Atom))
 			return {};
 
-		auto type = getType(localScope, boost::get<std::string>(var.start));
+		auto type = getType(localScope, boost::get<lac::ast::Atom>(var.start));
 		for (const auto& r : var.rest)
 			type = processPostFix(localScope, type, r);
 
@@ -97,10 +97,10 @@ namespace
 
 	lac::an::TypeInfo getFunctionCallType(const lac::an::Scope& localScope, const lac::ast::FunctionCall& fc)
 	{
-		if (fc.start.get().type() != typeid(std::string))
+		if (fc.start.get().type() != typeid(lac::ast::Atom))
 			return {};
 
-		auto type = getType(localScope, boost::get<std::string>(fc.start));
+		auto type = getType(localScope, boost::get<lac::ast::Atom>(fc.start));
 		for (const auto& r : fc.rest)
 			type = processPostFix(localScope, type, r);
 
@@ -113,24 +113,24 @@ namespace
 		if (vpfType == typeid(lac::ast::TableIndexName))
 		{
 			const auto name = boost::get<lac::ast::TableIndexName>(vpf).name;
-			hierarchy.push_back(name);
+			hierarchy.push_back(name.str());
 			return scope.resolve(type.member(name));
 		}
 		else if (vpfType == typeid(lac::ast::TableIndexExpression))
 		{
 			hierarchy.clear();
-			const auto expression = boost::get<lac::ast::TableIndexExpression>(vpf).expression;
+			const auto& expression = boost::get<lac::ast::TableIndexExpression>(vpf).expression;
 			if (type.type == lac::an::Type::array && lac::an::getType(scope, expression).type == lac::an::Type::number)
 			{
-				hierarchy.push_back(type.name);
-				return scope.resolve(lac::an::TypeInfo::fromTypeName(type.name));
+				hierarchy.push_back(type.name.empty() ? type.elementType().typeName() : type.name);
+				return scope.resolve(type.elementType());
 			}
 			else
 				return lac::an::Type::unknown;
 		}
 		else if (vpfType == typeid(lac::ast::f_VariableFunctionCall))
 		{
-			const auto fc = boost::get<lac::ast::f_VariableFunctionCall>(vpf).get();
+			const auto& fc = boost::get<lac::ast::f_VariableFunctionCall>(vpf).get();
 			const auto parent = type;
 			if (fc.functionCall.member)
 				type = type.member(*fc.functionCall.member);
@@ -174,17 +174,17 @@ namespace
 			if (ti.get().type() == typeid(lac::ast::TableIndexName))
 			{
 				const auto name = boost::get<lac::ast::TableIndexName>(ti).name;
-				hierarchy.push_back(name);
+				hierarchy.push_back(name.str());
 				type = scope.resolve(type.member(name));
 			}
 			else
 			{
 				hierarchy.clear();
-				const auto expression = boost::get<lac::ast::TableIndexExpression>(ti).expression;
+				const auto& expression = boost::get<lac::ast::TableIndexExpression>(ti).expression;
 				if (type.type == lac::an::Type::array && lac::an::getType(scope, expression).type == lac::an::Type::number)
 				{
-					hierarchy.push_back(type.name);
-					return scope.resolve(lac::an::TypeInfo::fromTypeName(type.name));
+					hierarchy.push_back(type.name.empty() ? type.elementType().typeName() : type.name);
+					return scope.resolve(type.elementType());
 				}
 				else
 					return lac::an::Type::unknown;
@@ -222,10 +222,10 @@ namespace
 
 	std::vector<std::string> getTypeHierarchy(const lac::an::Scope& localScope, const lac::ast::Variable& var)
 	{
-		if (var.start.get().type() != typeid(std::string))
+		if (var.start.get().type() != typeid(lac::ast::Atom))
 			return {};
 
-		const auto& name = boost::get<std::string>(var.start);
+		const auto& name = boost::get<lac::ast::Atom>(var.start);
 
 		auto type = localScope.getVariableType(name);
 		if (!type)
@@ -242,9 +242,9 @@ namespace
 
 	std::vector<std::string> getTypeHierarchy(const lac::an::Scope& localScope, const lac::ast::FunctionCall& fc)
 	{
-		if (fc.start.get().type() != typeid(std::string))
+		if (fc.start.get().type() != typeid(lac::ast::Atom))
 			return {};
-		const auto& name = boost::get<std::string>(fc.start);
+		const auto& name = boost::get<lac::ast::Atom>(fc.start);
 
 		std::vector<std::string> hierarchy;
 		auto type = localScope.getVariableType(name);
@@ -330,7 +330,7 @@ namespace lac::comp
 			hierarchy = getTypeHierarchy(*scope, boost::get<ast::FunctionCall>(var->start));
 
 		if (var->member)
-			hierarchy.push_back(var->member->name);
+			hierarchy.push_back(var->member->name.str());
 		return hierarchy;
 	}
 #ifdef WITH_TESTS
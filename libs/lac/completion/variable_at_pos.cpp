@@ -202,8 +202,8 @@ namespace lac::comp
 		REQUIRE(var.has_value());
 		REQUIRE(var->start.get().type() == typeid(ast::Variable));
 		const auto& variable = boost::get<ast::Variable>(var->start);
-		REQUIRE(variable.start.get().type() == typeid(std::string));
-		CHECK(boost::get<std::string>(variable.start) == "foobar");
+		REQUIRE(variable.start.get().type() == typeid(ast::Atom));
+		CHECK(boost::get<ast::Atom>(variable.start) == "foobar");
 	}
 
 	TEST_CASE("Member variable")
@@ -226,8 +226,8 @@ namespace lac::comp
 		REQUIRE(var.has_value());
 		REQUIRE(var->start.get().type() == typeid(ast::Variable));
 		const auto& variable = boost::get<ast::Variable>(var->start);
-		REQUIRE(variable.start.get().type() == typeid(std::string));
-		CHECK(boost::get<std::string>(variable.start) == "first");
+		REQUIRE(variable.start.get().type() == typeid(ast::Atom));
+		CHECK(boost::get<ast::Atom>(variable.start) == "first");
 		REQUIRE(variable.rest.size() == 2);
 		REQUIRE(variable.rest[0].get().type() == typeid(ast::TableIndexName));
 		CHECK(boost::get<ast::TableIndexName>(variable.rest[0]).name == "second");
@@ -252,8 +252,8 @@ namespace lac::comp
 		REQUIRE(var.has_value());
 		REQUIRE(var->start.get().type() == typeid(ast::Variable));
 		const auto& variable = boost::get<ast::Variable>(var->start);
-		REQUIRE(variable.start.get().type() == typeid(std::string));
-		CHECK(boost::get<std::string>(variable.start) == "first");
+		REQUIRE(variable.start.get().type() == typeid(ast::Atom));
+		CHECK(boost::get<ast::Atom>(variable.start) == "first");
 		REQUIRE(variable.rest.size() == 1);
 		REQUIRE(variable.rest[0].get().type() == typeid(ast::TableIndexName));
 		CHECK(boost::get<ast::TableIndexName>(variable.rest[0]).name == "second");
@@ -19,7 +19,7 @@ namespace lac::helper
 		return boost::get<ast::Numeral>(op);
 	}
 	
-	boost::optional<const std::string&> getLiteralString(const ast::Arguments& args, size_t index)
+	boost::optional<std::string> getLiteralString(const ast::Arguments& args, size_t index)
 	{
 		if (args.get().type() != typeid(ast::ExpressionsList))
 			return {};
@@ -32,7 +32,7 @@ namespace lac::helper
 		if (op.get().type() != typeid(ast::LiteralString))
 			return {};
 
-		return boost::get<ast::LiteralString>(op).value;
+		return boost::get<ast::LiteralString>(op).value();
 	}
 
 	an::TypeInfo getType(const an::Scope& scope, const ast::Arguments& args, size_t index)
@@ -11,6 +11,6 @@ namespace lac::an
 namespace lac::helper
 {
 	CORE_API boost::optional<const ast::Numeral&> getNumeral(const ast::Arguments& args, size_t index = 0);
-	CORE_API boost::optional<const std::string&> getLiteralString(const ast::Arguments& args, size_t index = 0);
+	CORE_API boost::optional<std::string> getLiteralString(const ast::Arguments& args, size_t index = 0);
 	CORE_API an::TypeInfo getType(const an::Scope& scope, const ast::Arguments& args, size_t index = 0);
 } // namespace lac::helper
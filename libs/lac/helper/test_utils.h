@@ -5,10 +5,96 @@
 #include <boost/spirit/home/x3.hpp>
 #ifdef WITH_TESTS
 #include <doctest/doctest.h>
+#include <exception>
+#include <functional>
+#include <memory_resource>
 #include <string_view>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 namespace lac::helper
 {
+	// Count the allocations of the nodes of the tree, when set as the current resource with ast::ScopedResource
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		size_t allocated = 0;   // Bytes
+		size_t allocations = 0; // Calls
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			allocated += bytes;
+			++allocations;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+		{
+			std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	// Run the function on a thread with the given stack size, to test the depth a traversal supports.
+	// An exception, as thrown by a failed REQUIRE, is rethrown in the calling thread.
+	inline void runWithStack(size_t stackSize, const std::function<void()>& function)
+	{
+		struct Call
+		{
+			const std::function<void()>& function;
+			std::exception_ptr exception;
+
+			void operator()()
+			{
+				try
+				{
+					function();
+				}
+				catch (...)
+				{
+					exception = std::current_exception();
+				}
+			}
+		} call{function, {}};
+
+#ifdef _WIN32
+		const auto thread = CreateThread(nullptr, stackSize, [](LPVOID arg) -> DWORD {
+			(*static_cast<Call*>(arg))();
+			return 0;
+		}, &call, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+		REQUIRE(thread);
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+#else
+		pthread_attr_t attributes;
+		pthread_attr_init(&attributes);
+		pthread_attr_setstacksize(&attributes, stackSize);
+		pthread_t thread;
+		const auto created = pthread_create(&thread, &attributes, [](void* arg) -> void* {
+			(*static_cast<Call*>(arg))();
+			return nullptr;
+		}, &call);
+		pthread_attr_destroy(&attributes);
+		REQUIRE(created == 0);
+		pthread_join(thread, nullptr);
+#endif
+
+		if (call.exception)
+			std::rethrow_exception(call.exception);
+	}
+
 	// Attributes are given by the caller
 	template <class P, class... Args>
 	bool test_parser(std::string_view input, const P& p, Args&... args)
@@ -0,0 +1,53 @@
+#include <lac/parser/arena.h>
+
+#include <cassert>
+
+namespace
+{
+	thread_local std::pmr::memory_resource* currentResourcePtr = nullptr;
+}
+
+namespace lac::ast
+{
+	std::pmr::memory_resource* currentResource()
+	{
+		return currentResourcePtr ? currentResourcePtr : std::pmr::new_delete_resource();
+	}
+
+	ScopedResource::ScopedResource(std::pmr::memory_resource* resource)
+		: m_previous(currentResourcePtr)
+	{
+		currentResourcePtr = resource;
+	}
+
+	ScopedResource::~ScopedResource()
+	{
+		currentResourcePtr = m_previous;
+	}
+
+	Arena::Arena(std::size_t initialSize)
+		: std::pmr::monotonic_buffer_resource(initialSize)
+	{
+	}
+
+	Arena::~Arena()
+	{
+		assert(m_allocations == 0 && "The nodes of the block must be destroyed before their arena");
+	}
+
+	void* Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+#ifndef NDEBUG
+		++m_allocations;
+#endif
+		return std::pmr::monotonic_buffer_resource::do_allocate(bytes, alignment);
+	}
+
+	void Arena::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+	{
+#ifndef NDEBUG
+		--m_allocations;
+#endif
+		std::pmr::monotonic_buffer_resource::do_deallocate(ptr, bytes, alignment);
+	}
+} // namespace lac::ast
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <lac/core_api.h>
+
+#include <boost/spirit/home/x3/support/ast/variant.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Allocation of the AST nodes: containers and forward nodes use the memory resource current at their creation.
+// It is the heap by default, or the arena of the parse when ParseOptions::useArena is set.
+namespace lac::ast
+{
+	// Memory resource used by the nodes created in this thread
+	CORE_API std::pmr::memory_resource* currentResource();
+
+	// Change the current resource of this thread during the life of this object
+	class CORE_API ScopedResource
+	{
+	public:
+		ScopedResource(std::pmr::memory_resource* resource);
+		~ScopedResource();
+
+		ScopedResource(const ScopedResource&) = delete;
+		ScopedResource& operator=(const ScopedResource&) = delete;
+
+	private:
+		std::pmr::memory_resource* m_previous;
+	};
+
+	// Monotonic arena of the nodes of a parse. The nodes must be destroyed before it, even if the block was moved:
+	// in debug builds, it counts the allocations not yet deallocated and asserts there are none left when destroyed.
+	class CORE_API Arena : public std::pmr::monotonic_buffer_resource
+	{
+	public:
+		explicit Arena(std::size_t initialSize);
+		~Arena() override;
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+	private:
+		std::size_t m_allocations = 0; // Only counted in debug builds
+	};
+
+	// Same as std::pmr::polymorphic_allocator, but keeps its resource when moved,
+	// as the owner of the arena keeps it alive with the nodes
+	template <class T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		Allocator() noexcept
+			: m_resource(currentResource())
+		{
+		}
+
+		template <class U>
+		Allocator(const Allocator<U>& other) noexcept
+			: m_resource(other.resource())
+		{
+		}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* ptr, std::size_t n)
+		{
+			m_resource->deallocate(ptr, n * sizeof(T), alignof(T));
+		}
+
+		// Copies are done in the current resource
+		Allocator select_on_container_copy_construction() const
+		{
+			return {};
+		}
+
+		std::pmr::memory_resource* resource() const
+		{
+			return m_resource;
+		}
+
+	private:
+		std::pmr::memory_resource* m_resource;
+	};
+
+	template <class T, class U>
+	bool operator==(const Allocator<T>& lhs, const Allocator<U>& rhs)
+	{
+		return *lhs.resource() == *rhs.resource();
+	}
+
+	template <class T, class U>
+	bool operator!=(const Allocator<T>& lhs, const Allocator<U>& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	template <class T>
+	using Vector = std::vector<T, Allocator<T>>;
+
+	// Same as x3::forward_ast, using the current resource
+	template <class T>
+	class Forward
+	{
+	public:
+		using type = T;
+
+		Forward()
+			: m_ptr(create())
+		{
+		}
+
+		Forward(const Forward& other)
+			: m_ptr(create(other.get()))
+		{
+		}
+
+		Forward(Forward&& other) noexcept
+			: m_resource(other.m_resource)
+			, m_ptr(other.m_ptr)
+		{
+			other.m_ptr = nullptr;
+		}
+
+		Forward(const T& value)
+			: m_ptr(create(value))
+		{
+		}
+
+		Forward(T&& value)
+			: m_ptr(create(std::move(value)))
+		{
+		}
+
+		~Forward()
+		{
+			if (m_ptr)
+			{
+				m_ptr->~T();
+				m_resource->deallocate(m_ptr, sizeof(T), alignof(T));
+			}
+		}
+
+		Forward& operator=(const Forward& rhs)
+		{
+			get() = rhs.get();
+			return *this;
+		}
+
+		Forward& operator=(Forward&& rhs) noexcept
+		{
+			swap(rhs);
+			return *this;
+		}
+
+		Forward& operator=(const T& rhs)
+		{
+			get() = rhs;
+			return *this;
+		}
+
+		Forward& operator=(T&& rhs)
+		{
+			get() = std::move(rhs);
+			return *this;
+		}
+
+		void swap(Forward& other) noexcept
+		{
+			std::swap(m_resource, other.m_resource);
+			std::swap(m_ptr, other.m_ptr);
+		}
+
+		T& get() noexcept { return *m_ptr; }
+		const T& get() const noexcept { return *m_ptr; }
+
+		T* get_pointer() noexcept { return m_ptr; }
+		const T* get_pointer() const noexcept { return m_ptr; }
+
+		operator const T&() const noexcept { return get(); }
+		operator T&() noexcept { return get(); }
+
+	private:
+		template <class... Args>
+		T* create(Args&&... args)
+		{
+			const auto ptr = m_resource->allocate(sizeof(T), alignof(T));
+			try
+			{
+				return new (ptr) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				m_resource->deallocate(ptr, sizeof(T), alignof(T));
+				throw;
+			}
+		}
+
+		std::pmr::memory_resource* m_resource = currentResource(); // Must be initialized before m_ptr
+		T* m_ptr = nullptr;
+	};
+
+	template <class T>
+	void swap(Forward<T>& lhs, Forward<T>& rhs) noexcept
+	{
+		lhs.swap(rhs);
+	}
+} // namespace lac::ast
+
+namespace boost::spirit::x3::detail
+{
+	// So that x3::variant lists the type itself, as for forward_ast
+	template <typename T>
+	struct remove_forward<lac::ast::Forward<T>> : mpl::identity<T>
+	{
+	};
+} // namespace boost::spirit::x3::detail
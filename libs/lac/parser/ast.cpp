@@ -0,0 +1,68 @@
+#include <lac/parser/ast.h>
+
+namespace lac::ast
+{
+	std::string LiteralString::value() const
+	{
+		if (source.size() < 2)
+			return {};
+
+		// Long bracket: no escape sequence
+		if (source.front() == '[')
+		{
+			const auto level = source.find_first_not_of('=', 1) - 1;
+			return std::string{source.substr(level + 2, source.size() - 2 * (level + 2))};
+		}
+
+		// Short string: only the delimiter can be escaped
+		const auto quote = source.front();
+		const auto content = source.substr(1, source.size() - 2);
+		std::string str;
+		str.reserve(content.size());
+		for (size_t i = 0, nb = content.size(); i < nb; ++i)
+		{
+			if (content[i] == '\\' && i + 1 < nb && content[i + 1] == quote)
+				++i;
+			str.push_back(content[i]);
+		}
+		return str;
+	}
+
+	int precedence(Operation operation)
+	{
+		switch (operation)
+		{
+		case Operation::lor: return 1;
+		case Operation::land: return 2;
+		case Operation::lt:
+		case Operation::le:
+		case Operation::gt:
+		case Operation::ge:
+		case Operation::eq:
+		case Operation::ineq: return 3;
+		case Operation::bor: return 4;
+		case Operation::bxor: return 5;
+		case Operation::band: return 6;
+		case Operation::shl:
+		case Operation::shr: return 7;
+		case Operation::concat: return 8;
+		case Operation::add:
+		case Operation::sub: return 9;
+		case Operation::mul:
+		case Operation::div:
+		case Operation::idiv:
+		case Operation::mod: return 10;
+		case Operation::unm:
+		case Operation::len:
+		case Operation::bnot:
+		case Operation::lnot: return 11;
+		case Operation::pow: return 12;
+		default: return 0;
+		}
+	}
+
+	bool isRightAssociative(Operation operation)
+	{
+		return operation == Operation::concat || operation == Operation::pow;
+	}
+} // namespace lac::ast
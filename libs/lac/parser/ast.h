@@ -6,6 +6,8 @@
 #endif
 
 #include <lac/core_api.h>
+#include <lac/parser/arena.h>
+#include <lac/parser/atom.h>
 
 #include <boost/spirit/home/x3/support/ast/variant.hpp>
 #include <boost/spirit/home/x3/auxiliary.hpp>
@@ -13,11 +15,13 @@
 #include <boost/fusion/include/io.hpp>
 #include <boost/optional.hpp>
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace lac::ast
 {
-	enum class CORE_API ElementType
+	enum class CORE_API ElementType : uint8_t
 	{
 		not_defined,
 		keyword,
@@ -79,10 +83,10 @@ namespace lac::ast
 	};
 
 	struct UnaryOperation;
-	using f_UnaryOperation = boost::spirit::x3::forward_ast<UnaryOperation>;
+	using f_UnaryOperation = Forward<UnaryOperation>;
 
 	struct Field;
-	using FieldsList = std::vector<Field>;
+	using FieldsList = Vector<Field>;
 
 	struct TableConstructor
 	{
@@ -90,30 +94,32 @@ namespace lac::ast
 	};
 
 	struct PrefixExpression;
-	using f_PrefixExpression = boost::spirit::x3::forward_ast<PrefixExpression>;
+	using f_PrefixExpression = Forward<PrefixExpression>;
 
 	struct FunctionBody;
-	using f_FunctionBody = boost::spirit::x3::forward_ast<FunctionBody>;
+	using f_FunctionBody = Forward<FunctionBody>;
 
-	struct Numeral : boost::spirit::x3::variant<int, double>, ElementAnnotated<ElementType::numeral>
+	struct Numeral : boost::spirit::x3::variant<int64_t, double>, ElementAnnotated<ElementType::numeral>
 	{
 		Numeral() = default;
 		Numeral(const Numeral& other) = default;
 		Numeral& operator=(const Numeral&) = default;
+		Numeral(Numeral&&) = default;
+		Numeral& operator=(Numeral&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
 
-		bool isInt() const { return get().type() == typeid(int); }
+		bool isInt() const { return get().type() == typeid(int64_t); }
 		bool isFloat() const { return get().type() == typeid(double); }
 
-		int asInt() const { return boost::get<int>(get()); }
+		int64_t asInt() const { return boost::get<int64_t>(get()); }
 		double asFloat() const { return boost::get<double>(get()); }
 
 		double value() const
 		{
 			if (isInt())
-				return asInt();
+				return static_cast<double>(asInt());
 			else
 				return asFloat();
 		}
@@ -121,7 +127,9 @@ namespace lac::ast
 
 	struct LiteralString : ElementAnnotated<ElementType::literal_string>
 	{
-		std::string value;
+		std::string_view source; // View of the parsed buffer, with the delimiters. Moved with the buffer by pos::rebaseLiterals
+
+		CORE_API std::string value() const; // Decoded on each call
 	};
 
 	struct Operand
@@ -138,6 +146,8 @@ namespace lac::ast
 		Operand() = default;
 		Operand(const Operand& other) = default;
 		Operand& operator=(const Operand&) = default;
+		Operand(Operand&&) = default;
+		Operand& operator=(Operand&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -149,34 +159,33 @@ namespace lac::ast
 		LiteralString asLiteral() const { return boost::get<LiteralString>(get()); }
 	};
 
-	using NamesList = std::vector<std::string>;
+	using NamesList = Vector<Atom>;
 
-	struct BinaryOperation;
-	using f_BinaryOperation = boost::spirit::x3::forward_ast<BinaryOperation>;
+	struct BinaryOperation
+	{
+		Operation operation;
+		Operand operand;
+	};
 
+	// Operands separated by binary operators, without precedence: see foldExpression
 	struct Expression
 	{
 		Operand operand;
-		boost::optional<f_BinaryOperation> binaryOperation;
+		Vector<BinaryOperation> binaryOperations;
 	};
 
-	using ExpressionsList = std::vector<Expression>;
+	using ExpressionsList = Vector<Expression>;
 
+	// The expression of a unary operation is only its operand and the following exponentiations
 	struct UnaryOperation
 	{
 		Operation operation;
 		Expression expression;
 	};
 
-	struct BinaryOperation
-	{
-		BinaryOperation() = default;
-		BinaryOperation(const BinaryOperation&) = default;
-		BinaryOperation& operator=(const BinaryOperation&) = default;
-
-		Operation operation;
-		Expression expression;
-	};
+	// Priority of a binary operator, the greater the tighter
+	CORE_API int precedence(Operation operation);
+	CORE_API bool isRightAssociative(Operation operation);
 
 	struct FieldByExpression
 	{
@@ -185,7 +194,7 @@ namespace lac::ast
 
 	struct FieldByAssignment
 	{
-		std::string name;
+		Atom name;
 		Expression value;
 	};
 
@@ -198,6 +207,8 @@ namespace lac::ast
 		Field() = default;
 		Field(const Field& other) = default;
 		Field& operator=(const Field&) = default;
+		Field(Field&&) = default;
+		Field& operator=(Field&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -215,7 +226,7 @@ namespace lac::ast
 
 	struct TableIndexName
 	{
-		std::string name;
+		Atom name;
 	};
 
 	struct ParametersList
@@ -238,6 +249,8 @@ namespace lac::ast
 		Arguments() = default;
 		Arguments(const Arguments&) = default;
 		Arguments& operator=(const Arguments&) = default;
+		Arguments(Arguments&&) = default;
+		Arguments& operator=(Arguments&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -245,7 +258,7 @@ namespace lac::ast
 
 	struct FunctionCallEnd : ElementAnnotated<ElementType::function>
 	{
-		boost::optional<std::string> member;
+		boost::optional<Atom> member;
 		Arguments arguments;
 	};
 
@@ -257,6 +270,8 @@ namespace lac::ast
 		PostPrefix() = default;
 		PostPrefix(const PostPrefix&) = default;
 		PostPrefix& operator=(const PostPrefix&) = default;
+		PostPrefix(PostPrefix&&) = default;
+		PostPrefix& operator=(PostPrefix&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -264,12 +279,12 @@ namespace lac::ast
 
 	struct PrefixExpression
 	{
-		boost::spirit::x3::variant<BracketedExpression, std::string> start;
-		std::vector<PostPrefix> rest;
+		boost::spirit::x3::variant<BracketedExpression, Atom> start;
+		Vector<PostPrefix> rest;
 	};
 
 	struct VariableFunctionCall;
-	using f_VariableFunctionCall = boost::spirit::x3::forward_ast<VariableFunctionCall>;
+	using f_VariableFunctionCall = Forward<VariableFunctionCall>;
 
 	struct VariablePostfix : boost::spirit::x3::variant<
 								 TableIndexExpression,
@@ -279,6 +294,8 @@ namespace lac::ast
 		VariablePostfix() = default;
 		VariablePostfix(const VariablePostfix&) = default;
 		VariablePostfix& operator=(const VariablePostfix&) = default;
+		VariablePostfix(VariablePostfix&&) = default;
+		VariablePostfix& operator=(VariablePostfix&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -292,35 +309,35 @@ namespace lac::ast
 
 	struct Variable : ElementAnnotated<ElementType::variable>
 	{
-		boost::spirit::x3::variant<BracketedExpression, std::string> start;
-		std::vector<VariablePostfix> rest;
+		boost::spirit::x3::variant<BracketedExpression, Atom> start;
+		Vector<VariablePostfix> rest;
 	};
 
-	using VariablesList = std::vector<Variable>;
+	using VariablesList = Vector<Variable>;
 
 	struct FunctionNameMember
 	{
-		std::string name;
+		Atom name;
 	};
 
 	struct FunctionName
 	{
-		std::string start;
-		std::vector<std::string> rest;
+		Atom start;
+		Vector<Atom> rest;
 		boost::optional<FunctionNameMember> member;
 	};
 
 	using TableIndex = boost::spirit::x3::variant<TableIndexExpression, TableIndexName>;
 	struct FunctionCallPostfix
 	{
-		std::vector < TableIndex > tableIndex;
+		Vector<TableIndex> tableIndex;
 		FunctionCallEnd functionCall;
 	};
 
 	struct FunctionCall
 	{
-		boost::spirit::x3::variant< BracketedExpression, std::string> start;
-		std::vector<FunctionCallPostfix> rest;
+		boost::spirit::x3::variant<BracketedExpression, Atom> start;
+		Vector<FunctionCallPostfix> rest;
 	};
 
 	// This is not part of the Lua language, but we use it for completion
@@ -332,21 +349,28 @@ namespace lac::ast
 
 	struct ReturnStatement
 	{
-		std::vector<Expression> expressions;
+		Vector<Expression> expressions;
 	};
 
 	struct Statement;
 
 	struct Block : public PositionAnnotated
 	{
-		std::vector<Statement> statements;
+		Vector<Statement> statements;
 		boost::optional<ReturnStatement> returnStatement;
+		mutable size_t hash = 0; // Structural hash, 0 if not computed (see ast::hashBlocks)
+	};
+
+	// Range of a function block that was not parsed (see parser::ParseOptions::lazyFunctionBodies)
+	struct LazyBlock : public PositionAnnotated
+	{
 	};
 
 	struct FunctionBody
 	{
 		boost::optional<ParametersList> parameters;
-		Block block;
+		Block block; // Empty while lazy is set
+		boost::optional<LazyBlock> lazy; // Reset when the block is parsed by parser::expandFunctionBody
 	};
 
 	struct EmptyStatement
@@ -361,12 +385,12 @@ namespace lac::ast
 
 	struct LabelStatement
 	{
-		std::string name;
+		Atom name;
 	};
 
 	struct GotoStatement
 	{
-		std::string label;
+		Atom label;
 	};
 
 	struct BreakStatement
@@ -399,13 +423,13 @@ namespace lac::ast
 	struct IfThenElseStatement
 	{
 		IfStatement first;
-		std::vector<IfStatement> rest;
+		Vector<IfStatement> rest;
 		boost::optional<Block> elseBlock;
 	};
 
 	struct NumericalForStatement
 	{
-		std::string variable;
+		Atom variable;
 		Expression first, last;
 		boost::optional<Expression> step;
 		Block block;
@@ -426,7 +450,7 @@ namespace lac::ast
 
 	struct LocalFunctionDeclarationStatement
 	{
-		std::string name;
+		Atom name;
 		FunctionBody body;
 	};
 
@@ -451,11 +475,14 @@ namespace lac::ast
 						   GenericForStatement,
 						   FunctionDeclarationStatement,
 						   LocalFunctionDeclarationStatement,
-						   LocalAssignmentStatement>
+						   LocalAssignmentStatement>,
+					   PositionAnnotated
 	{
 		Statement() = default;
 		Statement(const Statement&) = default;
 		Statement& operator=(const Statement&) = default;
+		Statement(Statement&&) = default;
+		Statement& operator=(Statement&&) = default;
 
 		using base_type::base_type;
 		using base_type::operator=;
@@ -3,11 +3,11 @@
 #include <lac/parser/ast.h>
 #include <boost/fusion/include/adapt_struct.hpp>
 
-BOOST_FUSION_ADAPT_STRUCT(lac::ast::LiteralString, value)
+BOOST_FUSION_ADAPT_STRUCT(lac::ast::LiteralString, source)
 
 BOOST_FUSION_ADAPT_STRUCT(lac::ast::UnaryOperation, operation, expression)
-BOOST_FUSION_ADAPT_STRUCT(lac::ast::BinaryOperation, operation, expression)
-BOOST_FUSION_ADAPT_STRUCT(lac::ast::Expression, operand, binaryOperation)
+BOOST_FUSION_ADAPT_STRUCT(lac::ast::BinaryOperation, operation, operand)
+BOOST_FUSION_ADAPT_STRUCT(lac::ast::Expression, operand, binaryOperations)
 
 BOOST_FUSION_ADAPT_STRUCT(lac::ast::FieldByExpression, key, value)
 BOOST_FUSION_ADAPT_STRUCT(lac::ast::FieldByAssignment, name, value)
@@ -0,0 +1,872 @@
+#include <lac/parser/ast_cache.h>
+#include <lac/parser/ast_adapted.h>
+#include <lac/parser/structural_hash.h>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/fusion/include/for_each.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef WITH_TESTS
+#include <lac/helper/test_utils.h>
+#include <doctest/doctest.h>
+#endif
+
+// Layout of the image, in the native byte order as the files are only shared on the same machine:
+// header (magic, version, size and hash of the source, parse status), names, errors, elements, then the tree.
+// The numbers are variable-length, and the positions of the nodes are relative to the start of the previous node,
+// so most of them take one byte. The elements are stored as the arrays of pos::Positions, to be copied at once.
+namespace lac::parser
+{
+	namespace
+	{
+		constexpr char magic[4] = {'L', 'A', 'C', 'T'};
+
+		// Signed differences as small unsigned numbers: 0, -1, 1, -2...
+		uint64_t zigzag(uint64_t difference)
+		{
+			const auto value = static_cast<int64_t>(difference);
+			return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		}
+
+		uint64_t unzigzag(uint64_t value)
+		{
+			return (value >> 1) ^ (0 - (value & 1));
+		}
+
+		// FNV-1a, stable between builds and platforms
+		uint64_t hashSource(std::string_view view)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (const auto c : view)
+			{
+				hash ^= static_cast<uint8_t>(c);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		// The nodes deriving from x3::variant
+		template <typename T, typename = void>
+		inline constexpr bool is_variant = false;
+
+		template <typename T>
+		inline constexpr bool is_variant<T, std::void_t<typename T::variant_type>> = true;
+
+		// Last valid value of the enums read from an image
+		constexpr int lastValue(ast::Operation) { return static_cast<int>(ast::Operation::lor); }
+		constexpr int lastValue(ast::ExpressionConstant) { return static_cast<int>(ast::ExpressionConstant::True); }
+		constexpr int lastValue(ast::ElementType) { return static_cast<int>(ast::ElementType::member_function); }
+
+		// Writes the nodes in pre-order: the positions of a node, then its members in the order of their fusion adaptation
+		class Writer
+		{
+		public:
+			Writer(std::string_view view, size_t maxDepth = maxCacheDepth)
+				: m_view(view)
+				, m_maxDepth(maxDepth)
+			{
+			}
+
+			template <typename T>
+			void raw(T value)
+			{
+				const auto size = m_data.size();
+				m_data.resize(size + sizeof(T));
+				std::memcpy(m_data.data() + size, &value, sizeof(T));
+			}
+
+			void bytes(const void* data, size_t size)
+			{
+				m_data.append(static_cast<const char*>(data), size);
+			}
+
+			// LEB128: 7 bits per byte, the high bit set on all bytes but the last
+			void number(uint64_t value)
+			{
+				for (; value >= 0x80; value >>= 7)
+					m_data.push_back(static_cast<char>(value | 0x80));
+				m_data.push_back(static_cast<char>(value));
+			}
+
+			void operator()(const ast::Block& b)
+			{
+				positions(b);
+				members(b);
+			}
+
+			void operator()(const ast::FunctionBody& fb)
+			{
+				members(fb);
+				(*this)(fb.lazy);
+			}
+
+			void operator()(const ast::LazyBlock& lb) { positions(lb); }
+			void operator()(const ast::EmptyArguments&) {}
+			void operator()(const ast::EmptyStatement&) {}
+			void operator()(const ast::BreakStatement&) {}
+
+			void operator()(ast::Atom atom)
+			{
+				const auto [it, inserted] = m_nameIndices.emplace(atom.id(), static_cast<uint32_t>(m_names.size()));
+				if (inserted)
+					m_names.push_back(atom);
+				number(it->second);
+			}
+
+			// The source of a literal string
+			void operator()(std::string_view source)
+			{
+				const auto begin = reinterpret_cast<uintptr_t>(source.data()), viewBegin = reinterpret_cast<uintptr_t>(m_view.data());
+				if (!source.empty() && (begin < viewBegin || begin + source.size() > viewBegin + m_view.size()))
+					m_valid = false; // Does not view the source, as after reparseBlock with another buffer
+				number(zigzag((source.empty() ? 0 : begin - viewBegin) - m_lastBegin));
+				number(source.size());
+			}
+
+			template <typename T>
+			void operator()(const ast::Vector<T>& nodes)
+			{
+				if (!enter())
+					return;
+				number(nodes.size());
+				for (const auto& node : nodes)
+					(*this)(node);
+				--m_depth;
+			}
+
+			template <typename T>
+			void operator()(const boost::optional<T>& node)
+			{
+				raw(static_cast<uint8_t>(node.is_initialized()));
+				if (node)
+					(*this)(*node);
+			}
+
+			template <typename T>
+			void operator()(const ast::Forward<T>& node)
+			{
+				if (!enter())
+					return;
+				(*this)(node.get());
+				--m_depth;
+			}
+
+			template <typename T>
+			void operator()(const T& node)
+			{
+				if constexpr (std::is_arithmetic_v<T>)
+					raw(node);
+				else if constexpr (std::is_enum_v<T>)
+					number(static_cast<uint64_t>(node));
+				else
+				{
+					if constexpr (pos::is_position_annotated<T>)
+						positions(node);
+					if constexpr (is_variant<T>)
+					{
+						raw(static_cast<uint8_t>(node.get().which()));
+						boost::apply_visitor([this](const auto& value) { (*this)(value); }, node.get());
+					}
+					else
+						members(node);
+				}
+			}
+
+			bool valid() const { return m_valid; }
+			const std::string& data() const { return m_data; }
+			const std::vector<ast::Atom>& names() const { return m_names; }
+
+		private:
+			// Stop writing a tree that would be too deep to read back
+			bool enter()
+			{
+				if (m_depth == m_maxDepth)
+					m_valid = false;
+				if (!m_valid)
+					return false;
+				++m_depth;
+				return true;
+			}
+
+			void positions(const ast::PositionAnnotated& node)
+			{
+				number(zigzag(node.begin - m_lastBegin));
+				number(zigzag(node.end - node.begin)); // The end of an empty block is before its start
+				m_lastBegin = node.begin;
+			}
+
+			template <typename T>
+			void members(const T& node)
+			{
+				static_assert(boost::fusion::traits::is_sequence<T>::value, "The node must be adapted or have its own overload");
+				boost::fusion::for_each(node, [this](const auto& member) { (*this)(member); });
+			}
+
+			std::string_view m_view;
+			std::string m_data;
+			std::vector<ast::Atom> m_names;
+			std::unordered_map<uint32_t, uint32_t> m_nameIndices; // Of the ids in the names
+			size_t m_lastBegin = 0;
+			size_t m_depth = 0, m_maxDepth;
+			bool m_valid = true;
+		};
+
+		// Reads the nodes written by Writer, checking each read against the end of the image, and the depth of the tree.
+		// Once invalid, the reads return zeros so the recursion ends quickly.
+		class Reader
+		{
+		public:
+			Reader(std::string_view image, std::string_view view)
+				: m_pos(image.data())
+				, m_end(image.data() + image.size())
+				, m_view(view)
+			{
+			}
+
+			template <typename T>
+			T raw()
+			{
+				T value{};
+				if (static_cast<size_t>(m_end - m_pos) < sizeof(T))
+					return invalid(value);
+				std::memcpy(&value, m_pos, sizeof(T));
+				m_pos += sizeof(T);
+				return value;
+			}
+
+			// Next size bytes of the image, or nothing if there are fewer
+			const char* bytes(size_t size)
+			{
+				if (static_cast<size_t>(m_end - m_pos) < size)
+					return invalid<const char*>(nullptr);
+				const auto data = m_pos;
+				m_pos += size;
+				return data;
+			}
+
+			uint64_t number()
+			{
+				uint64_t value = 0;
+				for (unsigned shift = 0; shift < 64 && m_pos != m_end; shift += 7)
+				{
+					const auto byte = static_cast<uint8_t>(*m_pos++);
+					value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+					if (!(byte & 0x80))
+						return value;
+				}
+				return invalid<uint64_t>(0);
+			}
+
+			// Number of items taking at least itemSize bytes each
+			size_t count(size_t itemSize = 1)
+			{
+				const auto nb = number();
+				return nb > static_cast<size_t>(m_end - m_pos) / itemSize ? invalid<size_t>(0) : static_cast<size_t>(nb);
+			}
+
+			void readNames()
+			{
+				const auto nb = count();
+				m_names.reserve(nb);
+				for (size_t i = 0; i < nb; ++i)
+				{
+					const auto size = count();
+					const auto data = bytes(size);
+					m_names.emplace_back(data ? std::string_view(data, size) : std::string_view{});
+				}
+			}
+
+			void operator()(ast::Block& b)
+			{
+				positions(b);
+				members(b);
+			}
+
+			void operator()(ast::FunctionBody& fb)
+			{
+				members(fb);
+				(*this)(fb.lazy);
+			}
+
+			void operator()(ast::LazyBlock& lb) { positions(lb); }
+			void operator()(ast::EmptyArguments&) {}
+			void operator()(ast::EmptyStatement&) {}
+			void operator()(ast::BreakStatement&) {}
+
+			void operator()(ast::Atom& atom)
+			{
+				const auto index = number();
+				atom = index < m_names.size() ? m_names[index] : invalid(ast::Atom{});
+			}
+
+			void operator()(std::string_view& source)
+			{
+				const auto offset = static_cast<size_t>(m_lastBegin + unzigzag(number()));
+				const auto size = number();
+				source = offset <= m_view.size() && size <= m_view.size() - offset ? m_view.substr(offset, size) : invalid(std::string_view{});
+			}
+
+			void operator()(bool& flag)
+			{
+				flag = raw<uint8_t>() != 0;
+			}
+
+			template <typename T>
+			void operator()(ast::Vector<T>& nodes)
+			{
+				if (!enter())
+					return;
+				nodes.resize(count()); // Each node takes at least one byte
+				for (auto& node : nodes)
+					(*this)(node);
+				--m_depth;
+			}
+
+			template <typename T>
+			void operator()(boost::optional<T>& node)
+			{
+				if (raw<uint8_t>())
+				{
+					node.emplace();
+					(*this)(*node);
+				}
+			}
+
+			template <typename T>
+			void operator()(ast::Forward<T>& node)
+			{
+				if (!enter())
+					return;
+				(*this)(node.get());
+				--m_depth;
+			}
+
+			template <typename T>
+			void operator()(T& node)
+			{
+				if constexpr (std::is_arithmetic_v<T>)
+					node = raw<T>();
+				else if constexpr (std::is_enum_v<T>)
+				{
+					const auto value = number();
+					node = value <= static_cast<uint64_t>(lastValue(T{})) ? static_cast<T>(value) : invalid(T{});
+				}
+				else
+				{
+					if constexpr (pos::is_position_annotated<T>)
+						positions(node);
+					if constexpr (is_variant<T>)
+						variant(node);
+					else
+						members(node);
+				}
+			}
+
+			bool valid() const { return m_valid; }
+			bool atEnd() const { return m_pos == m_end; }
+
+		private:
+			template <typename T>
+			T invalid(T value)
+			{
+				m_valid = false;
+				m_pos = m_end;
+				return value;
+			}
+
+			// A crafted image could otherwise overflow the stack
+			bool enter()
+			{
+				if (m_depth == maxCacheDepth)
+					invalid(0);
+				if (!m_valid)
+					return false;
+				++m_depth;
+				return true;
+			}
+
+			void positions(ast::PositionAnnotated& node)
+			{
+				node.begin = static_cast<size_t>(m_lastBegin + unzigzag(number()));
+				node.end = static_cast<size_t>(node.begin + unzigzag(number()));
+				m_lastBegin = node.begin;
+			}
+
+			template <typename T>
+			void members(T& node)
+			{
+				boost::fusion::for_each(node, [this](auto& member) { (*this)(member); });
+			}
+
+			template <typename... Types>
+			void variant(boost::spirit::x3::variant<Types...>& node)
+			{
+				const auto index = raw<uint8_t>();
+				if (index >= sizeof...(Types))
+				{
+					invalid(0);
+					return;
+				}
+				alternatives<Types...>(index, node, std::index_sequence_for<Types...>{});
+			}
+
+			// Without recursing over the alternatives, which would add stack frames to each level of the tree
+			template <typename... Types, size_t... Indices, typename Variant>
+			void alternatives(size_t index, Variant& node, std::index_sequence<Indices...>)
+			{
+				((index == Indices ? alternative<Types>(node) : void()), ...);
+			}
+
+			template <typename T, typename Variant>
+			void alternative(Variant& node)
+			{
+				node = T{}; // Then read in place, instead of moving the whole alternative
+				(*this)(boost::get<T>(node.get()));
+			}
+
+			const char* m_pos;
+			const char* m_end;
+			std::string_view m_view;
+			std::vector<ast::Atom> m_names;
+			size_t m_lastBegin = 0;
+			size_t m_depth = 0;
+			bool m_valid = true;
+		};
+
+		// Read-only view of a whole file, empty if it cannot be mapped
+		class MappedFile
+		{
+		public:
+			MappedFile(const std::filesystem::path& path)
+			{
+#ifdef _WIN32
+				const auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+											  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+					return;
+				LARGE_INTEGER size;
+				if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+				{
+					if (const auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+					{
+						m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+						if (m_data)
+							m_size = static_cast<size_t>(size.QuadPart);
+						CloseHandle(mapping); // The view keeps the mapping
+					}
+				}
+				CloseHandle(file);
+#else
+				const auto fd = open(path.c_str(), O_RDONLY);
+				if (fd < 0)
+					return;
+				struct stat st;
+				if (fstat(fd, &st) == 0 && st.st_size > 0)
+				{
+#ifdef MAP_POPULATE
+					const int flags = MAP_PRIVATE | MAP_POPULATE; // The whole image is read, fault it in one call
+#else
+					const int flags = MAP_PRIVATE;
+#endif
+					const auto data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, flags, fd, 0);
+					if (data != MAP_FAILED)
+					{
+						m_data = data;
+						m_size = static_cast<size_t>(st.st_size);
+					}
+				}
+				close(fd); // The mapping keeps the file
+#endif
+			}
+
+			~MappedFile()
+			{
+				if (!m_data)
+					return;
+#ifdef _WIN32
+				UnmapViewOfFile(m_data);
+#else
+				munmap(m_data, m_size);
+#endif
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			std::string_view data() const
+			{
+				return {static_cast<const char*>(m_data), m_size};
+			}
+
+		private:
+			void* m_data = nullptr;
+			size_t m_size = 0;
+		};
+
+		// Part of the name of the temporary files, so processes storing the same results do not write the same file
+		unsigned long processId()
+		{
+#ifdef _WIN32
+			return GetCurrentProcessId();
+#else
+			return static_cast<unsigned long>(getpid());
+#endif
+		}
+
+		// The options changing the results, part of the name of the files
+		size_t optionsKey(const ParseOptions& options)
+		{
+			return (options.registerPositions ? 1 : 0) | (options.recoverErrors ? 2 : 0) | (options.lazyFunctionBodies ? 4 : 0);
+		}
+	} // namespace
+
+	std::string serializeResults(const ParseBlockResults& results, std::string_view view, size_t maxDepth)
+	{
+		if (view.size() > std::numeric_limits<uint32_t>::max())
+			return {};
+
+		Writer tree(view, maxDepth);
+		tree(results.block);
+		if (!tree.valid())
+			return {};
+
+		Writer image(view);
+		image.bytes(magic, sizeof(magic));
+		image.raw(cacheVersion);
+		image.raw(static_cast<uint64_t>(view.size()));
+		image.raw(hashSource(view));
+		image.raw(static_cast<uint8_t>(results.parsed));
+		image.raw(static_cast<uint8_t>(results.aborted));
+		image.number(results.lastParsedPosition);
+
+		image.number(tree.names().size());
+		for (const auto name : tree.names())
+		{
+			const auto& str = name.str();
+			image.number(str.size());
+			image.bytes(str.data(), str.size());
+		}
+
+		image.number(results.errors.size());
+		for (const auto& error : results.errors)
+		{
+			image.number(error.begin);
+			image.number(error.end);
+		}
+
+		const auto& positions = results.positions;
+		image.number(positions.nbElements());
+		image.bytes(positions.begins().data(), positions.begins().size() * sizeof(uint32_t));
+		image.bytes(positions.ends().data(), positions.ends().size() * sizeof(uint32_t));
+		image.bytes(positions.types().data(), positions.types().size() * sizeof(ast::ElementType));
+
+		image.bytes(tree.data().data(), tree.data().size());
+		return image.data();
+	}
+
+	std::optional<ParseBlockResults> deserializeResults(std::string_view image, std::string_view view, bool useArena)
+	{
+		Reader reader(image, view);
+		const auto header = reader.bytes(sizeof(magic));
+		if (!header || std::memcmp(header, magic, sizeof(magic)) || reader.raw<uint32_t>() != cacheVersion
+			|| reader.raw<uint64_t>() != view.size() || reader.raw<uint64_t>() != hashSource(view))
+			return {};
+
+		ParseBlockResults res(view);
+		std::optional<ast::ScopedResource> scopedResource;
+		if (useArena)
+		{
+			res.arena = std::make_shared<ast::Arena>(std::max<size_t>(view.size() * 8, 4096));
+			scopedResource.emplace(res.arena.get());
+			res.block = ast::Block{}; // Also allocate the list of statements in the arena
+		}
+
+		res.parsed = reader.raw<uint8_t>() != 0;
+		const auto aborted = reader.raw<uint8_t>();
+		if (aborted > static_cast<uint8_t>(AbortReason::elements))
+			return {};
+		res.aborted = static_cast<AbortReason>(aborted);
+		res.lastParsedPosition = static_cast<size_t>(reader.number());
+		reader.readNames();
+
+		res.errors.resize(reader.count(2));
+		for (auto& error : res.errors)
+		{
+			error.begin = static_cast<size_t>(reader.number());
+			error.end = static_cast<size_t>(reader.number());
+		}
+
+		const auto nbElements = reader.count(2 * sizeof(uint32_t) + sizeof(ast::ElementType));
+		std::vector<uint32_t> begins(nbElements), ends(nbElements);
+		std::vector<ast::ElementType> types(nbElements);
+		for (auto [array, size] : {std::pair<void*, size_t>{begins.data(), nbElements * sizeof(uint32_t)},
+								   {ends.data(), nbElements * sizeof(uint32_t)},
+								   {types.data(), nbElements * sizeof(ast::ElementType)}})
+		{
+			if (const auto data = reader.bytes(size); data && size)
+				std::memcpy(array, data, size);
+		}
+		if (std::any_of(types.begin(), types.end(), [](ast::ElementType type) { return static_cast<int>(type) > lastValue(type); }))
+			return {};
+		res.positions.assignElements(std::move(begins), std::move(ends), std::move(types));
+
+		reader(res.block);
+		if (!reader.valid() || !reader.atEnd())
+			return {};
+		return res;
+	}
+
+	AstCache::AstCache(std::filesystem::path directory)
+		: m_directory(std::move(directory))
+	{
+	}
+
+	ParseBlockResults AstCache::parseBlock(std::string_view view, const ParseOptions& options)
+	{
+		if (auto res = load(view, options))
+		{
+			++m_hits;
+			return std::move(*res);
+		}
+
+		auto res = parser::parseBlock(view, options);
+		if (res.aborted == AbortReason::none)
+			store(view, options, res);
+		return res;
+	}
+
+	std::optional<ParseBlockResults> AstCache::load(std::string_view view, const ParseOptions& options) const
+	{
+		const MappedFile file(path(view, options));
+		if (file.data().empty())
+			return {};
+		auto res = deserializeResults(file.data(), view, options.useArena);
+		if (res && options.hashBlocks)
+			ast::hashBlocks(res->block);
+		return res;
+	}
+
+	bool AstCache::store(std::string_view view, const ParseOptions& options, const ParseBlockResults& results) const
+	{
+		const auto image = serializeResults(results, view);
+		if (image.empty())
+			return false;
+
+		// Written under a unique name then renamed, so a file being written is never loaded
+		std::error_code error;
+		std::filesystem::create_directories(m_directory, error);
+		const auto target = path(view, options);
+		auto temporary = target;
+		temporary += "." + std::to_string(processId()) + "."
+					 + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+		{
+			std::ofstream out(temporary, std::ios_base::binary);
+			if (!out.write(image.data(), image.size()))
+			{
+				out.close();
+				std::filesystem::remove(temporary, error);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temporary, target, error);
+		if (error)
+			std::filesystem::remove(temporary, error);
+		return !error;
+	}
+
+	std::filesystem::path AstCache::path(std::string_view view, const ParseOptions& options) const
+	{
+		size_t key = static_cast<size_t>(hashSource(view));
+		boost::hash_combine(key, cacheVersion);
+		boost::hash_combine(key, optionsKey(options));
+
+		constexpr char digits[] = "0123456789abcdef";
+		std::string name(2 * sizeof(key), '0');
+		for (auto it = name.rbegin(); it != name.rend(); ++it, key >>= 4)
+			*it = digits[key & 15];
+		return m_directory / (name + ".ast");
+	}
+
+	size_t AstCache::hits() const
+	{
+		return m_hits;
+	}
+
+#ifdef WITH_TESTS
+	void checkSameResults(const ParseBlockResults& res, const ParseBlockResults& expected); // In parser.cpp
+
+	namespace
+	{
+		void checkRoundTrip(std::string_view program, const ParseOptions& options = {})
+		{
+			const auto expected = parser::parseBlock(program, options);
+			const auto image = serializeResults(expected, program);
+			REQUIRE_FALSE(image.empty());
+			const auto res = deserializeResults(image, program);
+			REQUIRE(res);
+			checkSameResults(*res, expected);
+			CHECK(res->parsed == expected.parsed);
+			CHECK(res->lastParsedPosition == expected.lastParsedPosition);
+			CHECK(res->aborted == expected.aborted);
+			REQUIRE(res->errors.size() == expected.errors.size());
+			for (size_t i = 0; i < res->errors.size(); ++i)
+			{
+				CHECK(res->errors[i].begin == expected.errors[i].begin);
+				CHECK(res->errors[i].end == expected.errors[i].end);
+			}
+
+			// The nodes, names and literals. The structural hashes depend on the build, they are not stored
+			CHECK(res->block.hash == 0);
+			CHECK(ast::hashBlocks(res->block) == ast::hashBlocks(expected.block));
+		}
+	} // namespace
+
+	TEST_CASE("serialize parse results")
+	{
+		const std::string program = R"(local t = {1, 2.5, 0x10, "a", [[long]], x = -1, [2] = not true, ...}
+local function f(a, b, ...) return a + b * 2 ^ 3 .. 'c', #t, {} end
+function t.g:h(x) t.y[x](x):m{1} "s" ; return nil end
+for i = 1, 10, 2 do if i < 2 then break elseif i >= 3 then goto done else repeat i = i - 1 until i == 0 end end
+for k, v in pairs(t) do while k ~= v and k // 2 | 1 & 3 << 1 >> 2 ~ 1 % 2 == 0 or false do end end
+::done:: do local a, b = (f)(1, 2), - - 1 end
+return t, f)";
+		checkRoundTrip(program);
+		checkRoundTrip("");
+		checkRoundTrip("local x = = 1\nprint('ok')\nlocal y ="); // Errors
+		checkRoundTrip("if then", [] {
+			ParseOptions options;
+			options.recoverErrors = false;
+			return options;
+		}());
+
+		ParseOptions options;
+		options.lazyFunctionBodies = true;
+		options.hashBlocks = true;
+		checkRoundTrip(program, options);
+		options.registerPositions = false;
+		checkRoundTrip(program, options);
+
+		// The literals view the source, the names are interned
+		const std::string_view literal = "local s = 'text' .. s";
+		const auto res = deserializeResults(serializeResults(parser::parseBlock(literal), literal), literal, false);
+		REQUIRE(res);
+		CHECK_FALSE(res->arena);
+		const auto& statement = boost::get<ast::LocalAssignmentStatement>(res->block.statements.front().get());
+		CHECK(statement.variables.front() == ast::Atom("s"));
+		const auto& operand = statement.expressions->front().operand;
+		CHECK(operand.asLiteral().source.data() == literal.data() + 10);
+
+		// Only for the same source, and the image must be complete
+		const auto image = serializeResults(parser::parseBlock(literal), literal);
+		CHECK_FALSE(deserializeResults(image, "local s = 'TEXT' .. s"));
+		CHECK_FALSE(deserializeResults(image + "x", literal));
+		for (size_t size = 0; size < image.size(); ++size)
+			CHECK_FALSE(deserializeResults(std::string_view(image).substr(0, size), literal));
+		auto otherVersion = image;
+		otherVersion[sizeof(magic)] ^= 1;
+		CHECK_FALSE(deserializeResults(otherVersion, literal));
+	}
+
+	TEST_CASE("serialize deep trees")
+	{
+		// The parser needs a large stack for these, but not the serialization
+		constexpr size_t parserStack = 256 << 20, stack = 32 << 20;
+		const auto nested = [](size_t depth) {
+			return "x = " + std::string(depth, '(') + "1" + std::string(depth, ')');
+		};
+
+		const auto shallow = nested(100);
+		checkRoundTrip(shallow);
+
+		const auto deep = nested(maxCacheDepth);
+		std::optional<ParseBlockResults> res;
+		helper::runWithStack(parserStack, [&] { res.emplace(parser::parseBlock(deep)); });
+		REQUIRE(res->parsed);
+		helper::runWithStack(stack, [&] {
+			CHECK(serializeResults(*res, deep).empty());
+
+			// As in an image written for a larger limit, or crafted
+			const auto image = serializeResults(*res, deep, 4 * maxCacheDepth);
+			REQUIRE_FALSE(image.empty());
+			CHECK_FALSE(deserializeResults(image, deep));
+		});
+		helper::runWithStack(parserStack, [&] { res.reset(); });
+	}
+
+	TEST_CASE("AST cache")
+	{
+		const auto directory = std::filesystem::temp_directory_path() / "lac_ast_cache_tests";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+
+		const std::string program = "local t = {a = 1}\nfunction t.f(x) return x .. 'b' end";
+		AstCache cache(directory);
+		const auto cold = cache.parseBlock(program);
+		CHECK(cache.hits() == 0);
+		CHECK(std::filesystem::exists(cache.path(program)));
+
+		const auto warm = cache.parseBlock(program);
+		CHECK(cache.hits() == 1);
+		CHECK(warm.parsed);
+		checkSameResults(warm, cold);
+
+		// Another source or other options are stored in other files
+		ParseOptions options;
+		options.lazyFunctionBodies = true;
+		CHECK(cache.path(program, options) != cache.path(program));
+		CHECK(cache.path(program + " ") != cache.path(program));
+		cache.parseBlock(program, options);
+		CHECK(cache.hits() == 1);
+		cache.parseBlock(program, options);
+		CHECK(cache.hits() == 2);
+
+		// The structural hashes are not stored but computed again when loaded
+		auto hashOptions = options;
+		hashOptions.hashBlocks = true;
+		CHECK(cache.path(program, hashOptions) == cache.path(program, options));
+		const auto loaded = cache.parseBlock(program, hashOptions);
+		CHECK(cache.hits() == 3);
+		CHECK(loaded.block.hash != 0);
+		CHECK(loaded.block.hash == parser::parseBlock(program, hashOptions).block.hash);
+
+		// Aborted parses are not stored
+		options.limits.maxElements = 1;
+		CHECK(cache.parseBlock("x = 1\ny = 2", options).aborted == AbortReason::elements);
+		CHECK_FALSE(std::filesystem::exists(cache.path("x = 1\ny = 2", options)));
+
+		// An invalid file is parsed again
+		{
+			std::ofstream out(cache.path(program), std::ios_base::binary);
+			out << "invalid";
+		}
+		CHECK_FALSE(cache.load(program));
+		CHECK(cache.parseBlock(program).parsed);
+		CHECK(cache.hits() == 3);
+		CHECK(cache.load(program)); // Replaced
+
+		std::filesystem::remove_all(directory, error);
+	}
+#endif
+} // namespace lac::parser
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <lac/core_api.h>
+#include <lac/parser/parser.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lac::parser
+{
+	// Version of the image format and of the trees built by the parser, to increase when either changes
+	constexpr uint32_t cacheVersion = 2;
+
+	// Nesting of the lists and recursive nodes of the trees in the images, which are written and read recursively
+	constexpr size_t maxCacheDepth = 1000;
+
+	// Binary image of the results: the tree in pre-order, its names, the positions and the errors.
+	// It has no pointers: names are indices in a table, and literal strings are ranges of the source.
+	// Returns an empty string if the source is too large for the positions (4 GB), or the tree deeper than maxDepth.
+	CORE_API std::string serializeResults(const ParseBlockResults& results, std::string_view view, size_t maxDepth = maxCacheDepth);
+
+	// Build the results stored in the image, for the same source. The image is only read, it can be memory-mapped,
+	// and the literal strings view the source which must outlive the block, as with parseBlock.
+	// The structural hashes of the blocks depend on the build, so they are not stored: see ast::hashBlocks.
+	// Returns nothing if the image is invalid, its tree deeper than maxCacheDepth, or made for another source or version.
+	CORE_API std::optional<ParseBlockResults> deserializeResults(std::string_view image, std::string_view view, bool useArena = true);
+
+	// Parse results stored in a directory, in a file named after the hash of the source, the version and the options.
+	// The files are memory-mapped when loaded, and replaced atomically when stored, so processes can share the directory.
+	class CORE_API AstCache
+	{
+	public:
+		AstCache(std::filesystem::path directory);
+
+		// Load the results of the source if they are stored, otherwise parse it and store them.
+		// Aborted parses are not stored, as they depend on the limits.
+		ParseBlockResults parseBlock(std::string_view view, const ParseOptions& options = {});
+
+		// Computes the structural hashes of the blocks if options.hashBlocks is set
+		std::optional<ParseBlockResults> load(std::string_view view, const ParseOptions& options = {}) const;
+		bool store(std::string_view view, const ParseOptions& options, const ParseBlockResults& results) const;
+
+		std::filesystem::path path(std::string_view view, const ParseOptions& options = {}) const;
+		size_t hits() const; // Number of results loaded by parseBlock
+
+	private:
+		std::filesystem::path m_directory;
+		size_t m_hits = 0;
+	};
+} // namespace lac::parser
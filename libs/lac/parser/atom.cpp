@@ -0,0 +1,119 @@
+#include <lac/parser/atom.h>
+
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <unordered_map>
+
+#ifdef WITH_TESTS
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+#endif
+
+namespace
+{
+	// Shared by all documents, as the same names come back in every script
+	class Interner
+	{
+	public:
+		static Interner& instance()
+		{
+			static Interner interner;
+			return interner;
+		}
+
+		uint32_t intern(std::string_view name)
+		{
+			if (name.empty())
+				return 0;
+
+			{
+				std::shared_lock lock(m_mutex);
+				const auto it = m_ids.find(name);
+				if (it != m_ids.end())
+					return it->second;
+			}
+
+			std::unique_lock lock(m_mutex);
+			const auto it = m_ids.find(name); // Another thread may have added it
+			if (it != m_ids.end())
+				return it->second;
+			const auto id = static_cast<uint32_t>(m_strings.size());
+			const auto& str = m_strings.emplace_back(name);
+			m_ids.emplace(str, id);
+			return id;
+		}
+
+		const std::string& str(uint32_t id)
+		{
+			std::shared_lock lock(m_mutex);
+			return m_strings[id]; // Elements of a deque are not moved when adding at the end
+		}
+
+	private:
+		Interner()
+		{
+			m_strings.emplace_back();
+		}
+
+		std::shared_mutex m_mutex;
+		std::deque<std::string> m_strings;
+		std::unordered_map<std::string_view, uint32_t> m_ids; // Views of m_strings
+	};
+} // namespace
+
+namespace lac::ast
+{
+	Atom::Atom(std::string_view name)
+		: m_id(Interner::instance().intern(name))
+	{
+	}
+
+	Atom::Atom(const std::string& name)
+		: Atom(std::string_view{name})
+	{
+	}
+
+	Atom::Atom(const char* name)
+		: Atom(std::string_view{name})
+	{
+	}
+
+	const std::string& Atom::str() const
+	{
+		return Interner::instance().str(m_id);
+	}
+
+	std::ostream& operator<<(std::ostream& out, Atom atom)
+	{
+		return out << atom.str();
+	}
+
+#ifdef WITH_TESTS
+	TEST_CASE("Atom")
+	{
+		CHECK(Atom{}.empty());
+		CHECK(Atom{""} == Atom{});
+		CHECK(Atom{}.str().empty());
+
+		const Atom a{"first"};
+		CHECK_FALSE(a.empty());
+		CHECK(a.str() == "first");
+		CHECK(a == Atom{std::string{"first"}});
+		CHECK(a == Atom{std::string_view{"first_second"}.substr(0, 5)});
+		CHECK(a != Atom{"second"});
+
+		std::vector<Atom> atoms(4);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < atoms.size(); ++i)
+			threads.emplace_back([&atoms, i] { atoms[i] = Atom{"concurrent"}; });
+		for (auto& thread : threads)
+			thread.join();
+		for (const auto atom : atoms)
+			CHECK(atom == atoms.front());
+		CHECK(atoms.front().str() == "concurrent");
+	}
+#endif
+} // namespace lac::ast
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <lac/core_api.h>
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// Identifiers are interned when parsed: nodes, scopes and types store a 32-bit id,
+// and the text is only needed when the names are shown to the user.
+namespace lac::ast
+{
+	class CORE_API Atom
+	{
+	public:
+		Atom() = default; // The empty string
+		Atom(std::string_view name);
+		Atom(const std::string& name);
+		Atom(const char* name);
+
+		uint32_t id() const { return m_id; }
+		bool empty() const { return m_id == 0; }
+
+		const std::string& str() const; // The reference stays valid for the life of the program
+
+		// Ordered by id, not alphabetically
+		friend bool operator==(Atom lhs, Atom rhs) { return lhs.m_id == rhs.m_id; }
+		friend bool operator!=(Atom lhs, Atom rhs) { return lhs.m_id != rhs.m_id; }
+		friend bool operator<(Atom lhs, Atom rhs) { return lhs.m_id < rhs.m_id; }
+
+	private:
+		uint32_t m_id = 0;
+	};
+
+	CORE_API std::ostream& operator<<(std::ostream& out, Atom atom);
+} // namespace lac::ast
+
+template <>
+struct std::hash<lac::ast::Atom>
+{
+	size_t operator()(lac::ast::Atom atom) const noexcept { return atom.id(); }
+};
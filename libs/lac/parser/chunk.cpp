@@ -5,19 +5,11 @@
 #include <lac/helper/test_utils.h>
 #include <iostream>
 
-namespace lac::ast
-{
-	bool operator==(const LiteralString& lhs, const LiteralString& rhs)
-	{
-		return lhs.value == rhs.value;
-	}
-} // namespace lac::ast
-
 namespace lac::parser
 {
 	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, no_skip_pos_context_type)
-	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, skipper_context_type)
-	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, chunk_pos_context_type)
+	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, parse_block_context_type)
+	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, parse_block_pos_context_type)
 	//	BOOST_SPIRIT_INSTANTIATE(chunk_type, iterator_type, skipper_pos_context_type) // Not used
 	BOOST_SPIRIT_INSTANTIATE(variable_or_function_type, iterator_type, skipper_context_type)
 	BOOST_SPIRIT_INSTANTIATE(skipper_type, iterator_type, x3::unused_type)
@@ -38,17 +30,48 @@ namespace lac::parser
 
 		CHECK_FALSE(test_parser_simple("test", keyword));
 		CHECK_FALSE(test_parser_simple("origin", keyword));
+		CHECK_FALSE(test_parser_simple("ending", keyword));
+	}
+
+	TEST_CASE("symbols")
+	{
+		static_assert(symbols::keywords.find("elseif"));
+		static_assert(!symbols::keywords.find("elsif"));
+		static_assert(symbols::binaryOperators.findPrefix("//x")->value == ast::Operation::idiv);
+
+		for (const auto& symbol : symbols::keywordsList)
+			CHECK(symbols::keywords.find(symbol.str) != nullptr);
+		for (const auto& symbol : symbols::binaryOperatorsList)
+			CHECK(symbols::binaryOperators.find(symbol.str)->value == symbol.value);
+		CHECK_FALSE(symbols::binaryOperators.find(""));
+		CHECK_FALSE(symbols::binaryOperators.find("==="));
+
+		test_value("~=", binaryOperator, ast::Operation::ineq);
+		test_value("~", binaryOperator, ast::Operation::bxor);
+		test_value("<=", binaryOperator, ast::Operation::le);
+		test_value("and", binaryOperator, ast::Operation::land);
+		test_value("not", unaryOperator, ast::Operation::lnot);
+		test_value("...", expressionConstant, ast::ExpressionConstant::dots);
+
+		// Words are only recognized as a whole
+		CHECK_FALSE(test_parser("android", binaryOperator));
+		CHECK_FALSE(test_parser("notify", unaryOperator));
+		CHECK_FALSE(test_parser("nilValue", expressionConstant));
+		CHECK(test_phrase_parser("a and android or notify", expression));
+		CHECK(test_phrase_parser("nilValue", expression));
+		CHECK(test_phrase_parser_simple("do doIt() end", chunk));
+		CHECK_FALSE(test_phrase_parser_simple("for i = 1, 2 doit() end", chunk));
 	}
 
 	TEST_CASE("name")
 	{
-		test_value("test", name, "test");
-		test_value("_test", name, "_test");
-		test_value("_123", name, "_123");
-		test_value("_a1b2c3d4", name, "_a1b2c3d4");
-		test_value("origin", name, "origin");
-		test_value("ending", name, "ending");
-		test_value("redo", name, "redo");
+		test_value("test", name, ast::Atom{"test"});
+		test_value("_test", name, ast::Atom{"_test"});
+		test_value("_123", name, ast::Atom{"_123"});
+		test_value("_a1b2c3d4", name, ast::Atom{"_a1b2c3d4"});
+		test_value("origin", name, ast::Atom{"origin"});
+		test_value("ending", name, ast::Atom{"ending"});
+		test_value("redo", name, ast::Atom{"redo"});
 
 		CHECK_FALSE(test_parser("123test", name));
 		CHECK_FALSE(test_parser("test 123", name));
@@ -65,7 +88,7 @@ namespace lac::parser
 
 		CHECK_FALSE(test_phrase_parser("a, b,", namesList));
 
-		std::vector<std::string> list;
+		ast::NamesList list;
 		REQUIRE(test_phrase_parser("a, b, c", namesList, list));
 		REQUIRE(list.size() == 3);
 		CHECK(list[0] == "a");
@@ -73,25 +96,26 @@ namespace lac::parser
 		CHECK(list[2] == "c");
 	}
 
-	ast::LiteralString operator""_lit(const char* str, size_t len)
+	void test_literal(std::string_view input, std::string_view value)
 	{
-		ast::LiteralString tmp;
-		tmp.value = std::string{str, len};
-		return tmp;
+		ast::LiteralString v;
+		CHECK(test_parser(input, literalString, v));
+		CHECK(v.source == input);
+		CHECK(v.value() == value);
 	}
 
 	TEST_CASE("short literal string")
 	{
 		CHECK(test_parser("''", literalString));
 
-		test_value("''", literalString, ""_lit);
-		test_value("'test'", literalString, "test"_lit);
-		test_value("\"test\"", literalString, "test"_lit);
-		test_value("'test\" 123'", literalString, "test\" 123"_lit);
-		test_value("\"test' 123\"", literalString, "test' 123"_lit);
-		test_value("'test\\' 123'", literalString, "test' 123"_lit);
-		test_value("\"test\\\" 123\"", literalString, "test\" 123"_lit);
-		test_value("'line 1\r line 2'", literalString, "line 1\r line 2"_lit);
+		test_literal("''", "");
+		test_literal("'test'", "test");
+		test_literal("\"test\"", "test");
+		test_literal("'test\" 123'", "test\" 123");
+		test_literal("\"test' 123\"", "test' 123");
+		test_literal("'test\\' 123'", "test' 123");
+		test_literal("\"test\\\" 123\"", "test\" 123");
+		test_literal("'line 1\r line 2'", "line 1\r line 2");
 
 		CHECK_FALSE(test_parser("no quotes here", literalString));
 		CHECK_FALSE(test_parser("'test", literalString));
@@ -102,16 +126,16 @@ namespace lac::parser
 
 		ast::LiteralString v;
 		CHECK(test_phrase_parser("'test 1 \t2 3 4'", literalString, v));
-		CHECK(v.value == std::string("test 1 \t2 3 4"));
+		CHECK(v.value() == "test 1 \t2 3 4");
 	}
 
 	TEST_CASE("long literal string")
 	{
-		test_value("[[]]", literalString, ""_lit);
-		test_value("[[test]]", literalString, "test"_lit);
-		test_value("[[test] 123]]", literalString, "test] 123"_lit);
-		test_value("[=[test]] 123]=]", literalString, "test]] 123"_lit);
-		test_value("[==[test]=] 123]==]", literalString, "test]=] 123"_lit);
+		test_literal("[[]]", "");
+		test_literal("[[test]]", "test");
+		test_literal("[[test] 123]]", "test] 123");
+		test_literal("[=[test]] 123]=]", "test]] 123");
+		test_literal("[==[test]=] 123]==]", "test]=] 123");
 
 		CHECK_FALSE(test_parser("test", literalString));
 		CHECK_FALSE(test_parser("[[test]", literalString));
@@ -120,19 +144,20 @@ namespace lac::parser
 
 	TEST_CASE("literal string")
 	{
-		test_value("'test'", literalString, "test"_lit);
-		test_value("[[test]]", literalString, "test"_lit);
+		test_literal("'test'", "test");
+		test_literal("[[test]]", "test");
 	}
 
 	TEST_CASE("numeral int")
 	{
-		test_value("0", numeralInt, 0);
-		test_value("42", numeralInt, 42);
-		test_value("-1", numeralInt, -1);
-		test_value("0xa0", numeralInt, int(0xa0));
-		test_value("0Xa0", numeralInt, int(0xa0));
+		test_value("0", numeralInt, int64_t(0));
+		test_value("42", numeralInt, int64_t(42));
+		test_value("0xa0", numeralInt, int64_t(0xa0));
+		test_value("0Xa0", numeralInt, int64_t(0xa0));
+		test_value("4294967296", numeralInt, int64_t(4294967296));
 
 		CHECK_FALSE(test_parser("0.0", numeralInt));
+		CHECK_FALSE(test_parser("-1", numeralInt)); // A unary operation
 	}
 
 	TEST_CASE("numeral float")
@@ -140,41 +165,31 @@ namespace lac::parser
 		test_value("0", numeralFloat, 0.0);
 		test_value("0.1", numeralFloat, 0.1);
 		test_value("3.14", numeralFloat, 3.14);
-		test_value("-3.14", numeralFloat, -3.14);
 		test_value("1e2", numeralFloat, 1e2);
 		test_value("1.2e3", numeralFloat, 1.2e3);
 		test_value("1.2e-3", numeralFloat, 1.2e-3);
+		test_value("0x1p-2", numeralFloat, 0.25);
 
 		CHECK(test_phrase_parser("3.14", numeralFloat));
 		CHECK(test_phrase_parser("42.3", numeralFloat));
 
 		CHECK_FALSE(test_phrase_parser("42,3", numeralFloat));
+		CHECK_FALSE(test_parser("-3.14", numeralFloat));
+		CHECK_FALSE(test_parser("inf", numeralFloat));
 	}
 
 	TEST_CASE("comment")
 	{
-		test_value("--test", comment, "test");
-		test_value("--test\n", comment, "test");
-		test_value("--[test", comment, "[test");
-		test_value("-- [[test]]", comment, " [[test]]");
-		test_value("--[[test\n123]]", comment, "test\n123");
-		test_value("--[=[test]]\n123]=]", comment, "test]]\n123");
-
-		// short comment value
-		{
-			std::string v;
-			CHECK(test_phrase_parser("-- test 1 2", comment, v));
-			CHECK(v == std::string("test 1 2"));
-		}
-
-		// long comment value
-		{
-			std::string v;
-			CHECK(test_phrase_parser("--[[test 1 2]]", comment, v));
-			CHECK(v == std::string("test 1 2"));
-		}
-
-		CHECK_FALSE(test_parser("test", comment));
+		CHECK(test_parser_simple("--test", comment));
+		CHECK(test_parser_simple("--test\n", comment));
+		CHECK(test_parser_simple("--[test", comment));
+		CHECK(test_parser_simple("-- [[test]]", comment));
+		CHECK(test_parser_simple("--[[test\n123]]", comment));
+		CHECK(test_parser_simple("--[=[test]]\n123]=]", comment));
+		CHECK(test_phrase_parser_simple("-- test 1 2", comment));
+		CHECK(test_phrase_parser_simple("--[[test 1 2]]", comment));
+
+		CHECK_FALSE(test_parser_simple("test", comment));
 	}
 
 	TEST_CASE("skipper")
@@ -202,12 +217,12 @@ namespace lac::parser
 		ast::FieldByExpression fe;
 		REQUIRE(test_phrase_parser("['hello' .. 'World'] = 42", fieldByExpression, fe));
 		REQUIRE(fe.key.operand.isLiteral());
-		CHECK(fe.key.operand.asLiteral().value == "hello");
+		CHECK(fe.key.operand.asLiteral().value() == "hello");
 
-		REQUIRE(fe.key.binaryOperation.is_initialized());
-		CHECK(fe.key.binaryOperation->get().operation == ast::Operation::concat);
-		REQUIRE(fe.key.binaryOperation->get().expression.operand.isLiteral());
-		CHECK(fe.key.binaryOperation->get().expression.operand.asLiteral().value == "World");
+		REQUIRE(fe.key.binaryOperations.size() == 1);
+		CHECK(fe.key.binaryOperations[0].operation == ast::Operation::concat);
+		REQUIRE(fe.key.binaryOperations[0].operand.isLiteral());
+		CHECK(fe.key.binaryOperations[0].operand.asLiteral().value() == "World");
 
 		REQUIRE(fe.value.operand.isNumeral());
 		const auto num = fe.value.operand.asNumeral();
@@ -224,7 +239,7 @@ namespace lac::parser
 		REQUIRE(test_phrase_parser("x = 'test'", fieldByAssignment, fa));
 		CHECK(fa.name == "x");
 		REQUIRE(fa.value.operand.isLiteral());
-		CHECK(fa.value.operand.asLiteral().value == "test");
+		CHECK(fa.value.operand.asLiteral().value() == "test");
 	}
 
 	TEST_CASE("field")
@@ -243,7 +258,7 @@ namespace lac::parser
 			REQUIRE(f.get().type() == typeid(ast::FieldByExpression));
 			auto fe = boost::get<ast::FieldByExpression>(f.get());
 			REQUIRE(fe.key.operand.isLiteral());
-			CHECK(fe.key.operand.asLiteral().value == "x");
+			CHECK(fe.key.operand.asLiteral().value() == "x");
 			REQUIRE(fe.value.operand.isNumeral());
 			REQUIRE(fe.value.operand.asNumeral().isInt());
 			CHECK(fe.value.operand.asNumeral().asInt() == 42);
@@ -268,7 +283,7 @@ namespace lac::parser
 			REQUIRE(f.get().type() == typeid(ast::Expression));
 			auto ex = boost::get<ast::Expression>(f.get());
 			CHECK(ex.operand.isLiteral());
-			CHECK(ex.operand.asLiteral().value == "x");
+			CHECK(ex.operand.asLiteral().value() == "x");
 		}
 	}
 
@@ -414,10 +429,10 @@ namespace lac::parser
 		{
 			ast::FunctionCall fc;
 			REQUIRE(test_phrase_parser("func()", functionCall, fc));
-			REQUIRE(fc.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(fc.start) == "func");
+			REQUIRE(fc.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(fc.start) == "func");
 			REQUIRE(fc.rest.size() == 1);
-			CHECK(fc.rest.front().tableIndex.is_initialized() == false);
+			CHECK(fc.rest.front().tableIndex.empty());
 			CHECK(fc.rest.front().functionCall.member.is_initialized() == false);
 		}
 
@@ -425,8 +440,8 @@ namespace lac::parser
 		{
 			ast::FunctionCall fc;
 			REQUIRE(test_phrase_parser("func:member()", functionCall, fc));
-			REQUIRE(fc.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(fc.start) == "func");
+			REQUIRE(fc.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(fc.start) == "func");
 			REQUIRE(fc.rest.size() == 1);
 			REQUIRE(fc.rest.front().functionCall.member.is_initialized());
 			CHECK(fc.rest.front().functionCall.member.get() == "member");
@@ -504,7 +519,7 @@ namespace lac::parser
 		{
 			ast::PrefixExpression pe;
 			REQUIRE(test_phrase_parser("a", prefixExpression, pe));
-			CHECK(pe.start.get().type() == typeid(std::string));
+			CHECK(pe.start.get().type() == typeid(ast::Atom));
 		}
 
 		// rest
@@ -582,12 +597,20 @@ namespace lac::parser
 			CHECK(ex.operand.asNumeral().asFloat() == 42.3);
 		}
 
+		// names starting like a float
+		for (const auto name : {"inf", "info", "nan", "nano"})
+		{
+			ast::Expression ex;
+			REQUIRE(test_phrase_parser(name, expression, ex));
+			CHECK(ex.operand.get().type() == typeid(ast::f_PrefixExpression));
+		}
+
 		// string
 		{
 			ast::Expression ex;
 			REQUIRE(test_phrase_parser("'test'", expression, ex));
 			REQUIRE(ex.operand.isLiteral());
-			CHECK(ex.operand.asLiteral().value == "test");
+			CHECK(ex.operand.asLiteral().value() == "test");
 		}
 
 		// unary operation
@@ -609,12 +632,37 @@ namespace lac::parser
 			REQUIRE(ex.operand.asNumeral().isInt());
 			CHECK(ex.operand.asNumeral().asInt() == 1);
 
-			REQUIRE(ex.binaryOperation.is_initialized());
-			const auto bo = ex.binaryOperation->get();
+			REQUIRE(ex.binaryOperations.size() == 1);
+			const auto& bo = ex.binaryOperations[0];
 			CHECK(bo.operation == ast::Operation::add);
-			REQUIRE(bo.expression.operand.isNumeral());
-			REQUIRE(bo.expression.operand.asNumeral().isInt());
-			CHECK(bo.expression.operand.asNumeral().asInt() == 2);
+			REQUIRE(bo.operand.isNumeral());
+			REQUIRE(bo.operand.asNumeral().isInt());
+			CHECK(bo.operand.asNumeral().asInt() == 2);
+		}
+
+		// chain of binary operations, stored flat
+		{
+			ast::Expression ex;
+			REQUIRE(test_phrase_parser("1 + 2 * 3 .. 'a' == 'b'", expression, ex));
+			REQUIRE(ex.binaryOperations.size() == 4);
+			CHECK(ex.binaryOperations[0].operation == ast::Operation::add);
+			CHECK(ex.binaryOperations[1].operation == ast::Operation::mul);
+			CHECK(ex.binaryOperations[2].operation == ast::Operation::concat);
+			CHECK(ex.binaryOperations[3].operation == ast::Operation::eq);
+			CHECK(ex.binaryOperations[3].operand.isLiteral());
+		}
+
+		// the exponentiation binds tighter than the unary operators, the other operations do not
+		{
+			ast::Expression ex;
+			REQUIRE(test_phrase_parser("-x ^ 2 + 1", expression, ex));
+			REQUIRE(ex.operand.get().type() == typeid(ast::f_UnaryOperation));
+			const auto& uo = boost::get<ast::f_UnaryOperation>(ex.operand.get()).get();
+			CHECK(uo.operation == ast::Operation::unm);
+			REQUIRE(uo.expression.binaryOperations.size() == 1);
+			CHECK(uo.expression.binaryOperations[0].operation == ast::Operation::pow);
+			REQUIRE(ex.binaryOperations.size() == 1);
+			CHECK(ex.binaryOperations[0].operation == ast::Operation::add);
 		}
 
 		// function definition
@@ -752,8 +800,8 @@ namespace lac::parser
 		{
 			ast::Variable var;
 			REQUIRE(test_phrase_parser("a(b):c().d", variable, var));
-			REQUIRE(var.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(var.start) == "a");
+			REQUIRE(var.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(var.start) == "a");
 			CHECK(var.rest.size() == 1);
 
 			const auto& r0 = var.rest.front();
@@ -869,8 +917,8 @@ namespace lac::parser
 			REQUIRE(as.variables.size() == 1);
 			REQUIRE(as.expressions.size() == 1);
 			const auto& var = as.variables[0];
-			REQUIRE(var.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(var.start) == "x");
+			REQUIRE(var.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(var.start) == "x");
 			const auto& exp = as.expressions[0];
 			REQUIRE(exp.operand.isNumeral());
 			REQUIRE(exp.operand.asNumeral().isInt());
@@ -885,12 +933,12 @@ namespace lac::parser
 			REQUIRE(as.expressions.size() == 2);
 
 			const auto& x = as.variables[0];
-			REQUIRE(x.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(x.start) == "x");
+			REQUIRE(x.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(x.start) == "x");
 
 			const auto& y = as.variables[1];
-			REQUIRE(y.start.get().type() == typeid(std::string));
-			CHECK(boost::get<std::string>(y.start) == "y");
+			REQUIRE(y.start.get().type() == typeid(ast::Atom));
+			CHECK(boost::get<ast::Atom>(y.start) == "y");
 
 			const auto& exp1 = as.expressions[0];
 			REQUIRE(exp1.operand.isNumeral());
@@ -899,7 +947,7 @@ namespace lac::parser
 
 			const auto& exp2 = as.expressions[1];
 			REQUIRE(exp2.operand.isLiteral());
-			CHECK(exp2.operand.asLiteral().value == "hello");
+			CHECK(exp2.operand.asLiteral().value() == "hello");
 		}
 	}
 
@@ -947,7 +995,7 @@ namespace lac::parser
 
 			const auto& exp2 = (*las.expressions)[1];
 			REQUIRE(exp2.operand.isLiteral());
-			CHECK(exp2.operand.asLiteral().value == "hello");
+			CHECK(exp2.operand.asLiteral().value() == "hello");
 		}
 	}
 
@@ -1183,7 +1231,7 @@ namespace lac::parser
 			REQUIRE(exp1.operand.asNumeral().asInt() == 42);
 			const auto& exp2 = rs.expressions[1];
 			REQUIRE(exp2.operand.isLiteral());
-			CHECK(exp2.operand.asLiteral().value == "hello");
+			CHECK(exp2.operand.asLiteral().value() == "hello");
 		}
 	}
 
@@ -1220,7 +1268,17 @@ namespace lac::parser
 		CHECK(testStatementType<ast::LocalAssignmentStatement>("local x = 42"));
 		CHECK(testStatementType<ast::LocalAssignmentStatement>("local a, b = 2.34, 42"));
 
+		// Names starting like keywords, and statements starting with a bracket
+		CHECK(testStatementType<ast::AssignmentStatement>("iffy = 1"));
+		CHECK(testStatementType<ast::AssignmentStatement>("local_x, do_y = 1, 2"));
+		CHECK(testStatementType<ast::FunctionCall>("forEach(t)"));
+		CHECK(testStatementType<ast::FunctionCall>("(f)(x)"));
+		CHECK(testStatementType<ast::AssignmentStatement>("(t).x = 1"));
+
 		CHECK_FALSE(test_phrase_parser("test", statement));
+		CHECK_FALSE(test_phrase_parser("end", statement));
+		CHECK_FALSE(test_phrase_parser("return 1", statement));
+		CHECK_FALSE(test_phrase_parser("goto = 1", statement));
 	}
 
 	TEST_CASE("block")
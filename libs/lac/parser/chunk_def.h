@@ -6,7 +6,18 @@
 #include <lac/parser/ast.h>
 #include <lac/parser/ast_adapted.h>
 #include <lac/parser/chunk.h>
+#include <lac/parser/error_recovery.h>
+#include <lac/parser/governor.h>
+#include <lac/parser/lazy_body.h>
+#include <lac/parser/numeral.h>
 #include <lac/parser/positions.h>
+#include <lac/parser/scan.h>
+#include <lac/parser/symbols.h>
+#include <lac/parser/tokenizer.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
 
 /* From Lua 5.3 reference, 9 - The Complete Syntax of Lua:
 	chunk ::= block
@@ -52,137 +63,55 @@
 	unop ::= '-' | not | '#' | '~'
 */
 
+// When LAC_VALIDATION_GRAMMAR is defined (see validate.cpp), the same grammar is defined in lac::parser::validation,
+// with rules synthesizing no attribute
+#ifdef LAC_VALIDATION_GRAMMAR
+namespace lac::parser::validation
+#else
 namespace lac::parser
+#endif
 {
 	namespace x3 = boost::spirit::x3;
 	namespace ascii = x3::ascii;
-	using ascii::char_;
-	using ascii::string;
 	using x3::_attr;
-	using x3::_pass;
-	using x3::alnum;
-	using x3::alpha;
-	using x3::double_;
-	using x3::eol;
-	using x3::get;
-	using x3::hex;
-	using x3::int_;
 	using x3::lexeme;
 	using x3::lit;
-	using x3::omit;
 	using x3::raw;
-	using x3::with;
-
-	// clang-format off
-		struct keyword_ : x3::symbols<std::string>
-		{
-			keyword_()
-			{
-				add
-					("and", "and")
-					("break", "break")
-					("do", "do")
-					("else", "else")
-					("elseif", "elseif")
-					("end", "end")
-					("false", "false")
-					("for", "for")
-					("function", "function")
-					("goto", "goto")
-					("if", "if")
-					("in", "in")
-					("local", "local")
-					("nil", "nil")
-					("not", "not")
-					("or", "or")
-					("repeat", "repeat")
-					("return", "return")
-					("then", "then")
-					("true", "true")
-					("until", "until")
-					("while", "while");
-			}
-		} keyword;
-
-		struct binaryOperator_ : x3::symbols<ast::Operation>
-		{
-			binaryOperator_()
-			{
-				using Op = ast::Operation;
-				add
-					("+", Op::add)
-					("-", Op::sub)
-					("*", Op::mul)
-					("/", Op::div)
-					("//", Op::idiv)
-					("%", Op::mod)
-					("^", Op::pow)
-					("&", Op::band)
-					("|", Op::bor)
-					("~", Op::bxor)
-					("<<", Op::shl)
-					(">>", Op::shr)
-					("..", Op::concat)
-					("<", Op::lt)
-					("<=", Op::le)
-					(">", Op::gt)
-					(">=", Op::ge)
-					("==", Op::eq)
-					("~=", Op::ineq)
-					("and", Op::land)
-					("or", Op::lor);
-			}
-		} binaryOperator;
-
-		struct unaryOperator_ : x3::symbols<ast::Operation>
-		{
-			using Op = ast::Operation;
-			unaryOperator_()
-			{
-				add
-					("-", Op::unm)
-					("#", Op::len)
-					("~", Op::bnot)
-					("not", Op::lnot);
-			}
-		} unaryOperator;
-
-		struct expressionConstant_ : x3::symbols<ast::ExpressionConstant>
-		{
-			expressionConstant_()
-			{
-				using EC = ast::ExpressionConstant;
-				add
-					("nil", EC::nil)
-					("false", EC::False)
-					("true", EC::True)
-					("...", EC::dots);
-			}
-		} expressionConstant;
-	// clang-format on
 
+	const keyword_parser keyword = {};
+	const symbols_parser binaryOperator{symbols::binaryOperators};
+	const symbols_parser unaryOperator{symbols::unaryOperators};
+	const symbols_parser expressionConstant{symbols::expressionConstants};
+
+#ifdef LAC_VALIDATION_GRAMMAR
+#define RULE(name, type) \
+	struct name          \
+	{                    \
+	};                   \
+	const x3::rule<struct name> name = #name;
+#else
 #define RULE(name, type)                 \
 	struct name : pos::annotate_position \
 	{                                    \
 	};                                   \
 	const x3::rule<struct name, type> name = #name;
+#endif
 
-	RULE(name, std::string)
-	RULE(namesList, std::vector<std::string>)
+	RULE(name, ast::Atom)
+	RULE(namesList, ast::NamesList)
 
-	const x3::rule<class openLongBracket> openLongBracket = "openLongBracket";
-	const x3::rule<class closeLongBacket> closeLongBacket = "closeLongBacket";
-	RULE(longLiteralString, std::string)
-	RULE(literalStringValue, std::string)
+	RULE(longLiteralString, x3::unused_type)
+	RULE(literalStringValue, x3::unused_type)
+	RULE(literalStringSource, std::string_view)
 	RULE(literalString, ast::LiteralString)
 
-	RULE(numeralInt, int)
+	RULE(numeralInt, int64_t)
 	RULE(numeralFloat, double)
 	RULE(numeral, ast::Numeral)
 
-	RULE(shortComment, std::string)
-	RULE(longComment, std::string)
-	RULE(comment, std::string)
+	RULE(shortComment, x3::unused_type)
+	RULE(longComment, x3::unused_type)
+	RULE(comment, x3::unused_type)
 
 	RULE(fieldByExpression, ast::FieldByExpression)
 	RULE(fieldByAssignment, ast::FieldByAssignment)
@@ -214,6 +143,8 @@ namespace lac::parser
 
 	RULE(unaryOperation, ast::UnaryOperation)
 	RULE(binaryOperation, ast::BinaryOperation)
+	RULE(powerOperation, ast::BinaryOperation)
+	RULE(unaryOperand, ast::Expression)
 	RULE(simpleExpression, ast::Operand)
 	RULE(expression, ast::Expression)
 	RULE(expressionsList, ast::ExpressionsList)
@@ -242,110 +173,128 @@ namespace lac::parser
 
 #undef RULE
 
-	// To annotate rules with no struct attributes
-	struct element_tag
+	// To annotate rules with no struct attributes: register the range of the subject as an element
+	template <typename Subject>
+	struct element_directive : x3::unary_parser<Subject, element_directive<Subject>>
 	{
-	};
-	auto startElement = [](auto& ctx) {
-		if constexpr (pos::has_tag<decltype(ctx), pos::position_tag>)
+		using base_type = x3::unary_parser<Subject, element_directive<Subject>>;
+		static const bool is_pass_through_unary = true;
+
+		constexpr element_directive(const Subject& subject, ast::ElementType type)
+			: base_type(subject)
+			, type(type)
 		{
-			auto& positions = x3::get<pos::position_tag>(ctx).get();
-			auto& elt = get<element_tag>(ctx);
-			elt.begin = positions.pos(_where(ctx).begin());
 		}
-	};
-	auto endElement = [](auto& ctx) {
-		if constexpr (pos::has_tag<decltype(ctx), pos::position_tag>)
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
 		{
-			auto& positions = x3::get<pos::position_tag>(ctx).get();
-			auto& elt = get<element_tag>(ctx);
-			elt.end = positions.pos(_where(ctx).begin());
-			positions.addElement(elt);
+			if constexpr (!pos::has_tag<Context, pos::position_tag>)
+				return this->subject.parse(first, last, context, rcontext, attr);
+			else
+			{
+				x3::skip_over(first, last, context);
+				const auto begin = first;
+				if (!this->subject.parse(first, last, context, rcontext, attr))
+					return false;
+
+				auto& positions = x3::get<pos::position_tag>(context).get();
+				pos::Element elt{type};
+				elt.begin = positions.pos(begin);
+				elt.end = positions.pos(first);
+				positions.addElement(elt);
+				return true;
+			}
 		}
+
+		ast::ElementType type;
 	};
 
-	const x3::rule<class elementStart> elementStart = "elementStart";
-	const x3::rule<class elementEnd> elementEnd = "elementEnd";
-	const auto elementStart_def = x3::eps[startElement];
-	const auto elementEnd_def = x3::eps[endElement];
+	template <typename Subject>
+	constexpr element_directive<Subject> registerElement(ast::ElementType type, const Subject& subject)
+	{
+		return {subject, type};
+	}
 
 	// Names
-	const auto nameFirstLetter = alpha | char_('_');
-	const auto nameLetter = alnum | char_('_');
-	const auto name_def = lexeme[(nameFirstLetter >> *nameLetter)
-								 - (keyword >> !nameLetter)];
+	const auto name_def = name_parser{};
 
 	const auto namesList_def = name % ',';
 
-	// Short literal strings
-	auto quotedString = [](char c) {
-		return lit(c)
-			   >> *(('\\' >> char_(c)) // Escaped quote
-					| (char_ - c))     // Any character but the quote
-			   >> c;
+	// Match the characters skipped by a scanning function, which returns nullptr if they do not match
+	template <const char* (*skip)(const char*, const char*)>
+	struct scan_parser : x3::parser<scan_parser<skip>>
+	{
+		using attribute_type = x3::unused_type;
+		static const bool has_attribute = false;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute&) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last)
+				return false;
+
+			const auto begin = &*first;
+			const auto end = skip(begin, begin + (last - first));
+			if (!end)
+				return false;
+			first += end - begin;
+			return true;
+		}
 	};
 
+	// Short literal strings
+	const scan_parser<scan::skipQuotedString> quotedString = {};
+
 	// Long literal strings
-	struct long_bracket_tag
-	{
-	};
-	auto set_bracket = [](auto& ctx) { get<long_bracket_tag>(ctx) = _attr(ctx); };
-	auto is_bracket = [](auto& ctx) { _pass(ctx) = (get<long_bracket_tag>(ctx) == _attr(ctx)); };
-	const auto openLongBracket_def = '[' >> (*char_('='))[set_bracket] >> '[';
-	const auto closeLongBacket_def = ']' >> (*char_('='))[is_bracket] >> ']';
-	const auto longLiteralString_def = with<long_bracket_tag>(std::string())
-		[omit[openLongBracket]
-		 >> *(char_ - closeLongBacket)
-		 >> omit[closeLongBacket]];
+	const scan_parser<scan::skipLongString> longBracket = {};
+	const auto longLiteralString_def = longBracket;
 
 	// Literal strings
-	const auto literalStringValue_def = lexeme[quotedString('\'')
-											   | quotedString('"')
-											   | longLiteralString];
-	const auto literalString_def = literalStringValue;
+	const auto literalStringValue_def = lexeme[quotedString | longLiteralString];
+	auto toView = [](auto& ctx) {
+		const auto& range = _attr(ctx);
+		x3::_val(ctx) = std::string_view(&*range.begin(), range.size());
+	};
+	const auto literalStringSource_def = raw[literalStringValue][toView];
+	const auto literalString_def = literalStringSource;
 
 	// Numerals
-	const auto numeralInt_def = (lit("0x") >> hex)
-								| (lit("0X") >> hex)
-								| (int_ >> !lit('.'));
-	const auto numeralFloat_def = double_;
-	const auto numeral_def = numeralInt | numeralFloat;
+	const auto numeralInt_def = numeral_parser<int64_t>{};
+	const auto numeralFloat_def = numeral_parser<double>{};
+	const auto numeral_def = numeral_parser<ast::Numeral>{};
 
 	// Comments
-	const auto shortComment_def = "--" >> lexeme[*(char_ - eol)] >> -eol;
-	const auto longComment_def = with<long_bracket_tag>(std::string())
-		["--"
-		 >> omit[openLongBracket]
-		 >> lexeme[*(char_ - closeLongBacket)]
-		 >> omit[closeLongBacket]];
+	const auto shortComment_def = "--" >> scan_parser<scan::skipLine>{};
+	const auto longComment_def = "--" >> longBracket;
 	const auto comment_def = longComment | shortComment;
 
 	// Keywords
 	auto kwd = [](const char* str) {
-		return with<element_tag>(pos::Element{ast::ElementType::keyword})
-			[omit[elementStart]
-			 >> omit[x3::string(str)]
-			 >> x3::no_skip[omit[elementEnd]]];
+		return registerElement(ast::ElementType::keyword, word_parser(str));
 	};
 
 	// A skipper that ignore whitespace and comments
+#ifdef LAC_VALIDATION_GRAMMAR
+	struct skipper; // Not the one of chunk.h
+#endif
 	const x3::rule<struct skipper> skipper = "skipper";
 	const auto skipper_def = ascii::space
-							 | with<element_tag>(pos::Element{ast::ElementType::comment})
-								   [x3::no_skip[omit[elementStart >> comment >> elementEnd]]];
+							 | x3::no_skip[registerElement(ast::ElementType::comment, comment)];
 
 	//*** Complete syntax of Lua ***
 	// Table and fields
 	const auto fieldByExpression_def = '[' >> expression >> lit(']') >> lit('=') >> expression;
 	const auto fieldByAssignment_def = name >> '=' >> expression;
-	const auto field_def = fieldByExpression
-						   | fieldByAssignment
-						   | expression;
+	const auto field_def = counted(fieldByExpression
+								   | fieldByAssignment
+								   | expression);
 
 	const auto fieldSeparator = lit(',') | lit(';');
 	const auto fieldsList_def = field >> *(fieldSeparator >> field) >> -fieldSeparator;
 
-	const auto tableConstructor_def = '{' >> -fieldsList >> '}';
+	const auto tableConstructor_def = lit('{') >> nested(-fieldsList >> '}');
 
 	// Functions
 	const auto funcVarargs = lit("...") >> x3::attr(true);
@@ -359,12 +308,61 @@ namespace lac::parser
 							   | tableConstructor
 							   | literalString;
 
-	const auto functionBody_def = '(' >> -parametersList >> ')' >> block >> kwd("end");
+	const auto functionParameters = '(' >> -parametersList >> ')';
+	const auto functionBlock = block >> kwd("end");
+
+	// Parse the body of a function, or only the range of its block if the lazy bodies are enabled in the context
+	struct function_body_parser : x3::parser<function_body_parser>
+	{
+		using attribute_type = ast::FunctionBody;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+		{
+			if constexpr (pos::has_tag<Context, lazy_body_tag> && std::is_same_v<Attribute, ast::FunctionBody>)
+			{
+				if (x3::get<lazy_body_tag>(context).get().enabled())
+					return parseLazy(first, last, context, rcontext, attr);
+			}
+			return (functionParameters >> functionBlock).parse(first, last, context, rcontext, attr);
+		}
+
+		template <typename Iterator, typename Context, typename RContext>
+		static bool parseLazy(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, ast::FunctionBody& attr)
+		{
+			const auto start = first;
+			if (!functionParameters.parse(first, last, context, rcontext, attr.parameters))
+				return false;
+
+			// The block starts right after the parameters, so that parsing it later gives the same tree
+			const auto size = findBlockEnd({&*first, static_cast<size_t>(last - first)}, 0);
+			if (size == std::string_view::npos)
+			{
+				first = start;
+				return false;
+			}
+
+			const auto& lazyBodies = x3::get<lazy_body_tag>(context).get();
+			const auto end = first + size;
+			ast::LazyBlock lazy;
+			lazy.begin = lazyBodies.pos(first);
+			lazy.end = lazyBodies.pos(end) - 1; // Inclusive, as the other positions
+			attr.lazy = lazy;
+			if constexpr (pos::has_tag<Context, pos::position_tag>)
+				x3::get<pos::position_tag>(context).get().annotate(attr.block, first, end);
+
+			first = end;
+			return kwd("end").parse(first, last, context, rcontext, x3::unused);
+		}
+	};
+
+	const auto functionBody_def = function_body_parser{};
 
 	const auto functionDefinition_def = kwd("function") >> functionBody;
 
-	const auto functionCallPostfix_def = *(tableIndexExpression
-										   | tableIndexName)
+	const auto functionCallPostfix_def = *(checkpoint >> (tableIndexExpression
+														 | tableIndexName))
 										 >> functionCallEnd;
 
 	const auto functionCall_def = (bracketedExpression
@@ -378,16 +376,16 @@ namespace lac::parser
 	const auto functionName_def = name >> *('.' >> name) >> -functionNameMember;
 
 	// Variables
-	const auto bracketedExpression_def = '(' >> expression >> ')';
+	const auto bracketedExpression_def = lit('(') >> nested(expression >> ')');
 	const auto tableIndexExpression_def = '[' >> expression >> ']';
 	const auto tableIndexName_def = '.' >> name;
 	const auto prefixExpression_def = (bracketedExpression
 									   | name)
 									  >> *postPrefix;
 
-	const auto postPrefix_def = (tableIndexExpression
-								| tableIndexName
-								| functionCallEnd);
+	const auto postPrefix_def = checkpoint >> (tableIndexExpression
+											  | tableIndexName
+											  | functionCallEnd);
 
 	const auto variable_def = (bracketedExpression
 							   | name)
@@ -395,9 +393,9 @@ namespace lac::parser
 
 	const auto variableFunctionCall_def = functionCallEnd >> variablePostfix; // Should not stop with a function call
 
-	const auto variablePostfix_def = tableIndexExpression
-									 | tableIndexName
-									 | variableFunctionCall;
+	const auto variablePostfix_def = checkpoint >> (tableIndexExpression
+												   | tableIndexName
+												   | variableFunctionCall);
 
 	const auto variablesList_def = variable % ',';
 
@@ -414,11 +412,16 @@ namespace lac::parser
 									  | functionDefinition
 									  | prefixExpression;
 
-	const auto unaryOperation_def = unaryOperator >> expression;
-	const auto binaryOperation_def = binaryOperator >> expression;
-	const auto expression_def = simpleExpression >> -binaryOperation;
+	// Flat list of operations, the precedence being applied when evaluating the expression.
+	// Only the exponentiation binds tighter than the unary operators.
+	// The checkpoints stop a single huge expression once a limit is reached.
+	const auto powerOperation_def = checkpoint >> lit('^') >> x3::attr(ast::Operation::pow) >> simpleExpression;
+	const auto unaryOperand_def = simpleExpression >> *powerOperation;
+	const auto unaryOperation_def = unaryOperator >> unaryOperand;
+	const auto binaryOperation_def = checkpoint >> binaryOperator >> simpleExpression;
+	const auto expression_def = simpleExpression >> *binaryOperation;
 
-	const auto expressionsList_def = expression >> *(',' >> expression);
+	const auto expressionsList_def = expression >> *(checkpoint >> ',' >> expression);
 
 	// Statements
 	const auto emptyStatement = lit(';') >> x3::attr(ast::EmptyStatement{});
@@ -443,34 +446,243 @@ namespace lac::parser
 	const auto localFunctionDeclarationStatement_def = kwd("local") >> kwd("function") >> name >> functionBody;
 	const auto localAssignmentStatement_def = kwd("local") >> namesList >> -('=' >> expressionsList);
 
-	const auto statement_def = emptyStatement
-							   | assignmentStatement
-							   | functionCall
-							   | labelStatement
-							   | gotoStatement
-							   | breakStatement
-							   | doStatement
-							   | whileStatement
-							   | repeatStatement
-							   | ifThenElseStatement
-							   | numericalForStatement
-							   | genericForStatement
-							   | functionDeclarationStatement
-							   | localFunctionDeclarationStatement
-							   | localAssignmentStatement;
+	// Only when the error recovery is enabled: represent the invalid part as an empty statement
+	const auto invalidStatement = skipInvalidStatement >> x3::attr(ast::EmptyStatement{});
+
+	// Parse with the attribute of the parser, then move it into attr (a variant)
+	template <typename Parser, typename Iterator, typename Context, typename RContext, typename Attribute>
+	bool parseInto(const Parser& parser, Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr)
+	{
+		if constexpr (std::is_same_v<Attribute, x3::unused_type>)
+			return parser.parse(first, last, context, rcontext, attr);
+		else
+		{
+			typename x3::traits::attribute_of<Parser, Context>::type value;
+			if (!parser.parse(first, last, context, rcontext, value))
+				return false;
+			attr = std::move(value);
+			return true;
+		}
+	}
+
+	// An assignment and a function call start with the same prefix expression, whose arguments can contain whole functions:
+	// trying one then the other would parse the nested statements again at each level.
+	// The prefix is parsed only once, then moved into the first variable, or into the function call if it ends with one.
+	struct assignment_or_call_parser : x3::parser<assignment_or_call_parser>
+	{
+		using attribute_type = ast::Statement;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+		{
+			constexpr bool synthesize = !std::is_same_v<Attribute, x3::unused_type>;
+			using Start = std::conditional_t<synthesize, decltype(ast::Variable::start), x3::unused_type>;
+			using Value = std::conditional_t<synthesize, ast::PostPrefix, x3::unused_type>;
+			using VariablesList = std::conditional_t<synthesize, ast::VariablesList, x3::unused_type>;
+			using ExpressionsList = std::conditional_t<synthesize, ast::ExpressionsList, x3::unused_type>;
+
+			const auto begin = first;
+			Start start;
+			if (!(bracketedExpression | name).parse(first, last, context, rcontext, start))
+				return false;
+			const auto startEnd = first;
+
+			std::vector<Postfix<Iterator, Value>> postfixes;
+			for (Postfix<Iterator, Value> postfix; checkpoint.parse(first, last, context, rcontext, x3::unused)
+												   && parsePostfix(first, last, context, rcontext, postfix.value, postfix.isCall);)
+			{
+				postfix.end = first;
+				postfixes.push_back(std::move(postfix));
+			}
+
+			// The first variable stops at the last index, the function call at the last call
+			const auto isCall = [](const auto& postfix) { return postfix.isCall; };
+			const auto nbVariable = static_cast<size_t>(std::find_if_not(postfixes.rbegin(), postfixes.rend(), isCall).base() - postfixes.begin());
+			const auto nbCall = static_cast<size_t>(std::find_if(postfixes.rbegin(), postfixes.rend(), isCall).base() - postfixes.begin());
+
+			// As when trying the assignment first, the start of a function call is registered as a variable
+			ast::Variable firstVariable;
+			if constexpr (pos::has_tag<Context, pos::position_tag>)
+				x3::get<pos::position_tag>(context).get().annotate(firstVariable, begin, nbVariable ? postfixes[nbVariable - 1].end : startEnd);
+
+			if (nbVariable == postfixes.size())
+			{
+				VariablesList variables;
+				ExpressionsList expressions;
+				if ((*(',' >> variable)).parse(first, last, context, rcontext, variables)
+					&& (lit('=') >> expressionsList).parse(first, last, context, rcontext, expressions))
+				{
+					if constexpr (synthesize)
+					{
+						ast::AssignmentStatement assignment;
+						makeVariable(firstVariable, start, postfixes);
+						assignment.variables.push_back(std::move(firstVariable));
+						std::move(variables.begin(), variables.end(), std::back_inserter(assignment.variables));
+						assignment.expressions = std::move(expressions);
+						attr = std::move(assignment);
+					}
+					return true;
+				}
+			}
+
+			if (!nbCall)
+			{
+				first = begin;
+				return false;
+			}
+
+			first = postfixes[nbCall - 1].end;
+			if constexpr (synthesize)
+			{
+				postfixes.resize(nbCall);
+				attr = makeFunctionCall(start, postfixes);
+			}
+			return true;
+		}
+
+	private:
+		template <typename Iterator, typename Value>
+		struct Postfix
+		{
+			Value value;
+			Iterator end{};
+			bool isCall = false;
+		};
+
+		template <typename Iterator, typename Context, typename RContext, typename Value>
+		static bool parsePostfix(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Value& value, bool& isCall)
+		{
+			isCall = false;
+			if (parseInto(tableIndexExpression, first, last, context, rcontext, value)
+				|| parseInto(tableIndexName, first, last, context, rcontext, value))
+				return true;
+			isCall = true;
+			return parseInto(functionCallEnd, first, last, context, rcontext, value);
+		}
+
+		template <typename Start, typename Postfixes>
+		static void makeVariable(ast::Variable& var, Start& start, Postfixes& postfixes)
+		{
+			var.start = std::move(start);
+
+			// The calls are nested with the postfix following them, as a variable cannot end with a call
+			for (auto it = postfixes.begin(); it != postfixes.end();)
+			{
+				const auto index = std::find_if(it, postfixes.end(), [](const auto& postfix) { return !postfix.isCall; });
+				ast::VariablePostfix postVariable = makeIndex<ast::VariablePostfix>(index->value);
+				for (auto call = index; call != it;)
+				{
+					--call;
+					ast::VariableFunctionCall vfc;
+					vfc.functionCall = std::move(boost::get<ast::FunctionCallEnd>(call->value.get()));
+					vfc.postVariable = std::move(postVariable);
+					postVariable = ast::f_VariableFunctionCall(std::move(vfc));
+				}
+				var.rest.push_back(std::move(postVariable));
+				it = index + 1;
+			}
+		}
+
+		template <typename Start, typename Postfixes>
+		static ast::FunctionCall makeFunctionCall(Start& start, Postfixes& postfixes)
+		{
+			ast::FunctionCall call;
+			call.start = std::move(start);
+			ast::FunctionCallPostfix callPostfix;
+			for (auto& postfix : postfixes)
+			{
+				if (!postfix.isCall)
+					callPostfix.tableIndex.push_back(makeIndex<ast::TableIndex>(postfix.value));
+				else
+				{
+					callPostfix.functionCall = std::move(boost::get<ast::FunctionCallEnd>(postfix.value.get()));
+					call.rest.push_back(std::move(callPostfix));
+					callPostfix = {};
+				}
+			}
+			return call;
+		}
+
+		template <typename Index>
+		static Index makeIndex(ast::PostPrefix& value)
+		{
+			if (auto expression = boost::get<ast::TableIndexExpression>(&value.get()))
+				return Index(std::move(*expression));
+			return Index(std::move(boost::get<ast::TableIndexName>(value.get())));
+		}
+	};
+
+	const auto assignmentOrCall = assignment_or_call_parser{};
+
+	// Choose the statement from its first token, instead of trying them in order.
+	// Only the statements starting with a name or a bracket can be an assignment or a function call.
+	struct statement_parser : x3::parser<statement_parser>
+	{
+		using attribute_type = ast::Statement;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last)
+				return false;
+
+			const auto parseAny = [&](const auto&... parsers) {
+				return (parseInto(parsers, first, last, context, rcontext, attr) || ...);
+			};
+			return parseFirstToken(first, last, parseAny)
+				   || parseAny(invalidStatement);
+		}
+
+		template <typename Iterator, typename ParseAny>
+		static bool parseFirstToken(const Iterator& first, const Iterator& last, const ParseAny& parseAny)
+		{
+			const auto c = *first;
+			if (c == ';')
+				return parseAny(emptyStatement);
+			if (c == ':')
+				return parseAny(labelStatement);
+			if (!scan::isNameFirstLetter(c))
+				return parseAny(assignmentOrCall);
+
+			const auto start = &*first;
+			const std::string_view word(start, scan::skipName(start + 1, start + (last - first)) - start);
+			const auto keyword = symbols::statementKeywords.find(word);
+			if (!keyword)
+				return !symbols::keywords.find(word) && parseAny(assignmentOrCall);
+
+			using SK = StatementKeyword;
+			switch (keyword->value)
+			{
+			case SK::local: return parseAny(localFunctionDeclarationStatement, localAssignmentStatement);
+			case SK::function: return parseAny(functionDeclarationStatement);
+			case SK::If: return parseAny(ifThenElseStatement);
+			case SK::For: return parseAny(numericalForStatement, genericForStatement);
+			case SK::While: return parseAny(whileStatement);
+			case SK::repeat: return parseAny(repeatStatement);
+			case SK::Do: return parseAny(doStatement);
+			case SK::Goto: return parseAny(gotoStatement);
+			case SK::Break: return parseAny(breakStatement);
+			default: return false;
+			}
+		}
+	};
+
+	const auto statement_def = counted(statement_parser{});
 
 	const auto returnStatement_def = kwd("return") >> -expressionsList >> -lit(';');
 
 	// Blocks
-	const auto block_def = *statement >> -returnStatement;
+	const auto block_def = nested(blockDepth(*statement >> -returnStatement));
 	const auto chunk_def = block;
 
 	BOOST_SPIRIT_DEFINE(name, namesList,
-						openLongBracket, closeLongBacket,
-						longLiteralString, literalStringValue, literalString,
-						numeralInt, numeralFloat, numeral,
+						longLiteralString, literalStringValue, literalStringSource, literalString)
+
+	BOOST_SPIRIT_DEFINE(numeralInt, numeralFloat, numeral,
 						shortComment, longComment, comment,
-						elementStart, elementEnd,
 						skipper,
 						fieldByExpression, fieldByAssignment, field, fieldsList, tableConstructor,
 						parametersList, arguments,
@@ -480,7 +692,7 @@ namespace lac::parser
 						prefixExpression, postPrefix,
 						variable, variableFunctionCall, variablePostfix, variablesList,
 						variableOrFunction,
-						unaryOperation, binaryOperation,
+						unaryOperation, binaryOperation, powerOperation, unaryOperand,
 						simpleExpression, expression, expressionsList,
 						assignmentStatement, localAssignmentStatement,
 						labelStatement, gotoStatement, breakStatement, doStatement,
@@ -491,6 +703,7 @@ namespace lac::parser
 						returnStatement, statement,
 						block, chunk)
 
+#ifndef LAC_VALIDATION_GRAMMAR
 	skipper_type skipperRule()
 	{
 		return skipper;
@@ -505,4 +718,5 @@ namespace lac::parser
 	{
 		return variableOrFunction;
 	}
+#endif
 } // namespace lac::parser
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <lac/parser/chunk.h>
+#include <lac/parser/error_recovery.h>
+#include <lac/parser/governor.h>
+#include <lac/parser/lazy_body.h>
 #include <string_view>
 
 namespace lac::parser
@@ -9,6 +12,8 @@ namespace lac::parser
 
 	using iterator_type = std::string_view::const_iterator;
 	using positions_type = pos::Positions<iterator_type>;
+	using recovery_type = ErrorRecovery<iterator_type>;
+	using lazy_bodies_type = LazyBodies<iterator_type>;
 
 	using pos_context_type = x3::context<pos::position_tag,
 										 std::reference_wrapper<positions_type>>;
@@ -30,4 +35,20 @@ namespace lac::parser
 														   const x3::with_directive<skipper_type,
 																					pos::position_tag,
 																					std::reference_wrapper<positions_type>>>>;
+
+	// Contexts used by parseBlock
+	using parse_block_context_type = x3::context<lazy_body_tag,
+												 std::reference_wrapper<lazy_bodies_type>,
+												 x3::context<governor_tag,
+															 std::reference_wrapper<Governor>,
+															 x3::context<recovery_tag,
+																		 std::reference_wrapper<recovery_type>,
+																		 skipper_context_type>>>;
+	using parse_block_pos_context_type = x3::context<lazy_body_tag,
+													 std::reference_wrapper<lazy_bodies_type>,
+													 x3::context<governor_tag,
+																 std::reference_wrapper<Governor>,
+																 x3::context<recovery_tag,
+																			 std::reference_wrapper<recovery_type>,
+																			 chunk_pos_context_type>>>;
 } // namespace lac::parser
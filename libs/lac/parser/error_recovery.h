@@ -0,0 +1,173 @@
+#pragma once
+
+#include <lac/parser/positions.h>
+#include <lac/parser/tokenizer.h>
+
+#include <boost/spirit/home/x3.hpp>
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lac::parser
+{
+	namespace x3 = boost::spirit::x3;
+
+	struct recovery_tag
+	{
+	};
+
+	// State of the error recovery during a parse
+	template <typename Iterator>
+	class ErrorRecovery
+	{
+	public:
+		using Range = std::pair<size_t, size_t>; // End is exclusive
+
+		ErrorRecovery(Iterator begin, bool enabled)
+			: m_begin(begin)
+			, m_enabled(enabled)
+		{
+		}
+
+		bool enabled() const
+		{
+			return m_enabled;
+		}
+
+		bool isTopLevel() const
+		{
+			return m_depth == 1;
+		}
+
+		void enterBlock()
+		{
+			++m_depth;
+		}
+
+		void exitBlock()
+		{
+			--m_depth;
+		}
+
+		void addError(Iterator begin, Iterator end)
+		{
+			m_errors.emplace_back(begin - m_begin, end - m_begin);
+		}
+
+		// May contain ranges from alternatives that were discarded afterwards, overlapping the others
+		const std::vector<Range>& errors() const
+		{
+			return m_errors;
+		}
+
+	private:
+		Iterator m_begin;
+		bool m_enabled = false;
+		size_t m_depth = 0;
+		std::vector<Range> m_errors;
+	};
+
+	namespace details
+	{
+		inline bool isBlockEnd(std::string_view token)
+		{
+			return token == "end" || token == "else" || token == "elseif" || token == "until" || token == "return";
+		}
+
+		inline bool isStatementStart(std::string_view token)
+		{
+			return token == "local" || token == "function" || token == "if" || token == "for" || token == "while"
+				   || token == "repeat" || token == "do" || token == "goto" || token == "break" || token == "::" || token == ";";
+		}
+	} // namespace details
+
+	// Count the nested blocks for the error recovery
+	template <typename Subject>
+	struct block_depth_directive : x3::unary_parser<Subject, block_depth_directive<Subject>>
+	{
+		using base_type = x3::unary_parser<Subject, block_depth_directive<Subject>>;
+		static const bool is_pass_through_unary = true;
+
+		constexpr block_depth_directive(const Subject& subject)
+			: base_type(subject)
+		{
+		}
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+		{
+			if constexpr (!pos::has_tag<Context, recovery_tag>)
+				return this->subject.parse(first, last, context, rcontext, attr);
+			else
+			{
+				auto& recovery = x3::get<recovery_tag>(context).get();
+				recovery.enterBlock();
+				const auto result = this->subject.parse(first, last, context, rcontext, attr);
+				recovery.exitBlock();
+				return result;
+			}
+		}
+	};
+
+	template <typename Subject>
+	constexpr block_depth_directive<Subject> blockDepth(const Subject& subject)
+	{
+		return {subject};
+	}
+
+	// Skip the tokens of an invalid statement, until a keyword starting or ending a statement, or a new line.
+	// Only enabled if the context contains an enabled ErrorRecovery.
+	struct skip_invalid_statement_parser : x3::parser<skip_invalid_statement_parser>
+	{
+		using attribute_type = x3::unused_type;
+		static const bool has_attribute = false;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute&) const
+		{
+			if constexpr (!pos::has_tag<Context, recovery_tag>)
+				return false;
+			else
+			{
+				auto& recovery = x3::get<recovery_tag>(context).get();
+				if (!recovery.enabled())
+					return false;
+
+				x3::skip_over(first, last, context);
+				if (first == last)
+					return false;
+
+				const std::string_view view(&*first, last - first);
+				auto text = [&view](const Token& token) { return view.substr(token.begin, token.size); };
+
+				// Keywords ending a block are kept for it, unless there is no block to end
+				auto token = nextToken(view, 0);
+				const auto strayBlockEnd = details::isBlockEnd(text(token));
+				if (strayBlockEnd && (!recovery.isTopLevel() || text(token) == "return"))
+					return false;
+
+				size_t end = 0;
+				while (true)
+				{
+					end = token.begin + token.size;
+					if (token.type == TokenType::invalid || strayBlockEnd)
+						break;
+
+					token = nextToken(view, end);
+					if (!token.size
+						|| details::isBlockEnd(text(token))
+						|| details::isStatementStart(text(token))
+						|| view.substr(end, token.begin - end).find_first_of("\r\n") != std::string_view::npos)
+						break;
+				}
+
+				recovery.addError(first, first + end);
+				first += end;
+				return true;
+			}
+		}
+	};
+
+	const skip_invalid_statement_parser skipInvalidStatement = {};
+} // namespace lac::parser
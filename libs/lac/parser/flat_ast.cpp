@@ -0,0 +1,610 @@
+#include <lac/parser/flat_ast.h>
+#include <lac/parser/visitor.h>
+
+#include <iterator>
+
+#ifdef WITH_TESTS
+#include <lac/parser/parser.h>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <string>
+#endif
+
+namespace lac::ast
+{
+	std::string_view kindName(NodeKind kind)
+	{
+		static const std::string_view names[] = {
+			"block", "returnStatement", "emptyStatement", "assignmentStatement", "functionCallStatement",
+			"labelStatement", "gotoStatement", "breakStatement", "doStatement", "whileStatement", "repeatStatement",
+			"ifStatement", "numericalForStatement", "genericForStatement", "functionDeclarationStatement",
+			"localFunctionDeclarationStatement", "localAssignmentStatement",
+			"names", "expressions", "variables",
+			"expression", "binaryOperation", "constant", "integer", "floating", "literalString", "unaryOperation",
+			"tableConstructor", "fieldByExpression", "fieldByAssignment", "prefixExpression", "functionBody",
+			"name", "bracketedExpression", "tableIndexExpression", "tableIndexName", "call", "variable",
+			"parameters", "functionName"};
+		static_assert(std::size(names) == static_cast<size_t>(NodeKind::functionName) + 1);
+		return names[static_cast<size_t>(kind)];
+	}
+
+	size_t FlatTree::childrenCount(Index node) const
+	{
+		size_t count = 0;
+		for (auto it = node + 1, end = m_ends[node]; it != end; it = m_ends[it])
+			++count;
+		return count;
+	}
+
+	FlatTree::Index FlatTree::child(Index node, size_t n) const
+	{
+		auto it = node + 1;
+		for (; n; --n)
+			it = m_ends[it];
+		return it;
+	}
+
+	FlatTree::Index FlatTree::lastChild(Index node) const
+	{
+		auto it = node + 1;
+		for (auto next = m_ends[it], end = m_ends[node]; next != end; next = m_ends[next])
+			it = next;
+		return it;
+	}
+
+	size_t FlatTree::memoryUsage() const
+	{
+		return m_kinds.capacity() * sizeof(NodeKind)
+			   + (m_ends.capacity() + m_data.capacity() + m_begin.capacity() + m_end.capacity()) * sizeof(uint32_t)
+			   + m_names.capacity() * sizeof(Atom)
+			   + m_integers.capacity() * sizeof(int64_t)
+			   + m_floats.capacity() * sizeof(double)
+			   + m_literals.capacity() * sizeof(std::string_view);
+	}
+
+	FlatTree::Index FlatTree::open(NodeKind kind, uint32_t data, size_t begin, size_t end)
+	{
+		const auto node = size();
+		m_kinds.push_back(kind);
+		m_ends.push_back(node + 1);
+		m_data.push_back(data);
+		m_begin.push_back(static_cast<uint32_t>(begin));
+		m_end.push_back(static_cast<uint32_t>(end));
+		return node;
+	}
+
+	void FlatTree::close(Index node)
+	{
+		m_ends[node] = size();
+	}
+
+	uint32_t FlatTree::addName(Atom name)
+	{
+		m_names.push_back(name);
+		return static_cast<uint32_t>(m_names.size() - 1);
+	}
+
+	/****************************************************************************/
+
+	// Append the nodes of the variant tree in depth-first order
+	class Lowering : public Dispatcher<Lowering, void>
+	{
+	public:
+		Lowering(FlatTree& tree)
+			: m_tree(tree)
+		{
+		}
+
+		using Dispatcher::operator();
+
+		void operator()(ExpressionConstant ec) const
+		{
+			leaf(NodeKind::constant, static_cast<uint32_t>(ec));
+		}
+
+		void operator()(const Numeral& n) const
+		{
+			if (n.isInt())
+			{
+				m_tree.m_integers.push_back(n.asInt());
+				leaf(NodeKind::integer, static_cast<uint32_t>(m_tree.m_integers.size() - 1), n.begin, n.end);
+			}
+			else
+			{
+				m_tree.m_floats.push_back(n.asFloat());
+				leaf(NodeKind::floating, static_cast<uint32_t>(m_tree.m_floats.size() - 1), n.begin, n.end);
+			}
+		}
+
+		void operator()(const LiteralString& ls) const
+		{
+			m_tree.m_literals.push_back(ls.source);
+			leaf(NodeKind::literalString, static_cast<uint32_t>(m_tree.m_literals.size() - 1), ls.begin, ls.end);
+		}
+
+		void operator()(Atom name) const
+		{
+			leaf(NodeKind::name, m_tree.addName(name));
+		}
+
+		void operator()(const UnaryOperation& uo) const
+		{
+			const auto node = m_tree.open(NodeKind::unaryOperation, static_cast<uint32_t>(uo.operation));
+			(*this)(uo.expression);
+			m_tree.close(node);
+		}
+
+		void operator()(const TableConstructor& tc) const
+		{
+			const auto node = m_tree.open(NodeKind::tableConstructor);
+			if (tc.fields)
+			{
+				for (const auto& f : *tc.fields)
+					boost::apply_visitor(*this, f);
+			}
+			m_tree.close(node);
+		}
+
+		void operator()(const FieldByExpression& f) const
+		{
+			const auto node = m_tree.open(NodeKind::fieldByExpression);
+			(*this)(f.key);
+			(*this)(f.value);
+			m_tree.close(node);
+		}
+
+		void operator()(const FieldByAssignment& f) const
+		{
+			const auto node = m_tree.open(NodeKind::fieldByAssignment, m_tree.addName(f.name));
+			(*this)(f.value);
+			m_tree.close(node);
+		}
+
+		void operator()(const PrefixExpression& pe) const
+		{
+			const auto node = m_tree.open(NodeKind::prefixExpression);
+			boost::apply_visitor(*this, pe.start);
+			for (const auto& pp : pe.rest)
+				boost::apply_visitor(*this, pp);
+			m_tree.close(node);
+		}
+
+		void operator()(const FunctionBody& fb) const
+		{
+			const auto node = m_tree.open(NodeKind::functionBody, fb.lazy ? 1 : 0);
+			if (fb.parameters)
+			{
+				const auto params = m_tree.open(NodeKind::parameters, fb.parameters->varargs ? 1 : 0);
+				for (const auto& p : fb.parameters->parameters)
+					(*this)(p);
+				m_tree.close(params);
+			}
+			if (fb.lazy)
+				block({}, fb.lazy->begin, fb.lazy->end);
+			else
+				(*this)(fb.block);
+			m_tree.close(node);
+		}
+
+		void operator()(const Operand& op) const
+		{
+			const auto first = m_tree.size();
+			boost::apply_visitor(*this, op);
+			if (m_tree.m_begin[first] == 0 && m_tree.m_end[first] == 0)
+			{
+				m_tree.m_begin[first] = static_cast<uint32_t>(op.begin);
+				m_tree.m_end[first] = static_cast<uint32_t>(op.end);
+			}
+		}
+
+		void operator()(const Expression& ex) const
+		{
+			const auto node = m_tree.open(NodeKind::expression);
+			(*this)(ex.operand);
+			for (const auto& bo : ex.binaryOperations)
+			{
+				const auto operation = m_tree.open(NodeKind::binaryOperation, static_cast<uint32_t>(bo.operation));
+				(*this)(bo.operand);
+				m_tree.close(operation);
+			}
+			m_tree.close(node);
+		}
+
+		void operator()(const ExpressionsList& el) const
+		{
+			const auto node = m_tree.open(NodeKind::expressions);
+			for (const auto& ex : el)
+				(*this)(ex);
+			m_tree.close(node);
+		}
+
+		void operator()(const NamesList& names) const
+		{
+			const auto node = m_tree.open(NodeKind::names);
+			for (const auto& name : names)
+				(*this)(name);
+			m_tree.close(node);
+		}
+
+		void operator()(const BracketedExpression& be) const
+		{
+			const auto node = m_tree.open(NodeKind::bracketedExpression);
+			(*this)(be.expression);
+			m_tree.close(node);
+		}
+
+		void operator()(const TableIndexExpression& tie) const
+		{
+			const auto node = m_tree.open(NodeKind::tableIndexExpression);
+			(*this)(tie.expression);
+			m_tree.close(node);
+		}
+
+		void operator()(const TableIndexName& tin) const
+		{
+			leaf(NodeKind::tableIndexName, m_tree.addName(tin.name));
+		}
+
+		void operator()(const FunctionCallEnd& fce) const
+		{
+			const auto member = fce.member ? m_tree.addName(*fce.member) : FlatTree::noMember;
+			const auto node = m_tree.open(NodeKind::call, member, fce.begin, fce.end);
+			boost::apply_visitor(*this, fce.arguments);
+			m_tree.close(node);
+		}
+
+		void operator()(const EmptyArguments&) const
+		{
+		}
+
+		// The chain of postfixes is flattened
+		void operator()(const VariableFunctionCall& vfc) const
+		{
+			(*this)(vfc.functionCall);
+			boost::apply_visitor(*this, vfc.postVariable);
+		}
+
+		void operator()(const Variable& v) const
+		{
+			const auto node = m_tree.open(NodeKind::variable, 0, v.begin, v.end);
+			boost::apply_visitor(*this, v.start);
+			for (const auto& vp : v.rest)
+				boost::apply_visitor(*this, vp);
+			m_tree.close(node);
+		}
+
+		void operator()(const FunctionCall& fc, size_t begin, size_t end) const
+		{
+			const auto node = m_tree.open(NodeKind::functionCallStatement, 0, begin, end);
+			boost::apply_visitor(*this, fc.start);
+			for (const auto& r : fc.rest)
+			{
+				for (const auto& ti : r.tableIndex)
+					boost::apply_visitor(*this, ti);
+				(*this)(r.functionCall);
+			}
+			m_tree.close(node);
+		}
+
+		void operator()(const ReturnStatement& rs) const
+		{
+			const auto node = m_tree.open(NodeKind::returnStatement);
+			for (const auto& ex : rs.expressions)
+				(*this)(ex);
+			m_tree.close(node);
+		}
+
+		void operator()(const Statement& s) const
+		{
+			m_begin = s.begin;
+			m_end = s.end;
+			boost::apply_visitor(*this, s);
+		}
+
+		void operator()(const EmptyStatement&) const
+		{
+			leaf(NodeKind::emptyStatement, 0, m_begin, m_end);
+		}
+
+		void operator()(const AssignmentStatement& as) const
+		{
+			const auto node = statement(NodeKind::assignmentStatement);
+			const auto variables = m_tree.open(NodeKind::variables);
+			for (const auto& v : as.variables)
+				(*this)(v);
+			m_tree.close(variables);
+			(*this)(as.expressions);
+			m_tree.close(node);
+		}
+
+		void operator()(const FunctionCall& fc) const
+		{
+			(*this)(fc, m_begin, m_end);
+		}
+
+		void operator()(const LabelStatement& ls) const
+		{
+			leaf(NodeKind::labelStatement, m_tree.addName(ls.name), m_begin, m_end);
+		}
+
+		void operator()(const GotoStatement& gs) const
+		{
+			leaf(NodeKind::gotoStatement, m_tree.addName(gs.label), m_begin, m_end);
+		}
+
+		void operator()(const BreakStatement&) const
+		{
+			leaf(NodeKind::breakStatement, 0, m_begin, m_end);
+		}
+
+		void operator()(const DoStatement& ds) const
+		{
+			const auto node = statement(NodeKind::doStatement);
+			(*this)(ds.block);
+			m_tree.close(node);
+		}
+
+		void operator()(const WhileStatement& ws) const
+		{
+			const auto node = statement(NodeKind::whileStatement);
+			(*this)(ws.condition);
+			(*this)(ws.block);
+			m_tree.close(node);
+		}
+
+		void operator()(const RepeatStatement& rs) const
+		{
+			const auto node = statement(NodeKind::repeatStatement);
+			(*this)(rs.block);
+			(*this)(rs.condition);
+			m_tree.close(node);
+		}
+
+		void operator()(const IfThenElseStatement& s) const
+		{
+			const auto node = statement(NodeKind::ifStatement);
+			(*this)(s.first.condition);
+			(*this)(s.first.block);
+			for (const auto& es : s.rest)
+			{
+				(*this)(es.condition);
+				(*this)(es.block);
+			}
+			if (s.elseBlock)
+				(*this)(*s.elseBlock);
+			m_tree.close(node);
+		}
+
+		void operator()(const NumericalForStatement& s) const
+		{
+			const auto node = statement(NodeKind::numericalForStatement, m_tree.addName(s.variable));
+			(*this)(s.first);
+			(*this)(s.last);
+			if (s.step)
+				(*this)(*s.step);
+			(*this)(s.block);
+			m_tree.close(node);
+		}
+
+		void operator()(const GenericForStatement& s) const
+		{
+			const auto node = statement(NodeKind::genericForStatement);
+			(*this)(s.variables);
+			(*this)(s.expressions);
+			(*this)(s.block);
+			m_tree.close(node);
+		}
+
+		void operator()(const FunctionDeclarationStatement& s) const
+		{
+			const auto node = statement(NodeKind::functionDeclarationStatement);
+			const auto name = m_tree.open(NodeKind::functionName, s.name.member ? 1 : 0);
+			(*this)(s.name.start);
+			for (const auto& r : s.name.rest)
+				(*this)(r);
+			if (s.name.member)
+				(*this)(s.name.member->name);
+			m_tree.close(name);
+			(*this)(s.body);
+			m_tree.close(node);
+		}
+
+		void operator()(const LocalFunctionDeclarationStatement& s) const
+		{
+			const auto node = statement(NodeKind::localFunctionDeclarationStatement, m_tree.addName(s.name));
+			(*this)(s.body);
+			m_tree.close(node);
+		}
+
+		void operator()(const LocalAssignmentStatement& s) const
+		{
+			const auto node = statement(NodeKind::localAssignmentStatement);
+			(*this)(s.variables);
+			if (s.expressions)
+				(*this)(*s.expressions);
+			m_tree.close(node);
+		}
+
+		void operator()(const Block& b) const
+		{
+			block(&b, b.begin, b.end);
+		}
+
+	private:
+		void leaf(NodeKind kind, uint32_t data, size_t begin = 0, size_t end = 0) const
+		{
+			m_tree.open(kind, data, begin, end);
+		}
+
+		// The range of the current statement
+		FlatTree::Index statement(NodeKind kind, uint32_t data = 0) const
+		{
+			return m_tree.open(kind, data, m_begin, m_end);
+		}
+
+		void block(const Block* b, size_t begin, size_t end) const
+		{
+			const auto node = m_tree.open(NodeKind::block, 0, begin, end);
+			if (b)
+			{
+				for (const auto& s : b->statements)
+					(*this)(s);
+				if (b->returnStatement)
+					(*this)(*b->returnStatement);
+			}
+			m_tree.close(node);
+		}
+
+		FlatTree& m_tree;
+		mutable size_t m_begin = 0, m_end = 0; // Range of the statement being lowered
+	};
+
+	FlatTree flatten(const Block& block)
+	{
+		FlatTree tree;
+		Lowering{tree}(block);
+		return tree;
+	}
+
+#ifdef WITH_TESTS
+	// Kinds of the nodes, indented by depth
+	std::string dumpTree(const FlatTree& tree)
+	{
+		std::string str;
+		std::vector<FlatTree::Index> ends;
+		for (FlatTree::Index node = 0; node < tree.size(); ++node)
+		{
+			while (!ends.empty() && ends.back() == node)
+				ends.pop_back();
+			str += std::string(ends.size(), ' ');
+			str += kindName(tree.kind(node));
+			switch (tree.kind(node))
+			{
+			case NodeKind::name:
+			case NodeKind::tableIndexName:
+			case NodeKind::fieldByAssignment:
+			case NodeKind::localFunctionDeclarationStatement:
+				str += " " + tree.name(node).str();
+				break;
+			case NodeKind::integer:
+				str += " " + std::to_string(tree.integer(node));
+				break;
+			case NodeKind::literalString:
+				str += " " + std::string(tree.literal(node));
+				break;
+			case NodeKind::call:
+				if (tree.hasMember(node))
+					str += " :" + tree.member(node).str();
+				break;
+			default:
+				break;
+			}
+			str += '\n';
+			ends.push_back(tree.subtreeEnd(node));
+		}
+		return str;
+	}
+
+	TEST_CASE("Flat tree")
+	{
+		const std::string_view program = R"~~(local t = {1, x = 'a'}
+function t:f(a, ...) return a.b[1]:g(2) end
+t.y, z = -t.x .. 2)~~";
+		const auto res = parser::parseBlock(program);
+		REQUIRE(res.parsed);
+		const auto tree = flatten(res.block);
+
+		CHECK(dumpTree(tree) == R"~~(block
+ localAssignmentStatement
+  names
+   name t
+  expressions
+   expression
+    tableConstructor
+     expression
+      integer 1
+     fieldByAssignment x
+      expression
+       literalString 'a'
+ functionDeclarationStatement
+  functionName
+   name t
+   name f
+  functionBody
+   parameters
+    name a
+   block
+    returnStatement
+     expression
+      prefixExpression
+       name a
+       tableIndexName b
+       tableIndexExpression
+        expression
+         integer 1
+       call :g
+        expressions
+         expression
+          integer 2
+ assignmentStatement
+  variables
+   variable
+    name t
+    tableIndexName y
+   variable
+    name z
+  expressions
+   expression
+    unaryOperation
+     expression
+      prefixExpression
+       name t
+       tableIndexName x
+    binaryOperation
+     integer 2
+)~~");
+
+		// Navigation
+		CHECK(tree.subtreeEnd(tree.root()) == tree.size());
+		CHECK(tree.childrenCount(tree.root()) == 3);
+		const auto function = tree.child(tree.root(), 1);
+		CHECK(tree.kind(function) == NodeKind::functionDeclarationStatement);
+		CHECK(program.substr(tree.begin(function), tree.end(function) - tree.begin(function)).substr(0, 8) == "function");
+		const auto functionName = tree.child(function, 0);
+		CHECK(tree.flag(functionName)); // Method
+		const auto parameters = tree.child(tree.child(function, 1), 0);
+		CHECK(tree.kind(parameters) == NodeKind::parameters);
+		CHECK(tree.flag(parameters)); // Varargs
+		size_t nbNames = 0;
+		for (const auto child : tree.children(functionName))
+		{
+			CHECK(tree.kind(child) == NodeKind::name);
+			++nbNames;
+		}
+		CHECK(nbNames == 2);
+
+		// The literals are views of the source
+		const auto literal = std::find(tree.kinds().begin(), tree.kinds().end(), NodeKind::literalString) - tree.kinds().begin();
+		CHECK(tree.literal(static_cast<FlatTree::Index>(literal)) == "'a'");
+		CHECK(tree.literal(static_cast<FlatTree::Index>(literal)).data() == program.data() + program.find("'a'"));
+	}
+
+	TEST_CASE("Flat tree of lazy bodies")
+	{
+		parser::ParseOptions options;
+		options.lazyFunctionBodies = true;
+		const auto res = parser::parseBlock("f = function(a) return a end", options);
+		REQUIRE(res.parsed);
+		const auto tree = flatten(res.block);
+		const auto body = static_cast<FlatTree::Index>(
+			std::find(tree.kinds().begin(), tree.kinds().end(), NodeKind::functionBody) - tree.kinds().begin());
+		REQUIRE(body < tree.size());
+		CHECK(tree.flag(body));
+		const auto block = tree.child(body, 1);
+		CHECK(tree.kind(block) == NodeKind::block);
+		CHECK(tree.children(block).empty());
+		CHECK(tree.begin(block) < tree.end(block));
+	}
+#endif
+} // namespace lac::ast
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <lac/core_api.h>
+#include <lac/parser/ast.h>
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+// Compact representation of the tree, built from ast::Block by flatten.
+// The nodes are stored in depth-first order in parallel arrays: the children of a node follow it,
+// and each node stores the index after its last descendant, so a traversal is a linear scan.
+namespace lac::ast
+{
+	enum class NodeKind : uint8_t
+	{
+		// Statements
+		block,                             // Statements, then the return statement if any
+		returnStatement,                   // Expressions
+		emptyStatement,                    //
+		assignmentStatement,               // Variables, then expressions
+		functionCallStatement,             // Start, then postfixes ending with a call
+		labelStatement,                    // Data: name
+		gotoStatement,                     // Data: name
+		breakStatement,                    //
+		doStatement,                       // Block
+		whileStatement,                    // Condition, block
+		repeatStatement,                   // Block, condition
+		ifStatement,                       // Condition and block for each branch, then the else block if any
+		numericalForStatement,             // Data: name. First, last, step if any, block
+		genericForStatement,               // Names, expressions, block
+		functionDeclarationStatement,      // Function name, function body
+		localFunctionDeclarationStatement, // Data: name. Function body
+		localAssignmentStatement,          // Names, then expressions if any
+
+		// Lists
+		names,       // Names
+		expressions, // Expressions
+		variables,   // Variables
+
+		// Expressions
+		expression,      // Operand, then binary operations
+		binaryOperation, // Data: operation. Operand
+		constant,        // Data: ExpressionConstant
+		integer,         // Data: integer
+		floating,        // Data: floating
+		literalString,   // Data: literal
+		unaryOperation,  // Data: operation. Expression
+		tableConstructor,   // Fields, expressions for positional fields
+		fieldByExpression,  // Key, value
+		fieldByAssignment,  // Data: name. Value
+		prefixExpression,   // Start, then postfixes
+		functionBody,       // Data: 1 if lazy. Parameters if any, block
+
+		// Parts of prefix expressions, variables and function calls
+		name,                 // Data: name
+		bracketedExpression,  // Expression
+		tableIndexExpression, // Expression
+		tableIndexName,       // Data: name
+		call,                 // Data: member name or noMember. Arguments if any: expressions, table constructor or literal string
+		variable,             // Start, then postfixes
+
+		// Parts of declarations
+		parameters,   // Data: 1 if varargs. Names
+		functionName, // Data: 1 if method. Names, the last one being the method if any
+	};
+
+	CORE_API std::string_view kindName(NodeKind kind);
+
+	class CORE_API FlatTree
+	{
+	public:
+		using Index = uint32_t;
+		static constexpr Index noMember = std::numeric_limits<Index>::max();
+
+		// Children of a node, iterated by jumping over the descendants of each one
+		class Children
+		{
+		public:
+			class iterator
+			{
+			public:
+				iterator(const FlatTree& tree, Index index)
+					: m_tree(&tree)
+					, m_index(index)
+				{
+				}
+
+				Index operator*() const { return m_index; }
+				iterator& operator++()
+				{
+					m_index = m_tree->subtreeEnd(m_index);
+					return *this;
+				}
+				bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+				bool operator==(const iterator& other) const { return m_index == other.m_index; }
+
+			private:
+				const FlatTree* m_tree;
+				Index m_index;
+			};
+
+			Children(const FlatTree& tree, Index node)
+				: m_tree(tree)
+				, m_node(node)
+			{
+			}
+
+			iterator begin() const { return {m_tree, m_node + 1}; }
+			iterator end() const { return {m_tree, m_tree.subtreeEnd(m_node)}; }
+			bool empty() const { return m_node + 1 == m_tree.subtreeEnd(m_node); }
+
+		private:
+			const FlatTree& m_tree;
+			Index m_node;
+		};
+
+		Index size() const { return static_cast<Index>(m_kinds.size()); }
+		static constexpr Index root() { return 0; } // The block of the chunk, if the tree is not empty
+
+		NodeKind kind(Index node) const { return m_kinds[node]; }
+		Index subtreeEnd(Index node) const { return m_ends[node]; } // Index after the last descendant
+		Children children(Index node) const { return {*this, node}; }
+		size_t childrenCount(Index node) const;
+		Index child(Index node, size_t n) const; // The nth child, which must exist
+		Index lastChild(Index node) const;       // Which must exist
+
+		// Range in the source, for the nodes that have one in the variant tree (blocks, statements,
+		// operands, variables, calls), 0 for the other ones
+		size_t begin(Index node) const { return m_begin[node]; }
+		size_t end(Index node) const { return m_end[node]; }
+
+		// Payload of the node, see NodeKind
+		Atom name(Index node) const { return m_names[m_data[node]]; }
+		int64_t integer(Index node) const { return m_integers[m_data[node]]; }
+		double floating(Index node) const { return m_floats[m_data[node]]; }
+		std::string_view literal(Index node) const { return m_literals[m_data[node]]; } // With the delimiters
+		Operation operation(Index node) const { return static_cast<Operation>(m_data[node]); }
+		ExpressionConstant constant(Index node) const { return static_cast<ExpressionConstant>(m_data[node]); }
+		bool flag(Index node) const { return m_data[node] != 0; } // Lazy body, varargs or method
+		bool hasMember(Index node) const { return m_data[node] != noMember; }
+		Atom member(Index node) const { return m_names[m_data[node]]; } // Of a call, if hasMember
+
+		// For linear scans of the whole tree
+		const std::vector<NodeKind>& kinds() const { return m_kinds; }
+
+		size_t memoryUsage() const; // Bytes used by the arrays
+
+	private:
+		friend class Lowering;
+
+		Index open(NodeKind kind, uint32_t data = 0, size_t begin = 0, size_t end = 0);
+		void close(Index node);
+		uint32_t addName(Atom name);
+
+		std::vector<NodeKind> m_kinds;
+		std::vector<Index> m_ends;
+		std::vector<uint32_t> m_data;
+		std::vector<uint32_t> m_begin, m_end;
+
+		std::vector<Atom> m_names;
+		std::vector<int64_t> m_integers;
+		std::vector<double> m_floats;
+		std::vector<std::string_view> m_literals; // Views of the parsed buffer, as ast::LiteralString
+	};
+
+	// Build the flat representation of the tree, which stays valid while the parsed buffer is
+	CORE_API FlatTree flatten(const Block& block);
+} // namespace lac::ast
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <lac/parser/positions.h>
+
+#include <boost/spirit/home/x3.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+namespace lac::parser
+{
+	namespace x3 = boost::spirit::x3;
+
+	// Bounds of a parse or an analysis, to stop on pathological inputs. Zero means no limit.
+	struct Limits
+	{
+		const std::atomic<bool>* cancel = nullptr; // Can be set by another thread to stop as soon as possible
+		std::optional<std::chrono::steady_clock::time_point> deadline;
+		size_t maxDepth = 0;    // Nested blocks, tables and brackets
+		size_t maxElements = 0; // Statements and table fields, counted each time they are parsed (even if backtracking)
+
+		bool enabled() const
+		{
+			return cancel || deadline || maxDepth || maxElements;
+		}
+	};
+
+	enum class AbortReason
+	{
+		none,
+		cancelled,
+		deadline,
+		depth,
+		elements
+	};
+
+	struct governor_tag
+	{
+	};
+
+	// Check the limits during a parse or an analysis.
+	// Once one is reached, all the checks fail: the parser then stops at the next statement, block or table.
+	class Governor
+	{
+	public:
+		// The count of elements can be shared by the governors of a parallel parse
+		Governor(const Limits& limits, std::atomic<size_t>& elements)
+			: m_limits(limits)
+			, m_elements(elements)
+		{
+		}
+
+		// Must always be followed by exit
+		bool enter()
+		{
+			if (m_limits.maxDepth && ++m_depth > m_limits.maxDepth)
+				abort(AbortReason::depth);
+			return check();
+		}
+
+		void exit()
+		{
+			if (m_limits.maxDepth)
+				--m_depth;
+		}
+
+		bool count()
+		{
+			if (m_limits.maxElements && m_elements.fetch_add(1, std::memory_order_relaxed) >= m_limits.maxElements)
+				abort(AbortReason::elements);
+			return check();
+		}
+
+		// Only check the cancellation and the deadline, in the loops inside one element
+		bool poll()
+		{
+			return check();
+		}
+
+		AbortReason reason() const
+		{
+			return m_reason;
+		}
+
+	private:
+		static constexpr unsigned clockPeriod = 64; // Number of checks between two readings of the clock
+
+		bool check()
+		{
+			if (m_reason != AbortReason::none)
+				return false;
+			if (m_limits.cancel && m_limits.cancel->load(std::memory_order_relaxed))
+				abort(AbortReason::cancelled);
+			else if (m_limits.deadline && ++m_checks % clockPeriod == 0 && std::chrono::steady_clock::now() >= *m_limits.deadline)
+				abort(AbortReason::deadline);
+			return m_reason == AbortReason::none;
+		}
+
+		void abort(AbortReason reason)
+		{
+			if (m_reason == AbortReason::none)
+				m_reason = reason;
+		}
+
+		const Limits& m_limits;
+		std::atomic<size_t>& m_elements;
+		size_t m_depth = 0;
+		unsigned m_checks = 0;
+		AbortReason m_reason = AbortReason::none;
+	};
+
+	// Check the governor of the context, if any, when parsing the subject.
+	// If nesting, the subject counts as one level of depth, else as one element once parsed.
+	// A nesting must start after the opening token, as reaching the limit stops the parse even if the subject would not match.
+	template <typename Subject, bool nesting>
+	struct governed_directive : x3::unary_parser<Subject, governed_directive<Subject, nesting>>
+	{
+		using base_type = x3::unary_parser<Subject, governed_directive<Subject, nesting>>;
+		static const bool is_pass_through_unary = true;
+
+		constexpr governed_directive(const Subject& subject)
+			: base_type(subject)
+		{
+		}
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext& rcontext, Attribute& attr) const
+		{
+			if constexpr (!pos::has_tag<Context, governor_tag>)
+				return this->subject.parse(first, last, context, rcontext, attr);
+			else
+			{
+				auto& governor = x3::get<governor_tag>(context).get();
+				if constexpr (nesting)
+				{
+					const auto result = governor.enter() && this->subject.parse(first, last, context, rcontext, attr);
+					governor.exit();
+					return result;
+				}
+				else
+					return this->subject.parse(first, last, context, rcontext, attr) && governor.count();
+			}
+		}
+	};
+
+	template <typename Subject>
+	constexpr governed_directive<Subject, true> nested(const Subject& subject)
+	{
+		return {subject};
+	}
+
+	template <typename Subject>
+	constexpr governed_directive<Subject, false> counted(const Subject& subject)
+	{
+		return {subject};
+	}
+
+	// Match nothing, and fail once a limit is reached, to stop the long repetitions inside one element
+	struct checkpoint_parser : x3::parser<checkpoint_parser>
+	{
+		using attribute_type = x3::unused_type;
+		static const bool has_attribute = false;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator&, const Iterator&, const Context& context, RContext&, Attribute&) const
+		{
+			if constexpr (pos::has_tag<Context, governor_tag>)
+				return x3::get<governor_tag>(context).get().poll();
+			else
+				return true;
+		}
+	};
+
+	constexpr checkpoint_parser checkpoint{};
+} // namespace lac::parser
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lac::parser
+{
+	struct lazy_body_tag
+	{
+	};
+
+	// When enabled, the function blocks are skipped during the parse and only their range is recorded
+	template <typename Iterator>
+	class LazyBodies
+	{
+	public:
+		LazyBodies(Iterator begin, bool enabled)
+			: m_begin(begin)
+			, m_enabled(enabled)
+		{
+		}
+
+		bool enabled() const
+		{
+			return m_enabled;
+		}
+
+		size_t pos(Iterator it) const
+		{
+			return it - m_begin;
+		}
+
+	private:
+		Iterator m_begin;
+		bool m_enabled = false;
+	};
+} // namespace lac::parser
@@ -0,0 +1,160 @@
+#include <lac/parser/numeral.h>
+#include <lac/parser/scan.h>
+
+#ifdef WITH_TESTS
+#include <doctest/doctest.h>
+#endif
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+	using namespace lac;
+
+	int hexDigitValue(char c)
+	{
+		if (scan::isDigit(c))
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	const char* skipDigits(const char* it, const char* last, bool hexadecimal)
+	{
+		while (it != last && (hexadecimal ? hexDigitValue(*it) >= 0 : scan::isDigit(*it)))
+			++it;
+		return it;
+	}
+
+	// Read a float, falling back on strtod for the values out of range (infinity or 0)
+	double readFloat(const char* first, const char* last, bool hexadecimal)
+	{
+		double value = 0;
+		const auto res = std::from_chars(first, last, value, hexadecimal ? std::chars_format::hex : std::chars_format::general);
+		if (res.ec == std::errc::result_out_of_range)
+			return std::strtod(((hexadecimal ? "0x" : "") + std::string(first, last)).c_str(), nullptr);
+		return value;
+	}
+} // namespace
+
+namespace lac::parser
+{
+	NumeralScan scanNumeral(std::string_view view)
+	{
+		NumeralScan res;
+		const auto first = view.data();
+		const auto last = first + view.size();
+		const auto hexadecimal = view.size() > 1 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X');
+		const auto mantissa = hexadecimal ? first + 2 : first;
+
+		auto it = skipDigits(mantissa, last, hexadecimal);
+		bool hasDigits = it != mantissa;
+		bool isInt = true;
+		if (it != last && *it == '.')
+		{
+			const auto fraction = it + 1;
+			it = skipDigits(fraction, last, hexadecimal);
+			hasDigits = hasDigits || it != fraction;
+			isInt = false;
+		}
+		if (!hasDigits)
+			return res;
+
+		const auto exponent = hexadecimal ? 'p' : 'e';
+		if (it != last && (*it == exponent || *it == exponent - 'a' + 'A'))
+		{
+			auto digits = it + 1;
+			if (digits != last && (*digits == '+' || *digits == '-'))
+				++digits;
+			it = skipDigits(digits, last, false);
+			if (it == digits)
+				return res; // Malformed exponent
+			isInt = false;
+		}
+
+		// A numeral directly followed by a name is malformed, as "3x"
+		if (it != last && scan::isNameLetter(*it))
+			return res;
+
+		res.size = it - first;
+		res.isInt = isInt;
+		if (isInt && hexadecimal)
+		{
+			uint64_t value = 0;
+			for (auto c = mantissa; c != it; ++c)
+				value = value * 16 + hexDigitValue(*c);
+			res.intValue = static_cast<int64_t>(value);
+		}
+		else if (isInt)
+		{
+			const auto conversion = std::from_chars(first, it, res.intValue);
+			if (conversion.ec == std::errc::result_out_of_range)
+			{
+				res.isInt = false;
+				res.floatValue = readFloat(first, it, false);
+			}
+		}
+		else
+			res.floatValue = readFloat(mantissa, it, hexadecimal);
+		return res;
+	}
+
+#ifdef WITH_TESTS
+	void test_int(std::string_view str, int64_t value)
+	{
+		const auto res = scanNumeral(str);
+		CHECK(res.size == str.size());
+		CHECK(res.isInt);
+		CHECK(res.intValue == value);
+	}
+
+	void test_float(std::string_view str, double value)
+	{
+		const auto res = scanNumeral(str);
+		CHECK(res.size == str.size());
+		CHECK_FALSE(res.isInt);
+		CHECK(res.floatValue == value);
+	}
+
+	TEST_CASE("scan numeral")
+	{
+		test_int("0", 0);
+		test_int("42", 42);
+		test_int("9007199254740993", 9007199254740993);
+		test_int("9223372036854775807", INT64_MAX);
+		test_int("0xff", 255);
+		test_int("0XA0", 160);
+		test_int("0x7fffffffffffffff", INT64_MAX);
+		test_int("0xffffffffffffffff", -1); // Wraps around
+		test_int("0x10000000000000001", 1);
+
+		test_float("3.14", 3.14);
+		test_float("3.", 3.0);
+		test_float(".5", 0.5);
+		test_float("1e2", 1e2);
+		test_float("1.2E-3", 1.2e-3);
+		test_float("5e+2", 500.0);
+		test_float("9223372036854775808", 9223372036854775808.0); // Too large for an integer
+		test_float("0x.8", 0.5);
+		test_float("0x1p4", 16.0);
+		test_float("0xA.8p-1", 5.25);
+		test_float("0X1P+2", 4.0);
+		test_float("1e999", HUGE_VAL);
+
+		// Only the numeral
+		CHECK(scanNumeral("42 + 1").size == 2);
+		CHECK(scanNumeral("1.5)").size == 3);
+		CHECK(scanNumeral("3..x").size == 2);
+
+		// Not numerals
+		for (const auto str : {"", ".", "x", "-1", "0x", "0x.", "1e", "1e+", "0x1p", "3x", "0xfg", "inf", "nan"})
+			CHECK(scanNumeral(str).size == 0);
+	}
+#endif
+} // namespace lac::parser
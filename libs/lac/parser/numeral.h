@@ -0,0 +1,69 @@
+#pragma once
+
+#include <lac/core_api.h>
+#include <lac/parser/ast.h>
+
+#include <boost/spirit/home/x3/core/parser.hpp>
+#include <boost/spirit/home/x3/core/skip_over.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace lac::parser
+{
+	namespace x3 = boost::spirit::x3;
+
+	struct NumeralScan
+	{
+		size_t size = 0; // 0 if there is no valid numeral
+		bool isInt = false;
+		int64_t intValue = 0;
+		double floatValue = 0;
+	};
+
+	// Read the Lua numeral at the start of the view: decimal or hexadecimal, with an optional fraction and exponent.
+	// As in Lua, hexadecimal integers wrap around, and decimal integers not fitting in 64 bits are read as floats.
+	CORE_API NumeralScan scanNumeral(std::string_view view);
+
+	// Parse a numeral with scanNumeral, T being int64_t (only integers), double or ast::Numeral
+	template <class T>
+	struct numeral_parser : x3::parser<numeral_parser<T>>
+	{
+		using attribute_type = T;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute& attr) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last)
+				return false;
+
+			const auto scan = scanNumeral({&*first, static_cast<size_t>(last - first)});
+			if (!scan.size)
+				return false;
+
+			if constexpr (std::is_same_v<T, int64_t>)
+			{
+				if (!scan.isInt)
+					return false;
+			}
+
+			if constexpr (!std::is_same_v<Attribute, x3::unused_type>)
+			{
+				if constexpr (std::is_same_v<T, int64_t>)
+					attr = scan.intValue;
+				else if constexpr (std::is_same_v<T, double>)
+					attr = scan.isInt ? static_cast<double>(scan.intValue) : scan.floatValue;
+				else if (scan.isInt)
+					attr = scan.intValue;
+				else
+					attr = scan.floatValue;
+			}
+
+			first += scan.size;
+			return true;
+		}
+	};
+} // namespace lac::parser
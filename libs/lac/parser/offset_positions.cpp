@@ -0,0 +1,149 @@
+#include <lac/parser/offset_positions.h>
+#include <lac/parser/ast.h>
+#include <lac/parser/visitor.h>
+
+namespace
+{
+	lac::pos::PositionCallback offsetBy(std::ptrdiff_t offset)
+	{
+		return [offset](const lac::ast::PositionAnnotated& pa) {
+			pa.begin += offset;
+			pa.end += offset;
+		};
+	}
+
+	// Only for the nodes of a modifiable statement, visited as constant
+	lac::pos::LiteralCallback rebaseBy(std::ptrdiff_t distance)
+	{
+		return [distance](const lac::ast::LiteralString& ls) {
+			auto& source = const_cast<lac::ast::LiteralString&>(ls).source;
+			source = std::string_view(source.data() + distance, source.size());
+		};
+	}
+} // namespace
+
+namespace lac::pos
+{
+	class VisitPositions : public ast::Visitor<VisitPositions>
+	{
+	public:
+		VisitPositions(const PositionCallback& callback, const LiteralCallback& literalCallback = {})
+			: m_callback(callback)
+			, m_literalCallback(literalCallback)
+		{
+		}
+
+		void visit(const ast::PositionAnnotated& pa) const
+		{
+			if (m_callback)
+				m_callback(pa);
+		}
+
+		using Visitor::operator();
+
+		bool operator()(const ast::Numeral& n) const
+		{
+			visit(n);
+			return true;
+		}
+
+		bool operator()(const ast::LiteralString& ls) const
+		{
+			visit(ls);
+			if (m_literalCallback)
+				m_literalCallback(ls);
+			return true;
+		}
+
+		bool operator()(const ast::Operand& op) const
+		{
+			visit(op);
+			return boost::apply_visitor(*this, op);
+		}
+
+		bool operator()(const ast::FunctionCallEnd& fce) const
+		{
+			visit(fce);
+			return boost::apply_visitor(*this, fce.arguments);
+		}
+
+		bool operator()(const ast::Variable& v) const
+		{
+			visit(v);
+			return Visitor::operator()(v);
+		}
+
+		bool operator()(const ast::FunctionBody& fb) const
+		{
+			if (fb.lazy)
+				visit(*fb.lazy);
+			return (*this)(fb.block);
+		}
+
+		bool operator()(const ast::Statement& s) const
+		{
+			visit(s);
+			return boost::apply_visitor(*this, s);
+		}
+
+		bool operator()(const ast::Block& b) const
+		{
+			visit(b);
+			return Visitor::operator()(b);
+		}
+
+	private:
+		const PositionCallback& m_callback;
+		const LiteralCallback& m_literalCallback;
+	};
+
+	void visitPositions(const ast::Block& block, const PositionCallback& callback)
+	{
+		VisitPositions{callback}(block);
+	}
+
+	void visitPositions(const ast::Statement& statement, const PositionCallback& callback)
+	{
+		VisitPositions{callback}(statement);
+	}
+
+	void visitPositions(const ast::ReturnStatement& statement, const PositionCallback& callback)
+	{
+		VisitPositions{callback}(statement);
+	}
+
+	void offsetPositions(const ast::Block& block, std::ptrdiff_t offset)
+	{
+		visitPositions(block, offsetBy(offset));
+	}
+
+	void offsetPositions(const ast::Statement& statement, std::ptrdiff_t offset)
+	{
+		visitPositions(statement, offsetBy(offset));
+	}
+
+	void offsetPositions(const ast::ReturnStatement& statement, std::ptrdiff_t offset)
+	{
+		visitPositions(statement, offsetBy(offset));
+	}
+
+	void visitLiterals(const ast::Statement& statement, const LiteralCallback& callback)
+	{
+		VisitPositions{{}, callback}(statement);
+	}
+
+	void visitLiterals(const ast::ReturnStatement& statement, const LiteralCallback& callback)
+	{
+		VisitPositions{{}, callback}(statement);
+	}
+
+	void rebaseLiterals(ast::Statement& statement, std::ptrdiff_t distance)
+	{
+		visitLiterals(statement, rebaseBy(distance));
+	}
+
+	void rebaseLiterals(ast::ReturnStatement& statement, std::ptrdiff_t distance)
+	{
+		visitLiterals(statement, rebaseBy(distance));
+	}
+} // namespace lac::pos
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace lac::ast
+{
+	struct PositionAnnotated;
+	struct LiteralString;
+	struct Block;
+	struct Statement;
+	struct ReturnStatement;
+} // namespace lac::ast
+
+namespace lac::pos
+{
+	using PositionCallback = std::function<void(const ast::PositionAnnotated&)>;
+	using LiteralCallback = std::function<void(const ast::LiteralString&)>;
+
+	// Call the function on all the position annotated nodes
+	void visitPositions(const ast::Block& block, const PositionCallback& callback);
+	void visitPositions(const ast::Statement& statement, const PositionCallback& callback);
+	void visitPositions(const ast::ReturnStatement& statement, const PositionCallback& callback);
+
+	// Move all the position annotated nodes by the given offset
+	void offsetPositions(const ast::Block& block, std::ptrdiff_t offset);
+	void offsetPositions(const ast::Statement& statement, std::ptrdiff_t offset);
+	void offsetPositions(const ast::ReturnStatement& statement, std::ptrdiff_t offset);
+
+	// Call the function on all the literal strings
+	void visitLiterals(const ast::Statement& statement, const LiteralCallback& callback);
+	void visitLiterals(const ast::ReturnStatement& statement, const LiteralCallback& callback);
+
+	// Move the views of the literal strings by the given distance, when the source is now in another buffer
+	void rebaseLiterals(ast::Statement& statement, std::ptrdiff_t distance);
+	void rebaseLiterals(ast::ReturnStatement& statement, std::ptrdiff_t distance);
+} // namespace lac::pos
@@ -1,12 +1,31 @@
 #include <lac/parser/chunk.h>
+#include <lac/parser/config.h>
+#include <lac/parser/offset_positions.h>
 #include <lac/parser/parser.h>
 #include <lac/parser/positions.h>
+#include <lac/parser/structural_hash.h>
+#include <lac/parser/tokenizer.h>
+#include <lac/parser/visitor.h>
+#ifdef WITH_NLOHMANN_JSON
+#include <lac/parser/printer.h>
+#endif
 
 #ifdef WITH_TESTS
 #define DOCTEST_CONFIG_IMPLEMENTATION_IN_DLL
 #define DOCTEST_CONFIG_IMPLEMENT
 #include <doctest/doctest.h>
+#include <lac/helper/test_utils.h>
 #endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <thread>
+
 namespace lac::parser
 {
 	ParseBlockResults::ParseBlockResults(std::string_view view)
@@ -14,26 +33,456 @@ namespace lac::parser
 	{
 	}
 
+	ParseBlockResults& ParseBlockResults::operator=(ParseBlockResults other)
+	{
+		// The previous members are destroyed with other, the block before the arena
+		std::swap(parsed, other.parsed);
+		std::swap(arena, other.arena);
+		std::swap(block, other.block);
+		std::swap(positions, other.positions);
+		std::swap(lastParsedPosition, other.lastParsedPosition);
+		std::swap(errors, other.errors);
+		std::swap(aborted, other.aborted);
+		return *this;
+	}
+
+	namespace
+	{
+		// Parse the range [f, l) of the view. The count of elements is shared by the segments of a parallel parse.
+		bool parseRange(std::string_view view, iterator_type& f, iterator_type l, ParseBlockResults& res, const ParseOptions& options,
+						std::atomic<size_t>& elements)
+		{
+			namespace x3 = boost::spirit::x3;
+			recovery_type recovery{view.begin(), options.recoverErrors};
+			Governor governor{options.limits, elements};
+			lazy_bodies_type lazyBodies{view.begin(), options.lazyFunctionBodies};
+			bool parsed = false;
+			if (options.registerPositions)
+			{
+				const auto parser = x3::with<pos::position_tag>(std::ref(res.positions))[x3::with<recovery_tag>(std::ref(recovery))[x3::with<governor_tag>(std::ref(governor))[x3::with<lazy_body_tag>(std::ref(lazyBodies))[chunkRule()]]]];
+				const auto skipper = x3::with<pos::position_tag>(std::ref(res.positions))[skipperRule()];
+				parsed = x3::phrase_parse(f, l, parser, skipper, res.block);
+			}
+			else
+			{
+				const auto parser = x3::with<recovery_tag>(std::ref(recovery))[x3::with<governor_tag>(std::ref(governor))[x3::with<lazy_body_tag>(std::ref(lazyBodies))[chunkRule()]]];
+				parsed = x3::phrase_parse(f, l, parser, skipperRule(), res.block);
+			}
+
+			res.aborted = governor.reason();
+			if (res.aborted != AbortReason::none)
+				return false;
+
+			if (!options.recoverErrors)
+				return parsed;
+
+			// Merge the overlapping ranges, as discarded alternatives may have registered errors too
+			auto ranges = recovery.errors();
+			if (f != l)
+				ranges.emplace_back(f - view.begin(), l - view.begin()); // Could not be parsed at all
+			std::sort(ranges.begin(), ranges.end());
+			for (const auto& range : ranges)
+			{
+				if (!res.errors.empty() && range.first < res.errors.back().end)
+					res.errors.back().end = std::max(res.errors.back().end, range.second);
+				else
+					res.errors.push_back({range.first, range.second});
+			}
+
+			f = l;
+			return parsed;
+		}
+
+		// Find the starts of top-level statements, at least segmentSize apart, where the chunk can be cut in independent parts.
+		// Only the keywords always starting a statement are used, outside of any block or brackets.
+		std::vector<size_t> findSplitPoints(std::string_view view, size_t segmentSize)
+		{
+			std::vector<size_t> points;
+			int depth = 0;
+			size_t segmentBegin = 0;
+			bool hasStatement = false; // Each segment must contain something else than comments
+			bool afterLocal = false;
+			for (auto token = nextToken(view, 0); token.size; token = nextToken(view, token.begin + token.size))
+			{
+				const std::string_view str = view.substr(token.begin, token.size);
+				if (token.type == TokenType::keyword)
+				{
+					if (!depth && hasStatement && token.begin >= segmentBegin + segmentSize
+						&& (str == "local" || str == "if" || str == "for" || str == "while" || str == "repeat"
+							|| (str == "function" && !afterLocal && nextToken(view, token.begin + token.size).type == TokenType::name)))
+					{
+						points.push_back(token.begin);
+						segmentBegin = token.begin;
+						hasStatement = false;
+					}
+
+					if (str == "function" || str == "do" || str == "if" || str == "repeat")
+						++depth;
+					else if (str == "end" || str == "until")
+						--depth;
+				}
+				else if (token.type == TokenType::symbol)
+				{
+					if (str == "(" || str == "[" || str == "{")
+						++depth;
+					else if (str == ")" || str == "]" || str == "}")
+						--depth;
+				}
+				else if (token.type == TokenType::invalid)
+					break; // The following statements cannot be parsed anyway
+
+				if (depth < 0)
+					break; // Invalid, the sequential parse will report it
+				if (token.type != TokenType::comment)
+				{
+					hasStatement = true;
+					afterLocal = (str == "local");
+				}
+			}
+			return points;
+		}
+
+		// Arena of a parallel parse, also owning the arenas of the segments where the nodes were created
+		class ArenaGroup : public ast::Arena
+		{
+		public:
+			using Arena::Arena;
+
+			std::vector<std::shared_ptr<std::pmr::memory_resource>> segments;
+		};
+
+		// Parse the segments between the split points on multiple threads, then concatenate them.
+		// Returns nothing if a segment is invalid, the whole chunk must then be parsed sequentially to report the errors.
+		std::optional<ParseBlockResults> parseBlockParallel(std::string_view view, const ParseOptions& options)
+		{
+			const auto nbThreads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+			auto points = findSplitPoints(view, view.size() / (nbThreads * 4)); // More segments than threads, to balance the load
+			if (points.empty())
+				return {};
+			points.insert(points.begin(), 0);
+			points.push_back(view.size());
+
+			struct Segment
+			{
+				std::optional<ParseBlockResults> res;
+				bool parsed = false;
+				std::exception_ptr exception;
+			};
+			std::vector<Segment> segments(points.size() - 1);
+			std::atomic<size_t> next = 0, elements = 0;
+			const auto worker = [&] {
+				for (auto index = next++; index < segments.size(); index = next++)
+				{
+					auto& segment = segments[index];
+					try
+					{
+						auto& res = segment.res.emplace(view);
+						std::optional<ast::ScopedResource> scopedResource;
+						if (options.useArena)
+						{
+							const auto size = points[index + 1] - points[index];
+							res.arena = std::make_shared<ast::Arena>(std::max<size_t>(size * 8, 4096));
+							scopedResource.emplace(res.arena.get());
+							res.block = ast::Block{};
+						}
+
+						auto f = view.begin() + points[index];
+						const auto l = view.begin() + points[index + 1];
+						segment.parsed = parseRange(view, f, l, res, options, elements) && f == l && res.errors.empty();
+					}
+					catch (...)
+					{
+						segment.exception = std::current_exception();
+					}
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (size_t i = 1, nb = std::min<size_t>(nbThreads, segments.size()); i < nb; ++i)
+				threads.emplace_back(worker);
+			worker();
+			for (auto& thread : threads)
+				thread.join();
+
+			for (size_t i = 0, nb = segments.size(); i < nb; ++i)
+			{
+				const auto& segment = segments[i];
+				if (segment.exception)
+					std::rethrow_exception(segment.exception);
+				if (segment.res->aborted != AbortReason::none)
+				{
+					std::optional<ParseBlockResults> res;
+					res.emplace(view).aborted = segment.res->aborted;
+					return res;
+				}
+				if (!segment.parsed || (i + 1 < nb && segment.res->block.returnStatement))
+					return {};
+			}
+
+			// The positions are relative to the whole view, and the literal strings view it: the nodes are only moved
+			std::optional<ParseBlockResults> res;
+			res.emplace(view);
+			std::optional<ast::ScopedResource> scopedResource;
+			if (options.useArena)
+			{
+				auto arena = std::make_shared<ArenaGroup>(segments.size() * sizeof(ast::Statement) * 64);
+				for (const auto& segment : segments)
+					arena->segments.push_back(segment.res->arena);
+				res->arena = arena;
+				scopedResource.emplace(arena.get());
+				res->block = ast::Block{};
+			}
+
+			auto& block = res->block;
+			auto& statements = block.statements;
+			for (auto& segment : segments)
+			{
+				auto& segmentBlock = segment.res->block;
+				statements.insert(statements.end(),
+								  std::make_move_iterator(segmentBlock.statements.begin()),
+								  std::make_move_iterator(segmentBlock.statements.end()));
+				res->positions.appendElements(segment.res->positions);
+			}
+			block.returnStatement = std::move(segments.back().res->block.returnStatement);
+			block.begin = segments.front().res->block.begin;
+			block.end = segments.back().res->block.end;
+			res->parsed = true;
+			res->lastParsedPosition = view.size();
+			return res;
+		}
+
+		// The lazy function bodies containing a position. The ones inside them are not lazy, as they are parsed together.
+		class FindLazyBodies : public ast::Visitor<FindLazyBodies>
+		{
+		public:
+			FindLazyBodies(size_t position)
+				: m_position(position)
+			{
+			}
+
+			using Visitor::operator();
+
+			bool operator()(const ast::FunctionBody& fb) const
+			{
+				if (!fb.lazy)
+					return Visitor::operator()(fb);
+				if (fb.block.begin <= m_position && m_position <= fb.block.end + 1)
+					bodies.push_back(&fb);
+				return true;
+			}
+
+			mutable std::vector<const ast::FunctionBody*> bodies;
+
+		private:
+			size_t m_position;
+		};
+	} // namespace
+
 	ParseBlockResults parseBlock(std::string_view view, bool registerPositions)
 	{
+		ParseOptions options;
+		options.registerPositions = registerPositions;
+		return parseBlock(view, options);
+	}
+
+	ParseBlockResults parseBlock(std::string_view view, const ParseOptions& options)
+	{
+		if (options.threads != 1 && view.size() >= options.parallelMinSize)
+		{
+			if (auto res = parseBlockParallel(view, options))
+			{
+				if (options.hashBlocks)
+					ast::hashBlocks(res->block);
+				return std::move(*res);
+			}
+		}
+
 		ParseBlockResults res{view};
 		if (view.empty())
 			return res;
 
+		std::optional<ast::ScopedResource> scopedResource;
+		if (options.useArena)
+		{
+			res.arena = std::make_shared<ast::Arena>(std::max<size_t>(view.size() * 8, 4096));
+			scopedResource.emplace(res.arena.get());
+			res.block = ast::Block{}; // Also allocate the list of statements in the arena
+		}
+
 		auto f = view.begin();
 		const auto l = view.end();
-		if (registerPositions)
+		std::atomic<size_t> elements = 0;
+		res.parsed = parseRange(view, f, l, res, options, elements) && f == l && res.errors.empty();
+		res.lastParsedPosition = res.errors.empty() ? f - view.begin() : res.errors.front().begin;
+		if (options.hashBlocks)
+			ast::hashBlocks(res.block);
+		return res;
+	}
+
+	bool reparseBlock(ast::Block& block, pos::Positions<std::string_view::const_iterator>& positions,
+					  std::string_view previousView, std::string_view view, const ParseOptions& options)
+	{
+		auto& statements = block.statements;
+		if (previousView.empty() || view.empty() || statements.empty())
+			return false;
+
+		// Find the modified range using the common prefix and suffix of both texts
+		const auto minSize = std::min(previousView.size(), view.size());
+		const auto prefix = static_cast<size_t>(std::mismatch(previousView.begin(), previousView.begin() + minSize, view.begin()).first - previousView.begin());
+		const auto suffix = static_cast<size_t>(std::mismatch(previousView.rbegin(), previousView.rbegin() + (minSize - prefix), view.rbegin()).first - previousView.rbegin());
+		const auto offset = static_cast<std::ptrdiff_t>(view.size()) - static_cast<std::ptrdiff_t>(previousView.size());
+		const auto distance = view.data() - previousView.data(); // The kept literal strings view the previous buffer
+		if (prefix == previousView.size() && !offset)
+		{
+			if (distance)
+			{
+				for (auto& statement : statements)
+					pos::rebaseLiterals(statement, distance);
+				if (block.returnStatement)
+					pos::rebaseLiterals(*block.returnStatement, distance);
+			}
+			positions.setRange(view.begin(), view.end());
+			return true; // Nothing changed
+		}
+
+		// Parse again the statements touching the modification, and the one on each side as they may now be merged with it
+		const auto modifiedEnd = previousView.size() - suffix;
+		auto itFirst = std::lower_bound(statements.begin(), statements.end(), prefix, [](const ast::Statement& s, size_t pos) {
+			return s.end < pos;
+		});
+		if (itFirst != statements.begin())
+			--itFirst;
+		auto itLast = std::lower_bound(itFirst, statements.end(), modifiedEnd, [](const ast::Statement& s, size_t pos) {
+			return s.begin < pos;
+		});
+		if (itLast != statements.end())
+			++itLast; // First statement that is not parsed again
+
+		const bool toEnd = (itLast == statements.end());
+		const size_t regionBegin = (itFirst == statements.begin()) ? 0 : std::prev(itFirst)->end + 1;
+		const size_t previousRegionEnd = toEnd ? previousView.size() : itLast->begin;
+		const size_t regionEnd = previousRegionEnd + offset;
+
+		// The region must end between two tokens: a long comment or string opened by the edit and closed after the region
+		// would otherwise be cut, and parsed as a short comment followed by the statements it now contains
+		if (!toEnd)
+		{
+			for (auto token = nextToken(view, regionBegin); token.size && token.begin < regionEnd; token = nextToken(view, token.begin + token.size))
+			{
+				if (token.type == TokenType::invalid || token.begin + token.size > regionEnd)
+					return false;
+			}
+		}
+
+		// The new nodes are moved in the tree, they must live as long as its other nodes
+		ast::ScopedResource scopedResource{statements.get_allocator().resource()};
+		ParseBlockResults region{view};
+		auto f = view.begin() + regionBegin;
+		const auto l = view.begin() + regionEnd;
+		ParseOptions regionOptions = options;
+		regionOptions.registerPositions = true;
+		regionOptions.recoverErrors = false; // The caller does a complete parse instead
+		std::atomic<size_t> elements = 0;
+		if (!parseRange(view, f, l, region, regionOptions, elements) || f != l)
+			return false;
+
+		// A return statement can only be the last one of the block
+		if (!toEnd && region.block.returnStatement)
+			return false;
+
+		// Move the following statements
+		if (distance)
 		{
-			const auto parser = boost::spirit::x3::with<lac::pos::position_tag>(std::ref(res.positions))[chunkRule()];
-			const auto skipper = boost::spirit::x3::with<lac::pos::position_tag>(std::ref(res.positions))[skipperRule()];
-			res.parsed = boost::spirit::x3::phrase_parse(f, l, parser, skipper, res.block) && f == l;
+			for (auto it = statements.begin(); it != itFirst; ++it)
+				pos::rebaseLiterals(*it, distance);
 		}
+		for (auto it = itLast; it != statements.end(); ++it)
+		{
+			pos::offsetPositions(*it, offset);
+			pos::rebaseLiterals(*it, distance + offset);
+		}
+
+		if (toEnd)
+			block.returnStatement = std::move(region.block.returnStatement);
+		else if (block.returnStatement)
+		{
+			pos::offsetPositions(*block.returnStatement, offset);
+			pos::rebaseLiterals(*block.returnStatement, distance + offset);
+		}
+
+		// Replace the modified statements
+		const auto insertIt = statements.erase(itFirst, itLast);
+		statements.insert(insertIt,
+						  std::make_move_iterator(region.block.statements.begin()),
+						  std::make_move_iterator(region.block.statements.end()));
+
+		if (!regionBegin)
+			block.begin = region.block.begin;
+		if (toEnd)
+			block.end = region.block.end;
 		else
+			block.end += offset;
+
+		positions.replaceElements(regionBegin, previousRegionEnd, offset, region.positions);
+		positions.setRange(view.begin(), view.end());
+
+		if (block.hash)
 		{
-			res.parsed = boost::spirit::x3::phrase_parse(f, l, chunkRule(), skipperRule(), res.block) && f == l;
+			block.hash = 0;
+			ast::hashBlocks(block);
 		}
+		return true;
+	}
+
+	ExpandResults expandFunctionBody(ast::FunctionBody& body, std::string_view view, pos::Positions<std::string_view::const_iterator>* positions,
+									 const ParseOptions& options)
+	{
+		if (!body.lazy)
+			return {};
 
-		res.lastParsedPosition = f - view.begin();
+		const auto begin = body.lazy->begin, end = body.lazy->end + 1;
+		ast::ScopedResource scopedResource{body.block.statements.get_allocator().resource()};
+		ParseBlockResults res{view};
+		ParseOptions bodyOptions = options;
+		bodyOptions.registerPositions = (positions != nullptr);
+		bodyOptions.recoverErrors = true; // Reported as the errors of the body
+		auto f = view.begin() + begin;
+		const auto l = view.begin() + end;
+		std::atomic<size_t> elements = 0;
+		const auto parsed = parseRange(view, f, l, res, bodyOptions, elements) && f == l && res.errors.empty();
+		if (res.aborted != AbortReason::none)
+			return {{}, res.aborted};
+
+		body.block = std::move(res.block);
+		body.lazy.reset();
+		if (positions)
+			positions->replaceElements(begin, end, 0, res.positions);
+		if (!parsed && res.errors.empty())
+			res.errors.push_back({begin, end});
+		return {std::move(res.errors)};
+	}
+
+	ExpandResults expandFunctionBodies(ast::Block& block, std::string_view view, size_t position, pos::Positions<std::string_view::const_iterator>* positions,
+									   const ParseOptions& options)
+	{
+		ExpandResults res;
+		auto& errors = res.errors;
+		for (bool expanded = true; expanded && res.aborted == AbortReason::none;)
+		{
+			// The expanded blocks can contain lazy bodies too, containing the position
+			FindLazyBodies find{position};
+			find(block);
+			expanded = !find.bodies.empty();
+			for (const auto body : find.bodies)
+			{
+				const auto bodyRes = expandFunctionBody(const_cast<ast::FunctionBody&>(*body), view, positions, options); // Found in the modifiable block
+				errors.insert(errors.end(), bodyRes.errors.begin(), bodyRes.errors.end());
+				res.aborted = bodyRes.aborted;
+				if (res.aborted != AbortReason::none)
+					break;
+			}
+		}
+		std::sort(errors.begin(), errors.end(), [](const ParseError& lhs, const ParseError& rhs) { return lhs.begin < rhs.begin; });
 		return res;
 	}
 
@@ -48,4 +497,521 @@ namespace lac::parser
 		res.parsed = boost::spirit::x3::phrase_parse(f, l, variableOrFunctionRule(), skipperRule(), res.variable) && f == l;
 		return res;
 	}
+
+#ifdef WITH_TESTS
+	std::vector<std::pair<size_t, size_t>> getAllPositions(const ast::Block& block)
+	{
+		std::vector<std::pair<size_t, size_t>> list;
+		pos::visitPositions(block, [&list](const ast::PositionAnnotated& pa) {
+			list.emplace_back(pa.begin, pa.end);
+		});
+		return list;
+	}
+
+	void checkSameResults(const ParseBlockResults& res, const ParseBlockResults& expected)
+	{
+		CHECK(res.block.statements.size() == expected.block.statements.size());
+		CHECK(res.block.returnStatement.is_initialized() == expected.block.returnStatement.is_initialized());
+		CHECK(getAllPositions(res.block) == getAllPositions(expected.block));
+
+		const auto& elements = res.positions.elements();
+		const auto& expectedElements = expected.positions.elements();
+		REQUIRE(elements.size() == expectedElements.size());
+		for (size_t i = 0, nb = elements.size(); i < nb; ++i)
+		{
+			CHECK(elements[i].type == expectedElements[i].type);
+			CHECK(elements[i].begin == expectedElements[i].begin);
+			CHECK(elements[i].end == expectedElements[i].end);
+		}
+
+#ifdef WITH_NLOHMANN_JSON
+		CHECK(toJson(res.block) == toJson(expected.block));
+#endif
+	}
+
+	void test_reparse(std::string_view previous, std::string_view current)
+	{
+		ParseOptions options;
+		options.hashBlocks = true;
+		auto res = parseBlock(previous, options);
+		REQUIRE(res.parsed);
+		const auto full = parseBlock(current, options);
+		REQUIRE(full.parsed);
+		REQUIRE(reparseBlock(res.block, res.positions, previous, current));
+		checkSameResults(res, full);
+		CHECK(res.block.hash == full.block.hash);
+
+		// The literal strings view the new source
+		const auto checkLiteral = [current](const ast::LiteralString& ls) {
+			CHECK(ls.source.data() >= current.data());
+			CHECK(ls.source.data() + ls.source.size() <= current.data() + current.size());
+		};
+		for (const auto& statement : res.block.statements)
+			pos::visitLiterals(statement, checkLiteral);
+		if (res.block.returnStatement)
+			pos::visitLiterals(*res.block.returnStatement, checkLiteral);
+	}
+
+	TEST_CASE("reparse block")
+	{
+		const std::string program = R"~~(-- header
+local x = 42
+function test(a, b)
+	if a < b then
+		return a
+	end
+	return b
+end
+
+t = {1, 2, 'three'}
+print(test(x, t[1]))
+return t
+)~~";
+
+		auto modify = [&program](const std::string& from, const std::string& to) {
+			auto str = program;
+			str.replace(str.find(from), from.size(), to);
+			return str;
+		};
+
+		test_reparse(program, program);
+		test_reparse(program, modify("42", "4200"));                          // Inside the first statement
+		test_reparse(program, modify("return a", "return a + b"));           // Inside a function
+		test_reparse(program, modify("'three'", "'three', 4"));               // Inside a table constructor
+		test_reparse(program, modify("print", "x = 1\nprint"));              // New statement
+		test_reparse(program, modify("t = {1, 2, 'three'}\n", ""));          // Removed statement
+		test_reparse(program, modify("return t", "return t, x"));             // Return statement
+		test_reparse(program, modify("-- header", "-- [[ long header ]]"));   // Comment before the first statement
+		test_reparse(program, modify("local x = 42", "local x = 42 .. y"));   // Statement extended
+		test_reparse(program, modify("end\n\nt", "end\n\n-- comment\nt")); // Comment between statements
+
+		// Cannot be parsed
+		{
+			auto res = parseBlock(program);
+			REQUIRE(res.parsed);
+			const auto nbElements = res.positions.elements().size();
+			CHECK_FALSE(reparseBlock(res.block, res.positions, program, modify("local x = 42", "local x =")));
+			CHECK(res.positions.elements().size() == nbElements);
+			CHECK_FALSE(reparseBlock(res.block, res.positions, program, modify("local x = 42", "return x")));
+		}
+
+		// A long comment opened by the edit and closed after the modified statements
+		{
+			const std::string previous = "x = 1\ny = 2 z = 3 --]]\nw = 4\n";
+			auto res = parseBlock(previous);
+			REQUIRE(res.parsed);
+			CHECK_FALSE(reparseBlock(res.block, res.positions, previous, "x = 1\n--[[y = 2 z = 3 --]]\nw = 4\n"));
+			test_reparse(previous, "x = 1\n--[[y = 2]] z = 3 --]]\nw = 4\n"); // Closed inside them
+		}
+	}
+
+	TEST_CASE("error recovery")
+	{
+		auto getErrors = [](const ParseBlockResults& res) {
+			std::vector<std::pair<size_t, size_t>> errors;
+			for (const auto& e : res.errors)
+				errors.emplace_back(e.begin, e.end);
+			return errors;
+		};
+		using Errors = std::vector<std::pair<size_t, size_t>>;
+
+		// Valid programs
+		for (const auto program : {"local x = 1", "function f() return end", "if x then y() elseif z then else end", "return"})
+		{
+			const auto res = parseBlock(program);
+			CHECK(res.parsed);
+			CHECK(res.errors.empty());
+		}
+
+		// Invalid statement between valid ones
+		{
+			const auto res = parseBlock("local x = 1\nfir\nlocal y = 2");
+			CHECK_FALSE(res.parsed);
+			CHECK(getErrors(res) == Errors{{12, 15}});
+			CHECK(res.lastParsedPosition == 12);
+			REQUIRE(res.block.statements.size() == 3);
+			CHECK(res.block.statements[1].get().type() == typeid(ast::EmptyStatement));
+			CHECK(res.block.statements[2].get().type() == typeid(ast::LocalAssignmentStatement));
+		}
+
+		// Stops at the next line
+		{
+			const auto res = parseBlock("x = = 1 +\ny = 2");
+			CHECK(getErrors(res) == Errors{{0, 9}});
+			CHECK(res.block.statements.size() == 2);
+		}
+
+		// Inside a function, keeping its end
+		{
+			const auto res = parseBlock("function test(a, b)\n\tx = a.\nend\nz = 1");
+			CHECK(getErrors(res) == Errors{{26, 27}});
+			REQUIRE(res.block.statements.size() == 2);
+			CHECK(res.block.statements[0].get().type() == typeid(ast::FunctionDeclarationStatement));
+			const auto& body = boost::get<ast::FunctionDeclarationStatement>(res.block.statements[0]).body;
+			CHECK(body.block.statements.size() == 2);
+		}
+
+		// Resynchronize on a statement keyword on the same line
+		{
+			const auto res = parseBlock("x = ) local y = 2");
+			CHECK(getErrors(res) == Errors{{0, 5}});
+			REQUIRE(res.block.statements.size() == 2);
+			CHECK(res.block.statements[1].get().type() == typeid(ast::LocalAssignmentStatement));
+		}
+
+		// Block keyword without a block
+		{
+			const auto res = parseBlock("x = 1 end y = 2");
+			CHECK(getErrors(res) == Errors{{6, 9}});
+			CHECK(res.block.statements.size() == 3);
+		}
+
+		// Unterminated string, up to the end
+		{
+			const auto res = parseBlock("x = 1\ny = 'abc\nz = 2");
+			CHECK(getErrors(res) == Errors{{6, 20}});
+			CHECK(res.block.statements.size() == 2);
+		}
+
+		// Missing end
+		{
+			const auto res = parseBlock("if x then\n\ty = 1\n");
+			CHECK_FALSE(res.parsed);
+			REQUIRE(res.errors.size() == 1);
+			CHECK(res.errors[0].begin == 0);
+		}
+
+		// Statements after the return statement
+		{
+			const auto res = parseBlock("return 1\nx = 2");
+			CHECK(getErrors(res) == Errors{{9, 14}});
+			CHECK(res.block.returnStatement.is_initialized());
+		}
+
+		// Without recovery
+		{
+			ParseOptions options;
+			options.recoverErrors = false;
+			const auto res = parseBlock("local x = 1\nfir\nlocal y = 2", options);
+			CHECK_FALSE(res.parsed);
+			CHECK(res.errors.empty());
+			CHECK(res.lastParsedPosition == 12);
+		}
+	}
+
+	TEST_CASE("arena")
+	{
+		const std::string program = R"~~(
+local t = {1, 2, x = 'three', [4] = function(a, ...) return -a + 2 * #t end}
+for i, v in pairs(t) do
+	print(i, v, t.x:upper(), (t)[1])
+end
+return t
+)~~";
+
+		ParseOptions options;
+		options.useArena = true;
+		const auto res = parseBlock(program, options);
+		REQUIRE(res.parsed);
+		REQUIRE(res.arena);
+		CHECK(res.block.statements.get_allocator().resource() == res.arena.get());
+		CHECK(ast::currentResource() == std::pmr::new_delete_resource());
+
+		const auto expected = parseBlock(program);
+		CHECK_FALSE(expected.arena);
+		CHECK(expected.block.statements.get_allocator().resource() == std::pmr::new_delete_resource());
+		checkSameResults(res, expected);
+
+		// Copies are allocated in the current resource, moves keep the arena
+		auto copy = res.block;
+		CHECK(copy.statements.get_allocator().resource() == std::pmr::new_delete_resource());
+		ast::Block moved;
+		moved = std::move(copy);
+		CHECK(moved.statements.get_allocator().resource() == std::pmr::new_delete_resource());
+		auto results = res;
+		moved = std::move(results.block);
+		CHECK(moved.statements.get_allocator().resource() == std::pmr::new_delete_resource());
+		results = parseBlock(program, options);
+		{
+			const auto block = std::move(results.block); // Destroyed before the arena
+			CHECK(block.statements.get_allocator().resource() == results.arena.get());
+		}
+
+		// Replacing the results destroys their block before their arena, which asserts it in debug builds
+		results = parseBlock(program, options);
+		results = parseBlock(program, options);
+		CHECK(results.block.statements.get_allocator().resource() == results.arena.get());
+		checkSameResults(results, expected);
+	}
+
+	TEST_CASE("parallel parse")
+	{
+		std::string big;
+		for (int i = 0; i < 50; ++i)
+			big += "local function f" + std::to_string(i) + "(a)\n\tif a then return {a, 'x', [[y]]} end\nend\n"
+				   "-- comment\nfor i = 1, 3 do f(i) end\nwhile x do repeat x = x - 1 until x < 0 end\nt = {function() end}\n";
+
+		const std::vector<std::string> corpus = {
+			big,
+			big + "return f1(2)",
+			"local x = 42\nfunction test(a, b)\n\tif a < b then\n\t\treturn a\n\tend\n\treturn b\nend\n\nt = {1, 2, 'three'}\nprint(test(x, t[1]))\nreturn t\n",
+			"local t = {1, 2, x = 'three', [4] = function(a, ...) return -a + 2 * #t end}\nfor i, v in pairs(t) do\n\tprint(i, v, t.x:upper(), (t)[1])\nend\nreturn t\n",
+			"local t = {f = function(a) return a:b(c[d]) end}; t.f(t)[1].x = (t)\nlocal function g() end",
+			"-- only a comment\nlocal x = 1 local y = 2 if x then y() elseif z then else end",
+			"f = function() end\nfunction g() end\nlocal function h() end\nfunction a.b:c() end",
+			"local x = 1\nfir\nlocal y = 2",
+			"local x = 1\nreturn x\nlocal y = 2",
+			"x = 1\ny = 'abc\nlocal z = 2",
+			"if x then\n\ty = 1\nlocal z = 2",
+			"local x = 1 end local y = 2",
+			"",
+		};
+
+		ParseOptions parallel;
+		parallel.threads = 4;
+		parallel.parallelMinSize = 0;
+		CHECK(findSplitPoints(big, 0).size() == 3 * 50 - 1);
+		CHECK(findSplitPoints("local x = function() local y = 1 end; if x then for i = 1, 2 do end end", 0) == std::vector<size_t>{38});
+
+		for (const auto& program : corpus)
+		{
+			const auto expected = parseBlock(program);
+			const auto res = parseBlock(program, parallel);
+			CHECK(res.parsed == expected.parsed);
+			CHECK(res.lastParsedPosition == expected.lastParsedPosition);
+			CHECK(res.errors.size() == expected.errors.size());
+			checkSameResults(res, expected);
+
+			ParseOptions arena = parallel;
+			arena.useArena = true;
+			const auto resArena = parseBlock(program, arena);
+			checkSameResults(resArena, expected);
+		}
+	}
+
+	TEST_CASE("parse limits")
+	{
+		const std::string program = "local t = {{{{1, 2}}}}\nfor i = 1, 3 do if i then print((((i)))) end end\nx = 1\ny = 2\n";
+		CHECK(parseBlock(program).aborted == AbortReason::none);
+
+		ParseOptions options;
+		options.limits.maxDepth = 6; // Chunk, table levels or blocks
+		auto res = parseBlock(program, options);
+		CHECK(res.parsed);
+		CHECK(res.aborted == AbortReason::none);
+
+		options.limits.maxDepth = 4;
+		res = parseBlock(program, options);
+		CHECK_FALSE(res.parsed);
+		CHECK(res.aborted == AbortReason::depth);
+
+		options.limits.maxDepth = 0;
+		options.limits.maxElements = 4;
+		res = parseBlock(program, options);
+		CHECK_FALSE(res.parsed);
+		CHECK(res.aborted == AbortReason::elements);
+
+		options.limits.maxElements = 0;
+		std::atomic<bool> cancel = true;
+		options.limits.cancel = &cancel;
+		res = parseBlock(program, options);
+		CHECK_FALSE(res.parsed);
+		CHECK(res.aborted == AbortReason::cancelled);
+		CHECK(res.errors.empty()); // Not reported as syntax errors
+
+		options.limits.cancel = nullptr;
+		options.limits.deadline = std::chrono::steady_clock::now();
+		std::string big;
+		for (int i = 0; i < 1000; ++i)
+			big += "x = {1, 2, 3}\n";
+		res = parseBlock(big, options);
+		CHECK_FALSE(res.parsed);
+		CHECK(res.aborted == AbortReason::deadline);
+		CHECK(res.lastParsedPosition < big.size());
+
+		// Also stopped inside a single huge expression
+		std::string expression = "x = 1";
+		for (int i = 0; i < 100000; ++i)
+			expression += " + a.b(c)[d]";
+		res = parseBlock(expression, options);
+		CHECK_FALSE(res.parsed);
+		CHECK(res.aborted == AbortReason::deadline);
+
+		// The segments of a parallel parse share the limits
+		options.limits.deadline.reset();
+		options.limits.maxElements = 3000;
+		options.threads = 4;
+		options.parallelMinSize = 0;
+		res = parseBlock(big, options);
+		CHECK(res.aborted == AbortReason::elements);
+		options.limits.maxElements = 10000;
+		res = parseBlock(big, options);
+		CHECK(res.parsed);
+	}
+
+	TEST_CASE("lazy function bodies")
+	{
+		const std::string program = R"~~(local function f(a, b)
+	if a then return function() return 'end' end end -- end
+	return b
+end
+t = {g = function(...) x = 1 end}
+function t:h() end
+local y = f(1, 2)
+)~~";
+		ParseOptions options;
+		options.lazyFunctionBodies = true;
+		auto res = parseBlock(program, options);
+		REQUIRE(res.parsed);
+		const auto expected = parseBlock(program);
+		CHECK(res.positions.nbElements() < expected.positions.nbElements());
+
+		std::vector<ast::FunctionBody*> bodies;
+		auto& statements = res.block.statements;
+		REQUIRE(statements.size() == 4);
+		bodies.push_back(&boost::get<ast::LocalFunctionDeclarationStatement>(statements[0]).body);
+		auto& field = boost::get<ast::TableConstructor>(boost::get<ast::AssignmentStatement>(statements[1]).expressions.front().operand.get()).fields->front();
+		bodies.push_back(&boost::get<ast::f_FunctionBody>(boost::get<ast::FieldByAssignment>(field).value.operand.get()).get());
+		bodies.push_back(&boost::get<ast::FunctionDeclarationStatement>(statements[2]).body);
+		for (const auto body : bodies)
+		{
+			REQUIRE(body->lazy);
+			CHECK(body->block.statements.empty());
+		}
+		CHECK(bodies[0]->parameters->parameters.size() == 2);
+		CHECK(bodies[1]->parameters->varargs);
+		CHECK(program.substr(bodies[0]->lazy->begin, 5) == "\n\tif ");
+		CHECK(program.substr(bodies[1]->lazy->begin, bodies[1]->lazy->end + 1 - bodies[1]->lazy->begin) == " x = 1 ");
+		CHECK(program.substr(bodies[2]->lazy->begin, bodies[2]->lazy->end + 1 - bodies[2]->lazy->begin) == " ");
+
+		// Once expanded, the tree and the positions are the same as with a complete parse
+		for (const auto body : bodies)
+		{
+			CHECK(expandFunctionBody(*body, program, &res.positions).errors.empty());
+			CHECK_FALSE(body->lazy);
+		}
+		CHECK(expandFunctionBody(*bodies[0], program, &res.positions).errors.empty()); // Nothing to do
+		checkSameResults(res, expected);
+		CHECK(boost::get<ast::LocalFunctionDeclarationStatement>(statements[0]).body.block.statements.size() == 1);
+
+		// The errors are only found when expanding
+		const std::string invalid = "function f() x = = 1 end y = 2";
+		res = parseBlock(invalid, options);
+		CHECK(res.parsed);
+		const auto errors = expandFunctionBody(boost::get<ast::FunctionDeclarationStatement>(res.block.statements.front()).body, invalid).errors;
+		REQUIRE(errors.size() == 1);
+		CHECK(errors.front().begin == 13);
+		CHECK_FALSE(parseBlock("function f() x = 1", options).parsed);
+
+		// Only the bodies containing a position, including the one just after the block
+		res = parseBlock(program, options);
+		const auto& g = boost::get<ast::f_FunctionBody>(boost::get<ast::FieldByAssignment>(boost::get<ast::TableConstructor>(boost::get<ast::AssignmentStatement>(res.block.statements[1]).expressions.front().operand.get()).fields->front()).value.operand.get()).get();
+		CHECK(expandFunctionBodies(res.block, program, program.find("x = 1"), &res.positions).errors.empty());
+		CHECK_FALSE(g.lazy);
+		CHECK(boost::get<ast::LocalFunctionDeclarationStatement>(res.block.statements[0]).body.lazy);
+		CHECK(expandFunctionBodies(res.block, program, program.find("\nend") + 1, &res.positions).errors.empty());
+		CHECK_FALSE(boost::get<ast::LocalFunctionDeclarationStatement>(res.block.statements[0]).body.lazy);
+		CHECK(boost::get<ast::FunctionDeclarationStatement>(res.block.statements[2]).body.lazy);
+		CHECK(expandFunctionBodies(res.block, program, program.find("local y"), &res.positions).errors.empty()); // Nothing to expand
+		CHECK(boost::get<ast::FunctionDeclarationStatement>(res.block.statements[2]).body.lazy);
+		CHECK(expandFunctionBodies(res.block, program, program.find("h() end") + 3, &res.positions).errors.empty());
+		CHECK_FALSE(boost::get<ast::FunctionDeclarationStatement>(res.block.statements[2]).body.lazy);
+		checkSameResults(res, expected);
+
+		res = parseBlock(invalid, options);
+		CHECK(expandFunctionBodies(res.block, invalid, invalid.find("= =")).errors.size() == 1);
+
+		// With the options of the parse, the nested bodies stay lazy unless they contain the position
+		res = parseBlock(program, options);
+		auto& f = boost::get<ast::LocalFunctionDeclarationStatement>(res.block.statements[0]).body;
+		CHECK(expandFunctionBodies(res.block, program, program.find("return b"), &res.positions, options).errors.empty());
+		CHECK_FALSE(f.lazy);
+		const auto& ifStatement = boost::get<ast::IfThenElseStatement>(f.block.statements.front());
+		const auto& inner = boost::get<ast::f_FunctionBody>(ifStatement.first.block.returnStatement->expressions.front().operand.get()).get();
+		CHECK(inner.lazy);
+		CHECK(expandFunctionBodies(res.block, program, program.find("return 'end'"), &res.positions, options).errors.empty());
+		CHECK_FALSE(inner.lazy);
+
+		// The modified statements are parsed with the same options, in the arena of the tree
+		options.useArena = true;
+		res = parseBlock(program, options);
+		std::string modified = program;
+		modified.replace(modified.find("x = 1"), 5, "x = 2");
+		REQUIRE(reparseBlock(res.block, res.positions, program, modified, options));
+		const auto arena = res.arena.get();
+		auto& table = boost::get<ast::TableConstructor>(boost::get<ast::AssignmentStatement>(res.block.statements[1]).expressions.front().operand.get());
+		auto& reparsed = boost::get<ast::f_FunctionBody>(boost::get<ast::FieldByAssignment>(table.fields->front()).value.operand.get()).get();
+		CHECK(reparsed.lazy);
+		CHECK(table.fields->get_allocator().resource() == arena);
+		CHECK(expandFunctionBody(reparsed, modified, &res.positions, options).errors.empty());
+		REQUIRE(reparsed.block.statements.size() == 1);
+		CHECK(reparsed.block.statements.get_allocator().resource() == arena);
+
+		// Not expanded once a limit is reached
+		res = parseBlock(program, options);
+		std::atomic<bool> cancel = true;
+		options.limits.cancel = &cancel;
+		const auto cancelled = expandFunctionBodies(res.block, program, program.find("return b"), &res.positions, options);
+		CHECK(cancelled.aborted == AbortReason::cancelled);
+		CHECK(cancelled.errors.empty());
+		CHECK(boost::get<ast::LocalFunctionDeclarationStatement>(res.block.statements[0]).body.lazy);
+	}
+
+	std::string repeat(std::string_view str, size_t n)
+	{
+		std::string result;
+		for (size_t i = 0; i < n; ++i)
+			result += str;
+		return result;
+	}
+
+	TEST_CASE("pathological inputs")
+	{
+		// Inputs of size proportional to n, nested or chained n times
+		const std::vector<std::pair<std::string_view, std::function<std::string(size_t)>>> generators = {
+			{"brackets", [](size_t n) { return "x = " + repeat("(", n) + "x" + repeat(")", n); }},
+			{"brackets statement", [](size_t n) { return repeat("(", n) + "x" + repeat(")", n) + ".y = 1"; }},
+			{"tables", [](size_t n) { return "x = " + repeat("{", n) + repeat("}", n); }},
+			{"unary operators", [](size_t n) { return "x = " + repeat("- ", n) + "1"; }},
+			{"binary operators", [](size_t n) { return "x = 1" + repeat(" + 1", n); }},
+			{"nested indices", [](size_t n) { return "x = " + repeat("a[", n) + "1" + repeat("]", n); }},
+			{"nested calls", [](size_t n) { return repeat("f(", n) + "1" + repeat(")", n); }},
+			{"call chain", [](size_t n) { return "a" + repeat(".b(c)[d]", n) + ".e = 1"; }},
+			{"nested functions", [](size_t n) { return "x = " + repeat("function() return ", n) + "1" + repeat(" end", n); }},
+			{"nested callbacks", [](size_t n) { return repeat("f(function() ", n) + "g()" + repeat(" end)", n); }},
+			{"nested blocks", [](size_t n) { return repeat("do if x then ", n) + "g()" + repeat(" end end", n); }},
+		};
+
+		const auto measure = [](const std::string& program, size_t& allocated) {
+			helper::CountingResource resource; // Including the copies made while parsing
+			ast::ScopedResource scopedResource(&resource);
+			auto best = std::chrono::steady_clock::duration::max();
+			for (int i = 0; i < 3; ++i) // Keep the fastest run, the less disturbed
+			{
+				resource.allocated = 0;
+				const auto start = std::chrono::steady_clock::now();
+				ParseOptions options;
+				options.limits.deadline = start + std::chrono::seconds(5); // Fail instead of hanging on an exponential growth
+				const auto res = parseBlock(program, options);
+				CHECK(res.parsed);
+				CHECK(res.aborted == AbortReason::none);
+				best = std::min(best, std::chrono::steady_clock::now() - start);
+				allocated = resource.allocated;
+			}
+			return std::chrono::duration<double>(best).count();
+		};
+
+		// Growing the input 8 times must not cost more than a constant factor above 8 (a quadratic growth would be 64)
+		const size_t small = 64, large = 512;
+		for (const auto& [name, generator] : generators)
+		{
+			INFO(name);
+			size_t smallAllocated = 0, largeAllocated = 0;
+			const auto smallDuration = measure(generator(small), smallAllocated);
+			const auto largeDuration = measure(generator(large), largeAllocated);
+			CHECK(largeAllocated <= 16 * smallAllocated);
+			CHECK(largeDuration <= 32 * smallDuration + 0.001);
+		}
+	}
+#endif
 } // namespace lac::parser
@@ -1,23 +1,82 @@
 #pragma once
 
 #include <lac/parser/ast.h>
+#include <lac/parser/governor.h>
 #include <lac/parser/positions.h>
 #include <lac/core_api.h>
 
+#include <memory>
+#include <memory_resource>
+
 namespace lac::parser
 {
+	struct CORE_API ParseError
+	{
+		size_t begin = 0, end = 0; // End is exclusive
+	};
+	using ParseErrors = std::vector<ParseError>;
+
 	struct CORE_API ParseBlockResults
 	{
 		ParseBlockResults(std::string_view view);
+		ParseBlockResults(const ParseBlockResults&) = default;
+		ParseBlockResults(ParseBlockResults&&) = default;
+		ParseBlockResults& operator=(ParseBlockResults other); // The previous block is destroyed before its arena
 
-		bool parsed = false;
+		bool parsed = false; // False if there are errors, but the block can still contain the valid statements
+		std::shared_ptr<std::pmr::memory_resource> arena; // Owns the nodes of the block, if ParseOptions::useArena is set
 		ast::Block block;
 		pos::Positions<std::string_view::const_iterator> positions;
 		size_t lastParsedPosition = 0;
+		ParseErrors errors; // Sorted ranges skipped by the error recovery, replaced by empty statements
+		AbortReason aborted = AbortReason::none; // A limit of ParseOptions was reached, the block is then incomplete
 	};
 
-	// These skip comments and spaces
+	struct CORE_API ParseOptions
+	{
+		bool registerPositions = true;
+		bool recoverErrors = true; // Skip invalid statements until the next statement keyword or line
+		bool useArena = false; // Allocate the nodes in a monotonic arena, the results must be kept while the block (even moved) is used, see ast::Arena
+		unsigned threads = 1; // Parse on this many threads (0 for the number of cores) the chunks of at least parallelMinSize, split at the top-level statements
+		size_t parallelMinSize = 256 * 1024;
+		Limits limits; // Stop the parse early on pathological inputs
+		bool lazyFunctionBodies = false; // Only record the parameters of the functions and the range of their block, see expandFunctionBody
+		bool hashBlocks = false; // Set the structural hash of the blocks, see ast::hashBlocks
+	};
+
+	// These skip comments and spaces. The literal strings of the block view the source, which must outlive it.
 	CORE_API ParseBlockResults parseBlock(std::string_view view, bool registerPositions = true);
+	CORE_API ParseBlockResults parseBlock(std::string_view view, const ParseOptions& options);
+
+	// Update the result of a previous parse of previousView, by only parsing again the top-level statements modified in view.
+	// Returns false if the modified statements could not be parsed or a limit was reached, in which case block and positions are not modified.
+	// The options should be the ones of the previous parse, except that the errors are not recovered
+	// and the new nodes are allocated with the resource of the block (its arena if it has one).
+	// If the block was hashed, the hashes of the new statements and of the block are updated.
+	// The literal strings then view the new source, previousView can be released.
+	CORE_API bool reparseBlock(ast::Block& block, pos::Positions<std::string_view::const_iterator>& positions,
+							   std::string_view previousView, std::string_view view, const ParseOptions& options = {});
+
+	struct CORE_API ExpandResults
+	{
+		ParseErrors errors; // Sorted ranges skipped by the error recovery in the expanded blocks
+		AbortReason aborted = AbortReason::none; // A limit of the options was reached, the blocks not expanded yet stay lazy
+	};
+
+	// Parse the block of a function skipped by ParseOptions::lazyFunctionBodies, view being the source of the whole tree.
+	// Does nothing if the block is already parsed, or if a limit of the options is reached. Its elements are added to positions, if given.
+	// The nodes are allocated with the resource of the tree, as by reparseBlock, and the functions inside the block are lazy if set in the options.
+	// Returns the errors of the block (the whole block if it could not be parsed), the valid statements being kept as by parseBlock.
+	CORE_API ExpandResults expandFunctionBody(ast::FunctionBody& body, std::string_view view,
+											  pos::Positions<std::string_view::const_iterator>* positions = nullptr,
+											  const ParseOptions& options = {});
+
+	// Parse the blocks of the functions of the tree skipped by ParseOptions::lazyFunctionBodies and containing position,
+	// including the lazy ones found inside the expanded blocks.
+	// The range of a block includes the position just after it. Stops at the first block reaching a limit.
+	CORE_API ExpandResults expandFunctionBodies(ast::Block& block, std::string_view view, size_t position,
+												pos::Positions<std::string_view::const_iterator>* positions = nullptr,
+												const ParseOptions& options = {});
 
 	struct CORE_API ParseVariableResults
 	{
@@ -26,4 +85,13 @@ namespace lac::parser
 	};
 
 	CORE_API ParseVariableResults parseVariable(std::string_view view);
+
+	struct CORE_API ValidateResults
+	{
+		bool valid = false;
+		size_t lastParsedPosition = 0; // Start of the first statement that could not be parsed, even inside a block, same as ParseBlockResults
+	};
+
+	// Only check the syntax: the same grammar is used, but no tree is built
+	CORE_API ValidateResults validate(std::string_view view);
 } // namespace lac::parser
@@ -81,5 +81,134 @@ namespace lac
 		CHECK(var.begin == 0);
 		CHECK(var.end == 4);
 	}
+
+	TEST_CASE("Elements queries")
+	{
+		std::string_view text = "local x = 'str'\nif x then print(42) end";
+		pos::Positions positions{text.begin(), text.end()};
+		const auto parser = boost::spirit::x3::with<pos::position_tag>(std::ref(positions))[parser::chunkRule()];
+		auto f = text.begin();
+		ast::Block block;
+		REQUIRE(boost::spirit::x3::phrase_parse(f, text.end(), parser, boost::spirit::x3::ascii::space, block));
+
+		const auto elements = positions.elements();
+		REQUIRE(elements.size() == positions.nbElements());
+		CHECK(std::is_sorted(elements.begin(), elements.end(), [](const pos::Element& lhs, const pos::Element& rhs) {
+			return lhs.begin < rhs.begin;
+		}));
+
+		const auto range = positions.elementsInRange(16, 25); // if x then
+		REQUIRE(range.size() == 2);
+		CHECK(range[0].type == ast::ElementType::keyword);
+		CHECK(range[1].type == ast::ElementType::keyword);
+		CHECK(range[1].begin == 21);
+		CHECK(positions.elementsInRange(5, 6).empty());
+
+		const auto str = positions.elementAt(12);
+		REQUIRE(str);
+		CHECK(str->type == ast::ElementType::literal_string);
+		CHECK(str->begin == 10);
+		CHECK(str->end == 15);
+		CHECK_FALSE(positions.elementAt(8));
+		CHECK(positions.elementAt(33)->type == ast::ElementType::numeral); // Inside the end of the function call
+		CHECK(positions.elementAt(34)->type == ast::ElementType::function);
+
+		const auto previous = positions.elementBefore(9);
+		REQUIRE(previous);
+		CHECK(previous->begin == 0);
+
+		const auto keyword = positions.nextOfType(1, ast::ElementType::keyword);
+		REQUIRE(keyword);
+		CHECK(keyword->begin == 16);
+		const auto numeral = positions.nextOfType(0, ast::ElementType::numeral);
+		REQUIRE(numeral);
+		CHECK(numeral->begin == 32);
+		CHECK_FALSE(positions.nextOfType(37, ast::ElementType::variable));
+
+		// Added out of order, or replaced
+		pos::Element elt{ast::ElementType::variable};
+		elt.begin = 6;
+		elt.end = 7;
+		positions.addElement(elt);
+		CHECK(positions.nbElements() == elements.size() + 1);
+		CHECK(positions.element(1).begin == 6);
+		CHECK(positions.nextOfType(0, ast::ElementType::variable)->begin == 6);
+		elt.type = ast::ElementType::member_variable;
+		positions.addElement(elt);
+		CHECK(positions.nbElements() == elements.size() + 1);
+		CHECK(positions.elementAt(6)->type == ast::ElementType::member_variable);
+		CHECK(positions.nextOfType(0, ast::ElementType::variable)->begin == 26);
+	}
+
+	TEST_CASE("Element at a position")
+	{
+		// The last element containing pos, by looking at all the elements
+		const auto bruteForce = [](const pos::Elements& elements, size_t pos) -> std::optional<pos::Element> {
+			for (auto it = elements.rbegin(); it != elements.rend(); ++it)
+			{
+				if (it->begin <= pos && it->end > pos)
+					return *it;
+			}
+			return {};
+		};
+
+		// Function calls enclosing several disjoint elements
+		std::string_view text = "x = f(g(1), t.y, 2) h(k(3), 4)";
+		pos::Positions positions{text.begin(), text.end()};
+		const auto parser = boost::spirit::x3::with<pos::position_tag>(std::ref(positions))[parser::chunkRule()];
+		auto f = text.begin();
+		ast::Block block;
+		REQUIRE(boost::spirit::x3::phrase_parse(f, text.end(), parser, boost::spirit::x3::ascii::space, block));
+
+		const auto call = positions.elementAt(18);
+		REQUIRE(call);
+		CHECK(call->begin == 5);
+		CHECK(call->end == 19);
+		REQUIRE(positions.elementAt(29));
+		CHECK(positions.elementAt(29)->begin == 21);
+
+		const auto elements = positions.elements();
+		for (size_t pos = 0; pos <= text.size(); ++pos)
+		{
+			const auto expected = bruteForce(elements, pos);
+			const auto element = positions.elementAt(pos);
+			REQUIRE(element.has_value() == expected.has_value());
+			if (expected)
+			{
+				CHECK(element->begin == expected->begin);
+				CHECK(element->end == expected->end);
+			}
+		}
+
+		// Nested and disjoint elements, added in any order
+		pos::Positions<std::string_view::iterator> nested;
+		for (size_t depth = 0; depth < 50; ++depth)
+		{
+			for (size_t child = 0; child < depth % 7; ++child)
+			{
+				pos::Element elt{ast::ElementType::numeral};
+				elt.begin = 1000 - depth * 10 + child * 3;
+				elt.end = elt.begin + 2;
+				nested.addElement(elt);
+			}
+			pos::Element elt{ast::ElementType::function};
+			elt.begin = 1000 - depth * 10;
+			elt.end = 1100 + depth * (depth % 3);
+			nested.addElement(elt);
+		}
+
+		const auto nestedElements = nested.elements();
+		for (size_t pos = 0; pos < 1300; ++pos)
+		{
+			const auto expected = bruteForce(nestedElements, pos);
+			const auto element = nested.elementAt(pos);
+			REQUIRE(element.has_value() == expected.has_value());
+			if (expected)
+			{
+				CHECK(element->begin == expected->begin);
+				CHECK(element->end == expected->end);
+			}
+		}
+	}
 #endif
 } // namespace lac
@@ -5,7 +5,11 @@
 
 #include <boost/spirit/home/x3/support/context.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <optional>
 #include <vector>
 
 namespace lac
@@ -21,6 +25,16 @@ namespace lac
 			{
 			};
 
+			template <typename Tag>
+			struct HasTag<x3::unused_type, Tag> : std::false_type
+			{
+			};
+
+			template <typename Tag>
+			struct HasTag<const x3::unused_type&, Tag> : std::false_type
+			{
+			};
+
 			template <typename ID, typename T, typename Next, typename Tag>
 			struct HasTag<x3::context<ID, T, Next>, Tag> : HasTag<Next, Tag>
 			{
@@ -115,26 +129,154 @@ namespace lac
 				addElement(elt);
 			}
 
+			// Insert the element at its place, or change the type of the element with the same range
 			void addElement(Element element)
 			{
-				for (auto& elt : helper::reverse{m_elements})
+				const auto begin = static_cast<uint32_t>(element.begin), end = static_cast<uint32_t>(element.end);
+				auto index = m_begins.size();
+				if (index && (m_begins.back() > begin || (m_begins.back() == begin && m_ends.back() >= end)))
 				{
-					if (elt.end < element.begin)
-						break; // We can stop the search
-
-					if (elt.begin == element.begin && elt.end == element.end)
+					// Mostly when backtracking, as the elements are added in the order of the source
+					index = lowerBound(begin, end);
+					if (index < m_begins.size() && m_begins[index] == begin && m_ends[index] == end)
 					{
-						elt = element;
+						m_types[index] = element.type;
+						clearIndices();
 						return;
 					}
 				}
 
-				m_elements.push_back(element);
+				m_begins.insert(m_begins.begin() + index, begin);
+				m_ends.insert(m_ends.begin() + index, end);
+				m_types.insert(m_types.begin() + index, element.type);
+				clearIndices();
+			}
+
+			size_t nbElements() const
+			{
+				return m_begins.size();
+			}
+
+			Element element(size_t index) const
+			{
+				Element elt;
+				elt.begin = m_begins[index];
+				elt.end = m_ends[index];
+				elt.type = m_types[index];
+				return elt;
+			}
+
+			// All the elements, sorted by position
+			Elements elements() const
+			{
+				return copyElements(0, m_begins.size());
+			}
+
+			// The elements starting in [begin, end)
+			Elements elementsInRange(size_t begin, size_t end) const
+			{
+				return copyElements(lowerBound(begin), lowerBound(end));
+			}
+
+			// The last element containing pos
+			std::optional<Element> elementAt(size_t pos) const
+			{
+				// Rightmost element starting at or before pos whose end is after pos, found in the tree of the maximum ends
+				const auto& tree = maxEndsTree();
+				const auto leaves = tree.size() / 2;
+				for (auto first = leaves, last = leaves + lowerBound(pos + 1); first < last; first /= 2, last /= 2)
+				{
+					if (last & 1 && tree[--last] > pos)
+					{
+						while (last < leaves)
+							last = tree[2 * last + 1] > pos ? 2 * last + 1 : 2 * last;
+						return element(last - leaves);
+					}
+				}
+				return {};
+			}
+
+			// The last element ending at or before pos
+			std::optional<Element> elementBefore(size_t pos) const
+			{
+				for (auto index = lowerBound(pos); index--;)
+				{
+					if (m_ends[index] <= pos)
+						return element(index);
+				}
+				return {};
+			}
+
+			// The first element of this type starting at or after pos
+			std::optional<Element> nextOfType(size_t pos, ast::ElementType type) const
+			{
+				const auto& indices = typeIndex(type);
+				const auto it = std::lower_bound(indices.begin(), indices.end(), pos, [this](uint32_t index, size_t pos) {
+					return m_begins[index] < pos;
+				});
+				if (it == indices.end())
+					return {};
+				return element(*it);
+			}
+
+			// Replace the elements starting in [begin, end) by the ones of other, and offset those starting after
+			void replaceElements(size_t begin, size_t end, std::ptrdiff_t offset, const Positions& other)
+			{
+				const auto first = lowerBound(begin), last = lowerBound(end);
+				const auto nbInserted = other.m_begins.size();
+				std::vector<uint32_t> begins, ends;
+				std::vector<ast::ElementType> types;
+				const auto size = m_begins.size() - (last - first) + nbInserted;
+				begins.reserve(size);
+				ends.reserve(size);
+				types.reserve(size);
+
+				auto append = [&](const Positions& from, size_t f, size_t l, std::ptrdiff_t offset) {
+					for (auto i = f; i < l; ++i)
+					{
+						begins.push_back(static_cast<uint32_t>(from.m_begins[i] + offset));
+						ends.push_back(static_cast<uint32_t>(from.m_ends[i] + offset));
+						types.push_back(from.m_types[i]);
+					}
+				};
+				append(*this, 0, first, 0);
+				append(other, 0, nbInserted, 0);
+				append(*this, last, m_begins.size(), offset);
+
+				m_begins = std::move(begins);
+				m_ends = std::move(ends);
+				m_types = std::move(types);
+				clearIndices();
+			}
+
+			// Add the elements of other, which all start after the ones of this object
+			void appendElements(const Positions& other)
+			{
+				m_begins.insert(m_begins.end(), other.m_begins.begin(), other.m_begins.end());
+				m_ends.insert(m_ends.end(), other.m_ends.begin(), other.m_ends.end());
+				m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+				clearIndices();
+			}
+
+			// The arrays of the elements, sorted by begin then end, to store them without copying each element
+			const std::vector<uint32_t>& begins() const { return m_begins; }
+			const std::vector<uint32_t>& ends() const { return m_ends; }
+			const std::vector<ast::ElementType>& types() const { return m_types; }
+
+			// Replace the elements by these arrays of the same size, sorted as the ones returned above
+			void assignElements(std::vector<uint32_t> begins, std::vector<uint32_t> ends, std::vector<ast::ElementType> types)
+			{
+				m_begins = std::move(begins);
+				m_ends = std::move(ends);
+				m_types = std::move(types);
+				clearIndices();
 			}
 
-			const Elements& elements() const
+			// Use a new input stream, keeping the elements
+			void setRange(Iterator begin, Iterator end)
 			{
-				return m_elements;
+				m_begin = begin;
+				m_end = end;
 			}
 
 			size_t pos(const Iterator it) const
@@ -143,8 +285,72 @@ namespace lac
 			}
 
 		private:
+			// First element starting at or after pos
+			size_t lowerBound(size_t pos) const
+			{
+				return std::lower_bound(m_begins.begin(), m_begins.end(), pos) - m_begins.begin();
+			}
+
+			// First element after or at (begin, end)
+			size_t lowerBound(uint32_t begin, uint32_t end) const
+			{
+				auto index = lowerBound(begin);
+				while (index < m_begins.size() && m_begins[index] == begin && m_ends[index] < end)
+					++index;
+				return index;
+			}
+
+			Elements copyElements(size_t first, size_t last) const
+			{
+				Elements elements;
+				elements.reserve(last - first);
+				for (auto i = first; i < last; ++i)
+					elements.push_back(element(i));
+				return elements;
+			}
+
+			// Sorted indices of the elements of this type, built on the first query
+			const std::vector<uint32_t>& typeIndex(ast::ElementType type) const
+			{
+				if (m_typeIndex.empty())
+				{
+					m_typeIndex.resize(static_cast<size_t>(ast::ElementType::member_function) + 1);
+					for (size_t i = 0, nb = m_types.size(); i < nb; ++i)
+						m_typeIndex[static_cast<size_t>(m_types[i])].push_back(static_cast<uint32_t>(i));
+				}
+				return m_typeIndex[static_cast<size_t>(type)];
+			}
+
+			// Binary tree of the maximum of the ends, with the leaves in the second half, built on the first query.
+			// There are more leaves than elements, so that no query covers the whole tree.
+			const std::vector<uint32_t>& maxEndsTree() const
+			{
+				if (m_maxEnds.empty() && !m_ends.empty())
+				{
+					size_t leaves = 1;
+					while (leaves <= m_ends.size())
+						leaves *= 2;
+					m_maxEnds.assign(2 * leaves, 0);
+					std::copy(m_ends.begin(), m_ends.end(), m_maxEnds.begin() + leaves);
+					for (auto node = leaves; --node;)
+						m_maxEnds[node] = std::max(m_maxEnds[2 * node], m_maxEnds[2 * node + 1]);
+				}
+				return m_maxEnds;
+			}
+
+			void clearIndices()
+			{
+				m_typeIndex.clear();
+				m_maxEnds.clear();
+			}
+
 			Iterator m_begin, m_end;
-			Elements m_elements;
+
+			// Elements sorted by begin then end, in separate arrays
+			std::vector<uint32_t> m_begins, m_ends;
+			std::vector<ast::ElementType> m_types;
+			mutable std::vector<std::vector<uint32_t>> m_typeIndex; // Cleared by any modification
+			mutable std::vector<uint32_t> m_maxEnds;                // Cleared by any modification
 		};
 
 		template <typename Context, typename Tag>
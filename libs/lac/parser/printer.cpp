@@ -1,19 +1,31 @@
 #include <lac/parser/printer.h>
+#include <lac/parser/visitor.h>
+
+namespace lac::ast
+{
+	void to_json(nlohmann::json& j, Atom atom)
+	{
+		j = atom.str();
+	}
+} // namespace lac::ast
 
 namespace lac
 {
 	using namespace ast;
 
-	class Printer : public boost::static_visitor<nlohmann::json>
+	class Printer : public Dispatcher<Printer, nlohmann::json>
 	{
 	public:
+		using Dispatcher::operator();
+
 		std::string getString(Operation op) const
 		{
 			static const std::vector<std::string> constants = {
 				"+", "-", "*", "/", "//", "%",
 				"^", "-", "&", "|", "~", "~",
 				"<<", ">>", "..", "#", "<",
-				"<=", ">", ">=", "==", "~="};
+				"<=", ">", ">=", "==", "~=",
+				"not", "and", "or"};
 
 			return constants[static_cast<int>(op)];
 		}
@@ -32,11 +44,11 @@ namespace lac
 		{
 			nlohmann::json j;
 			j["type"] = "LiteralString";
-			j["value"] = ls.value;
+			j["value"] = ls.value();
 			return j;
 		}
 
-		nlohmann::json operator()(int v) const
+		nlohmann::json operator()(int64_t v) const
 		{
 			nlohmann::json j;
 			j["type"] = "Numeral";
@@ -52,7 +64,7 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(std::string v) const
+		nlohmann::json operator()(Atom v) const
 		{
 			nlohmann::json j;
 			j["type"] = "Name";
@@ -73,16 +85,6 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const ast::Numeral& n) const
-		{
-			return boost::apply_visitor(Printer{}, n);
-		}
-
-		nlohmann::json operator()(const Operand& operand) const
-		{
-			return boost::apply_visitor(Printer{}, operand);
-		}
-
 		nlohmann::json operator()(const UnaryOperation& uo) const
 		{
 			nlohmann::json j;
@@ -97,7 +99,7 @@ namespace lac
 			nlohmann::json j;
 			j["type"] = "BinaryOperation";
 			j["operator"] = getString(bo.operation);
-			j["argument"] = (*this)(bo.expression);
+			j["argument"] = (*this)(bo.operand);
 			return j;
 		}
 
@@ -142,11 +144,6 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const Arguments& ar) const
-		{
-			return boost::apply_visitor(Printer{}, ar);
-		}
-
 		nlohmann::json operator()(const FunctionCallEnd& fce) const
 		{
 			nlohmann::json j;
@@ -166,16 +163,11 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const VariablePostfix& post) const
-		{
-			return boost::apply_visitor(Printer{}, post);
-		}
-
 		nlohmann::json operator()(const Variable& v) const
 		{
 			nlohmann::json j;
 			j["type"] = "Variable";
-			j["start"] = boost::apply_visitor(Printer{}, v.start);
+			j["start"] = (*this)(v.start);
 			if (!v.rest.empty())
 			{
 				auto& rest = j["rest"];
@@ -190,8 +182,12 @@ namespace lac
 			nlohmann::json j;
 			j["type"] = "Expression";
 			j["left"] = (*this)(ex.operand);
-			if (ex.binaryOperation)
-				j["right"] = (*this)(*ex.binaryOperation);
+			if (!ex.binaryOperations.empty())
+			{
+				auto& right = j["right"] = nlohmann::json::array();
+				for (const auto& bo : ex.binaryOperations)
+					right.push_back((*this)(bo));
+			}
 			return j;
 		}
 
@@ -213,11 +209,6 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const Field& field) const
-		{
-			return boost::apply_visitor(Printer{}, field);
-		}
-
 		nlohmann::json operator()(const FieldsList& list) const
 		{
 			nlohmann::json j;
@@ -240,16 +231,11 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const PostPrefix& post) const
-		{
-			return boost::apply_visitor(Printer{}, post);
-		}
-
 		nlohmann::json operator()(const PrefixExpression& pe) const
 		{
 			nlohmann::json j;
 			j["type"] = "PrefixExpression";
-			j["start"] = boost::apply_visitor(Printer{}, pe.start);
+			j["start"] = (*this)(pe.start);
 			if (!pe.rest.empty())
 			{
 				auto& rest = j["rest"];
@@ -279,7 +265,10 @@ namespace lac
 			j["type"] = "Function body";
 			if (fb.parameters)
 				j["parameters"] = (*this)(*fb.parameters);
-			j["body"] = (*this)(fb.block);
+			if (fb.lazy)
+				j["lazy"] = {fb.lazy->begin, fb.lazy->end};
+			else
+				j["body"] = (*this)(fb.block);
 			return j;
 		}
 
@@ -307,8 +296,12 @@ namespace lac
 		nlohmann::json operator()(const FunctionCallPostfix& fcp) const
 		{
 			nlohmann::json j;
-			if (fcp.tableIndex)
-				j["index"] = boost::apply_visitor(Printer{}, *fcp.tableIndex);
+			if (!fcp.tableIndex.empty())
+			{
+				auto& index = j["index"];
+				for (const auto& ti : fcp.tableIndex)
+					index.push_back((*this)(ti));
+			}
 			j["call"] = (*this)(fcp.functionCall);
 			return j;
 		}
@@ -317,7 +310,7 @@ namespace lac
 		{
 			nlohmann::json j;
 			j["type"] = "FunctionCall";
-			j["start"] = boost::apply_visitor(Printer{}, fc.start);
+			j["start"] = (*this)(fc.start);
 			if (!fc.rest.empty())
 			{
 				auto& rest = j["rest"];
@@ -475,11 +468,6 @@ namespace lac
 			return j;
 		}
 
-		nlohmann::json operator()(const Statement& s) const
-		{
-			return boost::apply_visitor(Printer{}, s);
-		}
-
 		nlohmann::json operator()(const ReturnStatement& s) const
 		{
 			nlohmann::json j;
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LAC_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAC_SCAN_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Scanning kernels used to quickly skip runs of characters.
+// The vectorized version is chosen at compile time (AVX2 if enabled, else SSE2), with a scalar fallback.
+namespace lac::scan
+{
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	inline bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline bool isNameFirstLetter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	inline bool isNameLetter(char c)
+	{
+		return isNameFirstLetter(c) || isDigit(c);
+	}
+
+	namespace scalar
+	{
+		inline const char* skipSpaces(const char* first, const char* last)
+		{
+			while (first != last && isSpace(*first))
+				++first;
+			return first;
+		}
+
+		inline const char* skipName(const char* first, const char* last)
+		{
+			while (first != last && isNameLetter(*first))
+				++first;
+			return first;
+		}
+
+		inline const char* findFirstOf(const char* first, const char* last, char a, char b)
+		{
+			while (first != last && *first != a && *first != b)
+				++first;
+			return first;
+		}
+
+		inline const char* findFirstOf(const char* first, const char* last, char a, char b, char c)
+		{
+			while (first != last && *first != a && *first != b && *first != c)
+				++first;
+			return first;
+		}
+	} // namespace scalar
+
+#if defined(LAC_SCAN_AVX2) || defined(LAC_SCAN_SSE2)
+#define LAC_SCAN_SIMD
+	namespace simd
+	{
+#ifdef LAC_SCAN_AVX2
+		using Vec = __m256i;
+		constexpr std::ptrdiff_t width = 32;
+		constexpr uint32_t fullMask = 0xFFFFFFFF;
+
+		inline Vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+		inline Vec splat(char c) { return _mm256_set1_epi8(c); }
+		inline Vec equal(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+		inline Vec greater(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+		inline Vec either(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+		inline Vec both(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+		inline uint32_t mask(Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#else
+		using Vec = __m128i;
+		constexpr std::ptrdiff_t width = 16;
+		constexpr uint32_t fullMask = 0xFFFF;
+
+		inline Vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		inline Vec splat(char c) { return _mm_set1_epi8(c); }
+		inline Vec equal(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+		inline Vec greater(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+		inline Vec either(Vec a, Vec b) { return _mm_or_si128(a, b); }
+		inline Vec both(Vec a, Vec b) { return _mm_and_si128(a, b); }
+		inline uint32_t mask(Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#endif
+
+		// Signed comparisons: non ASCII characters are never in the range
+		inline Vec inRange(Vec v, char low, char high)
+		{
+			return both(greater(v, splat(low - 1)), greater(splat(high + 1), v));
+		}
+
+		inline unsigned firstBit(uint32_t mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+		}
+
+		// Return the first position where the predicate returns a non-zero mask
+		template <class Predicate>
+		const char* findFirst(const char* first, const char* last, Predicate&& predicate)
+		{
+			while (last - first >= width)
+			{
+				const auto m = predicate(load(first));
+				if (m)
+					return first + firstBit(m);
+				first += width;
+			}
+			return nullptr;
+		}
+
+		inline const char* skipSpaces(const char* first, const char* last)
+		{
+			const auto it = findFirst(first, last, [](Vec v) {
+				return ~mask(either(equal(v, splat(' ')), inRange(v, '\t', '\r'))) & fullMask;
+			});
+			if (it)
+				return it;
+			return scalar::skipSpaces(last - (last - first) % width, last);
+		}
+
+		inline const char* skipName(const char* first, const char* last)
+		{
+			const auto it = findFirst(first, last, [](Vec v) {
+				const auto letters = either(inRange(v, 'a', 'z'), inRange(v, 'A', 'Z'));
+				const auto others = either(inRange(v, '0', '9'), equal(v, splat('_')));
+				return ~mask(either(letters, others)) & fullMask;
+			});
+			if (it)
+				return it;
+			return scalar::skipName(last - (last - first) % width, last);
+		}
+
+		inline const char* findFirstOf(const char* first, const char* last, char a, char b)
+		{
+			const auto va = splat(a), vb = splat(b);
+			const auto it = findFirst(first, last, [&](Vec v) {
+				return mask(either(equal(v, va), equal(v, vb)));
+			});
+			if (it)
+				return it;
+			return scalar::findFirstOf(last - (last - first) % width, last, a, b);
+		}
+
+		inline const char* findFirstOf(const char* first, const char* last, char a, char b, char c)
+		{
+			const auto va = splat(a), vb = splat(b), vc = splat(c);
+			const auto it = findFirst(first, last, [&](Vec v) {
+				return mask(either(either(equal(v, va), equal(v, vb)), equal(v, vc)));
+			});
+			if (it)
+				return it;
+			return scalar::findFirstOf(last - (last - first) % width, last, a, b, c);
+		}
+	} // namespace simd
+
+	using simd::findFirstOf;
+	using simd::skipName;
+	using simd::skipSpaces;
+#else
+	using scalar::findFirstOf;
+	using scalar::skipName;
+	using scalar::skipSpaces;
+#endif
+
+	// Return the position of the character, or last if not found
+	inline const char* find(const char* first, const char* last, char c)
+	{
+		const auto it = std::memchr(first, c, last - first);
+		return it ? static_cast<const char*>(it) : last;
+	}
+
+	// Return the level of the long bracket starting at first, or -1 if this is not a long bracket
+	inline int longBracketLevel(const char* first, const char* last)
+	{
+		if (first == last || *first != '[')
+			return -1;
+		const auto start = ++first;
+		while (first != last && *first == '=')
+			++first;
+		if (first == last || *first != '[')
+			return -1;
+		return static_cast<int>(first - start);
+	}
+
+	// first is on the opening bracket, return the position after the closing one or nullptr.
+	// Only the ']' are compared to the closing bracket.
+	inline const char* skipLongBracket(const char* first, const char* last, int level)
+	{
+		first += level + 2;
+		while (true)
+		{
+			first = find(first, last, ']');
+			if (first == last)
+				return nullptr;
+			auto end = first + 1;
+			while (end != last && *end == '=')
+				++end;
+			if (end != last && *end == ']' && end - first - 1 == level)
+				return end + 1;
+			first = end;
+		}
+	}
+
+	// Return the position after the long bracket starting at first, or nullptr
+	inline const char* skipLongString(const char* first, const char* last)
+	{
+		const auto level = longBracketLevel(first, last);
+		return level < 0 ? nullptr : skipLongBracket(first, last, level);
+	}
+
+	// Return the position after the quoted string starting at first, or nullptr.
+	// Only the quote can be escaped, as in the grammar: only the quote and backslashes are compared.
+	inline const char* skipQuotedString(const char* first, const char* last)
+	{
+		if (first == last || (*first != '"' && *first != '\''))
+			return nullptr;
+		const auto quote = *first++;
+		while (true)
+		{
+			first = findFirstOf(first, last, quote, '\\');
+			if (first == last)
+				return nullptr;
+			if (*first == quote)
+				return first + 1;
+			++first;
+			if (first != last && *first == quote)
+				++first;
+		}
+	}
+
+	// Return the position after the end of the line (\n, \r or \r\n), or last
+	inline const char* skipLine(const char* first, const char* last)
+	{
+		first = findFirstOf(first, last, '\n', '\r');
+		if (first == last)
+			return last;
+		if (*first == '\r' && first + 1 != last && first[1] == '\n')
+			return first + 2;
+		return first + 1;
+	}
+} // namespace lac::scan
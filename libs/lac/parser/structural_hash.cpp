@@ -0,0 +1,161 @@
+#include <lac/parser/structural_hash.h>
+#include <lac/parser/ast_adapted.h>
+#include <lac/parser/visitor.h>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/fusion/include/for_each.hpp>
+
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+
+#ifdef WITH_TESTS
+#include <lac/parser/parser.h>
+#include <doctest/doctest.h>
+#endif
+
+namespace lac::ast
+{
+	namespace
+	{
+		// Distinguishes the nodes with the same content, as an empty statement and a break
+		template <typename T>
+		size_t typeTag()
+		{
+			static const size_t tag = std::hash<std::string_view>{}(typeid(T).name());
+			return tag;
+		}
+	} // namespace
+
+	// The nodes adapted as fusion sequences hash their members, in order
+	class StructuralHash : public Dispatcher<StructuralHash, size_t>
+	{
+	public:
+		using Dispatcher::operator();
+
+		size_t operator()(const Block& b) const
+		{
+			if (!b.hash)
+				b.hash = std::max<size_t>(members(b), 1); // 0 is kept for the blocks not hashed
+			return b.hash;
+		}
+
+		size_t operator()(const FunctionBody& fb) const
+		{
+			auto seed = members(fb);
+			boost::hash_combine(seed, fb.lazy.is_initialized()); // The block of a lazy body is empty
+			return seed;
+		}
+
+		size_t operator()(Atom atom) const
+		{
+			return std::hash<std::string_view>{}(atom.str()); // The ids depend on the order the names are met
+		}
+
+		size_t operator()(const LiteralString& ls) const
+		{
+			auto seed = typeTag<LiteralString>();
+			boost::hash_combine(seed, std::hash<std::string_view>{}(ls.source));
+			return seed;
+		}
+
+		size_t operator()(const EmptyArguments&) const { return typeTag<EmptyArguments>(); }
+		size_t operator()(const EmptyStatement&) const { return typeTag<EmptyStatement>(); }
+		size_t operator()(const BreakStatement&) const { return typeTag<BreakStatement>(); }
+
+		// Operations, constants, numerals and flags
+		template <typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+		size_t operator()(T value) const
+		{
+			auto seed = typeTag<T>();
+			boost::hash_combine(seed, value);
+			return seed;
+		}
+
+		template <typename T>
+		size_t operator()(const Vector<T>& nodes) const
+		{
+			auto seed = nodes.size();
+			for (const auto& node : nodes)
+				boost::hash_combine(seed, (*this)(node));
+			return seed;
+		}
+
+		template <typename T>
+		size_t operator()(const boost::optional<T>& node) const
+		{
+			return node ? (*this)(*node) : 0;
+		}
+
+		template <typename T, std::enable_if_t<boost::fusion::traits::is_sequence<T>::value, int> = 0>
+		size_t operator()(const T& node) const
+		{
+			return members(node);
+		}
+
+	private:
+		template <typename T>
+		size_t members(const T& node) const
+		{
+			auto seed = typeTag<T>();
+			boost::fusion::for_each(node, [this, &seed](const auto& member) {
+				boost::hash_combine(seed, (*this)(member));
+			});
+			return seed;
+		}
+	};
+
+	size_t hashBlocks(const Block& block)
+	{
+		return StructuralHash{}(block);
+	}
+
+#ifdef WITH_TESTS
+	namespace
+	{
+		size_t hashOf(std::string_view program)
+		{
+			const auto res = parser::parseBlock(program);
+			REQUIRE(res.parsed);
+			return hashBlocks(res.block);
+		}
+	} // namespace
+
+	TEST_CASE("Structural hash")
+	{
+		// Positions, spaces and comments are ignored
+		CHECK(hashOf("local x = f(1, 'a') + t.y") == hashOf("\n\n  local x=f( 1,'a' )+t.y -- comment"));
+		CHECK(hashOf("function f(a) return a end") == hashOf("--[[ moved ]] function f(a)\n\treturn a\nend"));
+
+		// Any difference in the nodes or their content
+		const auto reference = hashOf("local x = f(1, 'a') + t.y");
+		for (const auto program : {"x = f(1, 'a') + t.y", "local y = f(1, 'a') + t.y", "local x = f(2, 'a') + t.y",
+								   "local x = f(1.0, 'a') + t.y", "local x = f(1, \"a\") + t.y", "local x = f(1, 'a') - t.y",
+								   "local x = f(1, 'a') + t:y()", "local x = f(1, 'a') + t[y]", "local x = f(1, 'a')"})
+		{
+			CHECK(hashOf(program) != reference);
+		}
+		CHECK(hashOf("do end") != hashOf("while true do end"));
+		CHECK(hashOf("break") != hashOf(";"));
+
+		// Each block stores its hash, the same for a function moved in the source
+		const auto first = parser::parseBlock("local a = 1\nlocal function f(x) return x * 2 end");
+		const auto second = parser::parseBlock("local b = {}\n\n\nlocal function f(x)\n\treturn x * 2\nend");
+		hashBlocks(first.block);
+		hashBlocks(second.block);
+		const auto& firstBody = boost::get<LocalFunctionDeclarationStatement>(first.block.statements.back().get()).body;
+		const auto& secondBody = boost::get<LocalFunctionDeclarationStatement>(second.block.statements.back().get()).body;
+		CHECK(first.block.hash != second.block.hash);
+		CHECK(firstBody.block.hash);
+		CHECK(firstBody.block.hash == secondBody.block.hash);
+
+		// The blocks already hashed are kept
+		const auto previous = first.block.hash;
+		firstBody.block.hash = 42;
+		first.block.hash = 0;
+		CHECK(hashBlocks(first.block) != previous);
+		CHECK(firstBody.block.hash == 42);
+	}
+#endif
+} // namespace lac::ast
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <lac/core_api.h>
+
+#include <cstddef>
+
+namespace lac::ast
+{
+	struct Block;
+
+	// Hash of the nodes of the tree, their names and their literals, but not of their positions:
+	// two blocks with the same statements have the same hash, wherever they are in the source.
+	// The hash of each block is stored in Block::hash, and the blocks already hashed are not visited again,
+	// so after a modification only the new nodes and the blocks containing them (their hash reset) are hashed.
+	// The values are stable between runs of the same build.
+	CORE_API size_t hashBlocks(const Block& block);
+} // namespace lac::ast
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <lac/parser/ast.h>
+#include <lac/parser/scan.h>
+
+#include <boost/spirit/home/x3/core/parser.hpp>
+#include <boost/spirit/home/x3/core/skip_over.hpp>
+#include <boost/spirit/home/x3/support/traits/move_to.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Recognition of the keywords and operators with perfect hash tables, generated at compile time
+namespace lac::parser
+{
+	namespace x3 = boost::spirit::x3;
+
+	template <class T>
+	struct Symbol
+	{
+		std::string_view str;
+		T value{};
+	};
+
+	// Hash table without collision for a fixed list of symbols, its seed being searched at compile time.
+	// The hash only uses the length, the first two characters and the last one.
+	template <class T, size_t N>
+	class PerfectHash
+	{
+	public:
+		static constexpr size_t tableSize = 64;
+
+		constexpr PerfectHash(const Symbol<T> (&symbols)[N])
+		{
+			for (const auto& symbol : symbols)
+				m_maxSize = symbol.str.size() > m_maxSize ? symbol.str.size() : m_maxSize;
+			while (!fill(symbols))
+				++m_seed;
+		}
+
+		// The symbol equal to str, or nullptr
+		constexpr const Symbol<T>* find(std::string_view str) const
+		{
+			if (str.empty() || str.size() > m_maxSize)
+				return nullptr;
+			const auto& slot = m_slots[index(str, m_seed)];
+			return slot.str == str ? &slot : nullptr;
+		}
+
+		// The longest symbol starting str, or nullptr
+		constexpr const Symbol<T>* findPrefix(std::string_view str) const
+		{
+			for (auto size = str.size() < m_maxSize ? str.size() : m_maxSize; size; --size)
+			{
+				if (const auto symbol = find(str.substr(0, size)))
+					return symbol;
+			}
+			return nullptr;
+		}
+
+	private:
+		static constexpr size_t index(std::string_view str, uint32_t seed)
+		{
+			auto hash = seed;
+			auto mix = [&hash](uint32_t c) { hash = (hash ^ c) * 16777619u; };
+			mix(static_cast<uint32_t>(str.size()));
+			mix(static_cast<unsigned char>(str[0]));
+			mix(str.size() > 1 ? static_cast<unsigned char>(str[1]) : 0u);
+			mix(static_cast<unsigned char>(str.back()));
+			return (hash >> 16) % tableSize;
+		}
+
+		constexpr bool fill(const Symbol<T> (&symbols)[N])
+		{
+			for (auto& slot : m_slots)
+				slot = {};
+			for (const auto& symbol : symbols)
+			{
+				auto& slot = m_slots[index(symbol.str, m_seed)];
+				if (!slot.str.empty())
+					return false; // Collision, try another seed
+				slot = symbol;
+			}
+			return true;
+		}
+
+		std::array<Symbol<T>, tableSize> m_slots{};
+		uint32_t m_seed = 0;
+		size_t m_maxSize = 0;
+	};
+
+	// Keywords starting a statement
+	enum class StatementKeyword : uint8_t
+	{
+		local,
+		function,
+		If,
+		For,
+		While,
+		repeat,
+		Do,
+		Goto,
+		Break
+	};
+
+	namespace symbols
+	{
+		using Op = ast::Operation;
+		using EC = ast::ExpressionConstant;
+		using SK = StatementKeyword;
+
+		inline constexpr Symbol<bool> keywordsList[] = {
+			{"and"}, {"break"}, {"do"}, {"else"}, {"elseif"}, {"end"}, {"false"}, {"for"}, {"function"}, {"goto"}, {"if"},
+			{"in"}, {"local"}, {"nil"}, {"not"}, {"or"}, {"repeat"}, {"return"}, {"then"}, {"true"}, {"until"}, {"while"}};
+
+		inline constexpr Symbol<Op> binaryOperatorsList[] = {
+			{"+", Op::add}, {"-", Op::sub}, {"*", Op::mul}, {"/", Op::div}, {"//", Op::idiv}, {"%", Op::mod}, {"^", Op::pow},
+			{"&", Op::band}, {"|", Op::bor}, {"~", Op::bxor}, {"<<", Op::shl}, {">>", Op::shr}, {"..", Op::concat},
+			{"<", Op::lt}, {"<=", Op::le}, {">", Op::gt}, {">=", Op::ge}, {"==", Op::eq}, {"~=", Op::ineq},
+			{"and", Op::land}, {"or", Op::lor}};
+
+		inline constexpr Symbol<Op> unaryOperatorsList[] = {
+			{"-", Op::unm}, {"#", Op::len}, {"~", Op::bnot}, {"not", Op::lnot}};
+
+		inline constexpr Symbol<EC> expressionConstantsList[] = {
+			{"nil", EC::nil}, {"false", EC::False}, {"true", EC::True}, {"...", EC::dots}};
+
+		inline constexpr Symbol<SK> statementKeywordsList[] = {
+			{"local", SK::local}, {"function", SK::function}, {"if", SK::If}, {"for", SK::For}, {"while", SK::While},
+			{"repeat", SK::repeat}, {"do", SK::Do}, {"goto", SK::Goto}, {"break", SK::Break}};
+
+		inline constexpr PerfectHash keywords{keywordsList};
+		inline constexpr PerfectHash binaryOperators{binaryOperatorsList};
+		inline constexpr PerfectHash unaryOperators{unaryOperatorsList};
+		inline constexpr PerfectHash expressionConstants{expressionConstantsList};
+		inline constexpr PerfectHash statementKeywords{statementKeywordsList};
+	} // namespace symbols
+
+	namespace details
+	{
+		inline std::string_view remaining(const char* first, const char* last)
+		{
+			return {first, static_cast<size_t>(last - first)};
+		}
+
+		// A complete name if the text starts with a letter, else the longest symbol of the table
+		template <class Table>
+		auto findSymbol(const Table& table, std::string_view view)
+		{
+			if (scan::isNameFirstLetter(view[0]))
+			{
+				const auto end = scan::skipName(view.data() + 1, view.data() + view.size());
+				return table.find(view.substr(0, end - view.data()));
+			}
+			return table.findPrefix(view);
+		}
+	} // namespace details
+
+	// Parse one of the symbols of the table, words being only recognized as a whole
+	template <class T, size_t N>
+	struct symbols_parser : x3::parser<symbols_parser<T, N>>
+	{
+		using attribute_type = T;
+		static const bool has_attribute = true;
+
+		constexpr symbols_parser(const PerfectHash<T, N>& table)
+			: table(table)
+		{
+		}
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute& attr) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last)
+				return false;
+
+			const auto symbol = details::findSymbol(table, details::remaining(&*first, &*first + (last - first)));
+			if (!symbol)
+				return false;
+
+			x3::traits::move_to(symbol->value, attr);
+			first += symbol->str.size();
+			return true;
+		}
+
+		const PerfectHash<T, N>& table;
+	};
+
+	// Parse a keyword, its attribute being the keyword itself
+	struct keyword_parser : x3::parser<keyword_parser>
+	{
+		using attribute_type = std::string;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute& attr) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last)
+				return false;
+
+			const auto symbol = details::findSymbol(symbols::keywords, details::remaining(&*first, &*first + (last - first)));
+			if (!symbol)
+				return false;
+
+			if constexpr (!std::is_same_v<Attribute, x3::unused_type>)
+				attr = std::string(symbol->str);
+			first += symbol->str.size();
+			return true;
+		}
+	};
+
+	// Parse a name which is not a keyword, as an atom
+	struct name_parser : x3::parser<name_parser>
+	{
+		using attribute_type = ast::Atom;
+		static const bool has_attribute = true;
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute& attr) const
+		{
+			x3::skip_over(first, last, context);
+			if (first == last || !scan::isNameFirstLetter(*first))
+				return false;
+
+			const auto start = &*first;
+			const auto end = scan::skipName(start + 1, start + (last - first));
+			const std::string_view name(start, end - start);
+			if (symbols::keywords.find(name))
+				return false;
+
+			if constexpr (!std::is_same_v<Attribute, x3::unused_type>)
+				attr = ast::Atom{name};
+			first += name.size();
+			return true;
+		}
+	};
+
+	// Parse the given keyword, not followed by a letter
+	struct word_parser : x3::parser<word_parser>
+	{
+		using attribute_type = x3::unused_type;
+		static const bool has_attribute = false;
+
+		constexpr word_parser(std::string_view word)
+			: word(word)
+		{
+		}
+
+		template <typename Iterator, typename Context, typename RContext, typename Attribute>
+		bool parse(Iterator& first, const Iterator& last, const Context& context, RContext&, Attribute&) const
+		{
+			x3::skip_over(first, last, context);
+			const auto size = static_cast<size_t>(last - first);
+			if (size < word.size() || std::string_view(&*first, word.size()) != word
+				|| (size > word.size() && scan::isNameLetter(first[word.size()])))
+				return false;
+
+			first += word.size();
+			return true;
+		}
+
+		std::string_view word;
+	};
+} // namespace lac::parser
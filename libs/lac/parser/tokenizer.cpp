@@ -0,0 +1,269 @@
+#include <lac/parser/scan.h>
+#include <lac/parser/symbols.h>
+#include <lac/parser/tokenizer.h>
+
+#ifdef WITH_TESTS
+#include <doctest/doctest.h>
+#endif
+
+#include <algorithm>
+#include <optional>
+
+namespace
+{
+	using namespace lac;
+
+	const char* skipDigits(const char* it, const char* last, bool hexadecimal)
+	{
+		while (it != last && (scan::isDigit(*it) || (hexadecimal && ((*it >= 'a' && *it <= 'f') || (*it >= 'A' && *it <= 'F')))))
+			++it;
+		return it;
+	}
+
+	const char* skipNumeral(const char* it, const char* last)
+	{
+		const auto hexadecimal = last - it > 1 && it[0] == '0' && (it[1] == 'x' || it[1] == 'X');
+		if (hexadecimal)
+			it += 2;
+		it = skipDigits(it, last, hexadecimal);
+		if (it != last && *it == '.')
+			it = skipDigits(it + 1, last, hexadecimal);
+
+		const auto exponent = hexadecimal ? 'p' : 'e';
+		if (it != last && (*it == exponent || *it == exponent - 'a' + 'A'))
+		{
+			auto next = it + 1;
+			if (next != last && (*next == '+' || *next == '-'))
+				++next;
+			if (next != last && scan::isDigit(*next))
+				it = skipDigits(next, last, false);
+		}
+		return it;
+	}
+
+	// Return the size of the operator or punctuation at it, or 0
+	size_t symbolSize(const char* it, const char* last)
+	{
+		static constexpr std::string_view symbols3 = "...";
+		static constexpr std::string_view symbols2[] = {"..", "::", "==", "~=", "<=", ">=", "<<", ">>", "//"};
+		static constexpr std::string_view symbols1 = "+-*/%^#&~|<>=(){}[];:,.";
+
+		const std::string_view str(it, std::min<size_t>(last - it, 3));
+		if (str == symbols3)
+			return 3;
+		for (const auto s : symbols2)
+			if (str.substr(0, 2) == s)
+				return 2;
+		return symbols1.find(*it) != std::string_view::npos ? 1 : 0;
+	}
+} // namespace
+
+namespace lac::parser
+{
+	bool isKeyword(std::string_view str)
+	{
+		return symbols::keywords.find(str) != nullptr;
+	}
+
+	Token nextToken(std::string_view view, size_t pos)
+	{
+		const auto first = view.data();
+		const auto last = first + view.size();
+		const auto it = scan::skipSpaces(first + pos, last);
+
+		auto makeToken = [&](const char* end, TokenType type) {
+			return Token{static_cast<uint32_t>(it - first), static_cast<uint32_t>(end - it), type};
+		};
+
+		if (it == last)
+			return makeToken(last, TokenType::invalid);
+
+		const auto c = *it;
+		const char* end = nullptr;
+		auto type = TokenType::invalid;
+		if (scan::isNameFirstLetter(c))
+		{
+			end = scan::skipName(it + 1, last);
+			type = isKeyword({it, static_cast<size_t>(end - it)}) ? TokenType::keyword : TokenType::name;
+		}
+		else if (scan::isDigit(c) || (c == '.' && it + 1 != last && scan::isDigit(it[1])))
+		{
+			end = skipNumeral(it, last);
+			type = TokenType::numeral;
+		}
+		else if (c == '"' || c == '\'')
+		{
+			end = scan::skipQuotedString(it, last);
+			type = TokenType::literal_string;
+		}
+		else if (c == '-' && it + 1 != last && it[1] == '-')
+		{
+			const auto level = scan::longBracketLevel(it + 2, last);
+			end = level < 0
+					  ? scan::findFirstOf(it + 2, last, '\n', '\r')
+					  : scan::skipLongBracket(it + 2, last, level);
+			type = TokenType::comment;
+		}
+		else if (const auto level = scan::longBracketLevel(it, last); level >= 0)
+		{
+			end = scan::skipLongBracket(it, last, level);
+			type = TokenType::literal_string;
+		}
+		else if (const auto size = symbolSize(it, last))
+		{
+			end = it + size;
+			type = TokenType::symbol;
+		}
+
+		if (!end)
+			return makeToken(last, TokenType::invalid);
+		return makeToken(end, type);
+	}
+
+	Tokens tokenize(std::string_view view)
+	{
+		Tokens tokens;
+		size_t pos = 0;
+		while (true)
+		{
+			const auto token = nextToken(view, pos);
+			if (!token.size)
+				break;
+			tokens.push_back(token);
+			if (token.type == TokenType::invalid)
+				break;
+			pos = token.begin + token.size;
+		}
+		return tokens;
+	}
+
+	size_t findBlockEnd(std::string_view view, size_t pos)
+	{
+		size_t depth = 0;
+		for (auto token = nextToken(view, pos); token.size && token.type != TokenType::invalid; token = nextToken(view, token.begin + token.size))
+		{
+			if (token.type != TokenType::keyword)
+				continue;
+
+			const auto str = view.substr(token.begin, token.size);
+			if (str == "function" || str == "do" || str == "if" || str == "repeat") // The loops are opened by their 'do'
+				++depth;
+			else if (str == "end" || str == "until")
+			{
+				if (!depth)
+					return str == "end" ? token.begin : std::string_view::npos;
+				--depth;
+			}
+		}
+		return std::string_view::npos;
+	}
+
+#ifdef WITH_TESTS
+	TEST_SUITE_BEGIN("Tokenizer");
+
+	std::vector<std::pair<std::string_view, TokenType>> getTokens(std::string_view view)
+	{
+		std::vector<std::pair<std::string_view, TokenType>> res;
+		for (const auto& t : tokenize(view))
+			res.emplace_back(view.substr(t.begin, t.size), t.type);
+		return res;
+	}
+
+	TEST_CASE("Tokenize")
+	{
+		using T = TokenType;
+		using Result = std::vector<std::pair<std::string_view, TokenType>>;
+
+		CHECK(getTokens("").empty());
+		CHECK(getTokens(" \t\r\n ").empty());
+		CHECK(getTokens("local x = 42") == Result{{"local", T::keyword}, {"x", T::name}, {"=", T::symbol}, {"42", T::numeral}});
+		CHECK(getTokens("ends end_ end") == Result{{"ends", T::name}, {"end_", T::name}, {"end", T::keyword}});
+		CHECK(getTokens("a.b:c(...)") == Result{{"a", T::name}, {".", T::symbol}, {"b", T::name}, {":", T::symbol}, {"c", T::name}, {"(", T::symbol}, {"...", T::symbol}, {")", T::symbol}});
+		CHECK(getTokens("a..b ~= c//d") == Result{{"a", T::name}, {"..", T::symbol}, {"b", T::name}, {"~=", T::symbol}, {"c", T::name}, {"//", T::symbol}, {"d", T::name}});
+		CHECK(getTokens("3.14 .5 1e-3 0x1F 0xA.8p+2 5..x") == Result{{"3.14", T::numeral}, {".5", T::numeral}, {"1e-3", T::numeral}, {"0x1F", T::numeral}, {"0xA.8p+2", T::numeral}, {"5.", T::numeral}, {".", T::symbol}, {"x", T::name}});
+		CHECK(getTokens(R"("a\"b" 'c"d')") == Result{{R"("a\"b")", T::literal_string}, {R"('c"d')", T::literal_string}});
+		CHECK(getTokens("x[[a]]y[==[b]]]==]z") == Result{{"x", T::name}, {"[[a]]", T::literal_string}, {"y", T::name}, {"[==[b]]]==]", T::literal_string}, {"z", T::name}});
+		CHECK(getTokens("t[ [[a]] ]") == Result{{"t", T::name}, {"[", T::symbol}, {"[[a]]", T::literal_string}, {"]", T::symbol}});
+		CHECK(getTokens("a -- comment\nb --[[ long\ncomment ]] c") == Result{{"a", T::name}, {"-- comment", T::comment}, {"b", T::name}, {"--[[ long\ncomment ]]", T::comment}, {"c", T::name}});
+		CHECK(getTokens("--[=[ ]] ]=]") == Result{{"--[=[ ]] ]=]", T::comment}});
+
+		CHECK(getTokens("a 'b") == Result{{"a", T::name}, {"'b", T::invalid}});
+		CHECK(getTokens("a [[b]") == Result{{"a", T::name}, {"[[b]", T::invalid}});
+		CHECK(getTokens("--[[ a") == Result{{"--[[ a", T::invalid}});
+		CHECK(getTokens("a $ b") == Result{{"a", T::name}, {"$ b", T::invalid}});
+	}
+
+	TEST_CASE("Scan kernels")
+	{
+		// Compare the vectorized kernels with the scalar ones, at all offsets around the vector width
+		std::string str;
+		const std::string_view chars = " \t\n\rab_Z09.=]\"\\\x80\xff";
+		for (size_t i = 0; i < 200; ++i)
+			str += chars[(i * 7 + i / 13) % chars.size()];
+
+		const auto last = str.data() + str.size();
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			const auto first = str.data() + i;
+			CHECK(scan::skipSpaces(first, last) == scan::scalar::skipSpaces(first, last));
+			CHECK(scan::skipName(first, last) == scan::scalar::skipName(first, last));
+			CHECK(scan::findFirstOf(first, last, ']', '\\') == scan::scalar::findFirstOf(first, last, ']', '\\'));
+			CHECK(scan::findFirstOf(first, last, '"', '=', '\n') == scan::scalar::findFirstOf(first, last, '"', '=', '\n'));
+		}
+
+		const std::string spaces(100, ' ');
+		CHECK(scan::skipSpaces(spaces.data(), spaces.data() + spaces.size()) == spaces.data() + spaces.size());
+		const std::string name(100, 'a');
+		CHECK(scan::skipName(name.data(), name.data() + name.size()) == name.data() + name.size());
+	}
+
+	TEST_CASE("Scan literals")
+	{
+		const auto skipped = [](auto skip, std::string_view str) -> std::optional<std::string_view> {
+			const auto end = skip(str.data(), str.data() + str.size());
+			if (!end)
+				return {};
+			return str.substr(0, end - str.data());
+		};
+
+		const std::string data(100, 'x');
+		CHECK(skipped(scan::skipQuotedString, "'" + data + "' b") == "'" + data + "'");
+		CHECK(skipped(scan::skipQuotedString, "\"" + data + "\\\"" + data + "\"") == "\"" + data + "\\\"" + data + "\"");
+		CHECK(skipped(scan::skipQuotedString, "'a\\\\' b'") == "'a\\\\' b'"); // Only the quote is escaped
+		CHECK_FALSE(skipped(scan::skipQuotedString, "'" + data));
+		CHECK_FALSE(skipped(scan::skipQuotedString, "a'"));
+
+		CHECK(skipped(scan::skipLongString, "[[" + data + "]] ]]") == "[[" + data + "]]");
+		CHECK(skipped(scan::skipLongString, "[==[" + data + "]=] ]]]==]") == "[==[" + data + "]=] ]]]==]");
+		CHECK_FALSE(skipped(scan::skipLongString, "[=[" + data + "]]"));
+		CHECK_FALSE(skipped(scan::skipLongString, "[=" + data));
+
+		CHECK(skipped(scan::skipLine, data + "\r\nb") == data + "\r\n");
+		CHECK(skipped(scan::skipLine, data + "\n\nb") == data + "\n");
+		CHECK(skipped(scan::skipLine, data) == data);
+	}
+
+	TEST_CASE("Find block end")
+	{
+		const auto blockEnd = [](std::string_view view) {
+			const auto pos = findBlockEnd(view, 0);
+			return pos == std::string_view::npos ? std::string_view{} : view.substr(0, pos);
+		};
+
+		CHECK(blockEnd("end") == "");
+		CHECK(blockEnd(" x = 1 end y = 2 end") == " x = 1 ");
+		CHECK(blockEnd("if a then b() elseif c then d() else e() end end") == "if a then b() elseif c then d() else e() end ");
+		CHECK(blockEnd("for i = 1, 2 do while x do end end repeat until y end") == "for i = 1, 2 do while x do end end repeat until y ");
+		CHECK(blockEnd("local f = function() return {x = 'end'} end -- end\n end") == "local f = function() return {x = 'end'} end -- end\n ");
+		CHECK(blockEnd("x = [[ end ]] --[[ end ]] t.ending = 1 end") == "x = [[ end ]] --[[ end ]] t.ending = 1 ");
+
+		CHECK(findBlockEnd("x = 1", 0) == std::string_view::npos);
+		CHECK(findBlockEnd("do x = 1 end", 0) == std::string_view::npos);
+		CHECK(findBlockEnd("until x end", 0) == std::string_view::npos);
+		CHECK(findBlockEnd("x = 'a end", 0) == std::string_view::npos);
+		CHECK(findBlockEnd("function f() end end", 16) == 17);
+	}
+
+	TEST_SUITE_END();
+#endif
+} // namespace lac::parser
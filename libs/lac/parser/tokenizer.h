@@ -0,0 +1,42 @@
+#pragma once
+
+#include <lac/core_api.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace lac::parser
+{
+	enum class TokenType : uint8_t
+	{
+		name,
+		keyword,
+		numeral,
+		literal_string,
+		comment,
+		symbol,
+		invalid // Unknown character or unterminated string / comment, always the last token
+	};
+
+	struct Token
+	{
+		uint32_t begin = 0;
+		uint32_t size = 0;
+		TokenType type = TokenType::invalid;
+	};
+
+	using Tokens = std::vector<Token>;
+
+	CORE_API bool isKeyword(std::string_view str);
+
+	// Return the first token at or after pos, skipping spaces. Its size is 0 at the end of the view.
+	CORE_API Token nextToken(std::string_view view, size_t pos);
+
+	// Split the source in tokens, skipping spaces
+	CORE_API Tokens tokenize(std::string_view view);
+
+	// Return the position of the 'end' keyword closing the block starting at pos (such as a function body), or npos.
+	// Only the keywords opening and closing blocks are counted: the statements are not validated.
+	CORE_API size_t findBlockEnd(std::string_view view, size_t pos);
+} // namespace lac::parser
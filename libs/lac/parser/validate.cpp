@@ -0,0 +1,93 @@
+#define LAC_VALIDATION_GRAMMAR
+#include <lac/parser/chunk_def.h>
+#include <lac/parser/parser.h>
+
+#ifdef WITH_TESTS
+#include <doctest/doctest.h>
+#endif
+
+#include <algorithm>
+#include <functional>
+
+namespace lac::parser
+{
+	ValidateResults validate(std::string_view view)
+	{
+		namespace x3 = boost::spirit::x3;
+
+		// Recover from the errors as parseBlock does, to find the first invalid statement even inside a block
+		ErrorRecovery<std::string_view::const_iterator> recovery{view.begin(), true};
+		const auto parser = x3::with<recovery_tag>(std::ref(recovery))[validation::chunk];
+
+		ValidateResults res;
+		auto f = view.begin();
+		const auto l = view.end();
+		const auto parsed = x3::phrase_parse(f, l, parser, validation::skipper); // Also skips the spaces and comments after the last statement
+		res.valid = parsed && f == l && recovery.errors().empty();
+		res.lastParsedPosition = f - view.begin();
+		for (const auto& error : recovery.errors())
+			res.lastParsedPosition = std::min(res.lastParsedPosition, error.first);
+		return res;
+	}
+
+#ifdef WITH_TESTS
+	void test_validate(std::string_view program)
+	{
+		const auto res = validate(program);
+		if (program.empty())
+		{
+			CHECK(res.valid); // parseBlock does not even try
+			return;
+		}
+		const auto expected = parseBlock(program);
+		CHECK(res.valid == expected.parsed);
+		CHECK(res.lastParsedPosition == expected.lastParsedPosition);
+	}
+
+	TEST_CASE("validate")
+	{
+		const std::string program = R"~~(-- header
+local x, y = 42, 0x1F
+--[==[ long
+comment ]==]
+function obj.test(a, b, ...)
+	if a < b and not y then
+		return a
+	elseif a == "str\\"" then
+		print(a, [[long string]])
+	else
+		goto label
+	end
+	::label::
+	for i = 1, #b do b[i] = nil end
+	for k, v in pairs(b) do break end
+	repeat x = x - 1 until x < 0
+	return b
+end
+
+t = {1, 2; 'three', x = 4, [5] = function(...) return ... end}
+print(obj.test(x, t[1]):method{y} .. 'end')
+return t
+)~~";
+
+		CHECK(validate(program).valid);
+		CHECK(validate(program).lastParsedPosition == program.size());
+		test_validate(program);
+		test_validate("");
+		test_validate("x = 1 end");
+		test_validate("local x = 'unterminated");
+		test_validate("x = a.\ny = 2");
+
+		// The first invalid statement, not the top-level one containing it
+		const auto nested = validate("function f() x = = 1 end y = 2");
+		CHECK_FALSE(nested.valid);
+		CHECK(nested.lastParsedPosition == 13);
+		test_validate("function f() x = = 1 end y = 2");
+		test_validate("if a then\n\tlocal = 1\nend");
+
+		// Every truncated program, most of them invalid
+		for (size_t i = 0; i < program.size(); ++i)
+			test_validate(std::string_view(program).substr(0, i));
+	}
+#endif
+} // namespace lac::parser
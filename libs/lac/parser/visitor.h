@@ -0,0 +1,122 @@
+#pragma once
+
+#include <lac/parser/ast.h>
+
+// Bases of the visitors of the tree, with static dispatch to the overloads of the derived class.
+// The nodes are always received by reference: a visit does not copy any part of the tree.
+// The derived class brings the overloads of its base with "using Base::operator();" and defines the ones it needs.
+namespace lac::ast
+{
+	// For the visitors computing a value for each node: the variants and forward nodes are dispatched
+	// to the overload of their content, the other nodes must be handled by Derived
+	template <typename Derived, typename Result>
+	class Dispatcher : public boost::static_visitor<Result>
+	{
+	public:
+		template <typename... Types>
+		Result operator()(const boost::spirit::x3::variant<Types...>& node) const
+		{
+			return boost::apply_visitor(derived(), node);
+		}
+
+		template <typename T>
+		Result operator()(const Forward<T>& node) const
+		{
+			return derived()(node.get());
+		}
+
+	protected:
+		const Derived& derived() const
+		{
+			return static_cast<const Derived&>(*this);
+		}
+	};
+
+	// For the traversals: by default each node visits its children, in the order of the source.
+	// A visit returning false stops the traversal, and false is returned up to the root.
+	template <typename Derived>
+	class Visitor : public Dispatcher<Derived, bool>
+	{
+	public:
+		using Dispatcher<Derived, bool>::operator();
+
+		bool operator()(ExpressionConstant) const { return true; }
+		bool operator()(const Numeral&) const { return true; }
+		bool operator()(const LiteralString&) const { return true; }
+		bool operator()(Atom) const { return true; }
+		bool operator()(const TableIndexName&) const { return true; }
+		bool operator()(const EmptyArguments&) const { return true; }
+		bool operator()(const ParametersList&) const { return true; }
+		bool operator()(const FunctionName&) const { return true; }
+
+		template <typename T>
+		bool operator()(const Vector<T>& nodes) const
+		{
+			for (const auto& node : nodes)
+			{
+				if (!derived()(node))
+					return false;
+			}
+			return true;
+		}
+
+		// Expressions
+		bool operator()(const UnaryOperation& uo) const { return traverse(uo.expression); }
+		bool operator()(const BinaryOperation& bo) const { return traverse(bo.operand); }
+		bool operator()(const Expression& ex) const { return traverse(ex.operand, ex.binaryOperations); }
+		bool operator()(const FieldByExpression& f) const { return traverse(f.key, f.value); }
+		bool operator()(const FieldByAssignment& f) const { return traverse(f.value); }
+		bool operator()(const TableConstructor& tc) const { return traverse(tc.fields); }
+		bool operator()(const BracketedExpression& be) const { return traverse(be.expression); }
+		bool operator()(const TableIndexExpression& tie) const { return traverse(tie.expression); }
+		bool operator()(const FunctionCallEnd& fce) const { return traverse(fce.arguments); }
+		bool operator()(const PrefixExpression& pe) const { return traverse(pe.start, pe.rest); }
+		bool operator()(const VariableFunctionCall& vfc) const { return traverse(vfc.functionCall, vfc.postVariable); }
+		bool operator()(const Variable& v) const { return traverse(v.start, v.rest); }
+		bool operator()(const FunctionCallPostfix& fcp) const { return traverse(fcp.tableIndex, fcp.functionCall); }
+		bool operator()(const FunctionCall& fc) const { return traverse(fc.start, fc.rest); }
+		bool operator()(const FunctionBody& fb) const { return traverse(fb.parameters, fb.block); } // The block is empty if lazy
+
+		// Statements
+		bool operator()(const ReturnStatement& rs) const { return traverse(rs.expressions); }
+		bool operator()(const EmptyStatement&) const { return true; }
+		bool operator()(const AssignmentStatement& s) const { return traverse(s.variables, s.expressions); }
+		bool operator()(const LabelStatement&) const { return true; }
+		bool operator()(const GotoStatement&) const { return true; }
+		bool operator()(const BreakStatement&) const { return true; }
+		bool operator()(const DoStatement& s) const { return traverse(s.block); }
+		bool operator()(const WhileStatement& s) const { return traverse(s.condition, s.block); }
+		bool operator()(const RepeatStatement& s) const { return traverse(s.block, s.condition); }
+		bool operator()(const IfStatement& s) const { return traverse(s.condition, s.block); }
+		bool operator()(const IfThenElseStatement& s) const { return traverse(s.first, s.rest, s.elseBlock); }
+		bool operator()(const NumericalForStatement& s) const { return traverse(s.first, s.last, s.step, s.block); }
+		bool operator()(const GenericForStatement& s) const { return traverse(s.variables, s.expressions, s.block); }
+		bool operator()(const FunctionDeclarationStatement& s) const { return traverse(s.name, s.body); }
+		bool operator()(const LocalFunctionDeclarationStatement& s) const { return traverse(s.name, s.body); }
+		bool operator()(const LocalAssignmentStatement& s) const { return traverse(s.variables, s.expressions); }
+		bool operator()(const Block& b) const { return traverse(b.statements, b.returnStatement); }
+
+	protected:
+		using Dispatcher<Derived, bool>::derived;
+
+		// Visit the nodes in order, the optional ones if they are set, until a visit returns false
+		template <typename... Nodes>
+		bool traverse(const Nodes&... nodes) const
+		{
+			return (traverseNode(nodes) && ...);
+		}
+
+	private:
+		template <typename T>
+		bool traverseNode(const T& node) const
+		{
+			return derived()(node);
+		}
+
+		template <typename T>
+		bool traverseNode(const boost::optional<T>& node) const
+		{
+			return !node || derived()(*node);
+		}
+	};
+} // namespace lac::ast